@@ -170,6 +170,20 @@ struct eigenverb {
  */
 typedef std::list<eigenverb> eigenverb_list ;
 
+/**
+ * Gaussian projection tagged with the interface that generated it.
+ * Used to deliver all of the eigenverbs from a wavefront step
+ * to each listener as a single batch.
+ */
+struct interface_eigenverb {
+
+    /** Interface number for the interface that generated this eigenverb. */
+    size_t interface_num ;
+
+    /** Gaussian projection onto the interface. */
+    eigenverb verb ;
+};
+
 /// @}
 }  // end of namespace waveq3d
 }  // end of namespace usml
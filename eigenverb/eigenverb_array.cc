@@ -0,0 +1,169 @@
+/**
+ * @file eigenverb_array.cc
+ * Contiguous storage for the eigenverbs on a single interface.
+ */
+#include <usml/eigenverb/eigenverb_array.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace usml::eigenverb ;
+
+/**
+ * Computes the geometry for an eigenverb.
+ */
+void eigenverb_frame::compute( const eigenverb& verb ) {
+    const double rho = verb.position.rho() ;
+    const double theta = verb.position.theta() ;
+    const double phi = verb.position.phi() ;
+    const double sin_theta = sin( theta ) ;
+    const double cos_theta = cos( theta ) ;
+    const double sin_phi = sin( phi ) ;
+    const double cos_phi = cos( phi ) ;
+
+    unit[0] = sin_theta * cos_phi ;
+    unit[1] = sin_theta * sin_phi ;
+    unit[2] = cos_theta ;
+
+    // north and east unit vectors in the local tangent plane
+
+    const double north[3] = { -cos_theta * cos_phi, -cos_theta * sin_phi, sin_theta } ;
+    const double east[3] = { -sin_phi, cos_phi, 0.0 } ;
+
+    // length axis is a compass heading, width axis is 90 deg clockwise
+
+    const double cos_dir = rho * cos( verb.direction ) ;
+    const double sin_dir = rho * sin( verb.direction ) ;
+    for ( size_t n=0 ; n < 3 ; ++n ) {
+        length_axis[n] = cos_dir * north[n] + sin_dir * east[n] ;
+        width_axis[n] = cos_dir * east[n] - sin_dir * north[n] ;
+    }
+
+    cos2 = cos( 2.0 * verb.direction ) ;
+    sin2 = sin( 2.0 * verb.direction ) ;
+    sum = verb.length2 + verb.width2 ;
+    diff = verb.length2 - verb.width2 ;
+    prod = verb.length2 * verb.width2 ;
+}
+
+/**
+ * Reserve memory for a specific number of eigenverbs.
+ */
+void eigenverb_array::reserve( size_t num_verbs, size_t num_freq ) {
+    _time.reserve( num_verbs ) ;
+    _power.reserve( num_verbs * num_freq ) ;
+    _max_power.reserve( num_verbs ) ;
+    _length.reserve( num_verbs ) ;
+    _length2.reserve( num_verbs ) ;
+    _width.reserve( num_verbs ) ;
+    _width2.reserve( num_verbs ) ;
+    _position.reserve( num_verbs ) ;
+    _direction.reserve( num_verbs ) ;
+    _grazing.reserve( num_verbs ) ;
+    _sound_speed.reserve( num_verbs ) ;
+    _slowness.reserve( num_verbs ) ;
+    _de_index.reserve( num_verbs ) ;
+    _az_index.reserve( num_verbs ) ;
+    _source_de.reserve( num_verbs ) ;
+    _source_az.reserve( num_verbs ) ;
+    _surface.reserve( num_verbs ) ;
+    _bottom.reserve( num_verbs ) ;
+    _caustic.reserve( num_verbs ) ;
+    _upper.reserve( num_verbs ) ;
+    _lower.reserve( num_verbs ) ;
+    _frame.reserve( num_verbs ) ;
+}
+
+/**
+ * Copy an eigenverb onto the end of this array.
+ */
+void eigenverb_array::push_back( const eigenverb& verb ) {
+    if ( _time.empty() ) {
+        _frequencies = verb.frequencies ;
+        _num_freq = verb.power.size() ;
+    }
+    _time.push_back( verb.time ) ;
+    _power.insert( _power.end(), verb.power.begin(),
+                   verb.power.begin() + _num_freq ) ;
+    _max_power.push_back( ( _num_freq == 0 ) ? 0.0 :
+        *std::max_element( verb.power.begin(), verb.power.begin() + _num_freq ) ) ;
+    _length.push_back( verb.length ) ;
+    _length2.push_back( verb.length2 ) ;
+    _width.push_back( verb.width ) ;
+    _width2.push_back( verb.width2 ) ;
+    _position.push_back( verb.position ) ;
+    _direction.push_back( verb.direction ) ;
+    _grazing.push_back( verb.grazing ) ;
+    _sound_speed.push_back( verb.sound_speed ) ;
+    _slowness.push_back( cos( verb.grazing ) / verb.sound_speed ) ;
+    _de_index.push_back( verb.de_index ) ;
+    _az_index.push_back( verb.az_index ) ;
+    _source_de.push_back( verb.source_de ) ;
+    _source_az.push_back( verb.source_az ) ;
+    _surface.push_back( verb.surface ) ;
+    _bottom.push_back( verb.bottom ) ;
+    _caustic.push_back( verb.caustic ) ;
+    _upper.push_back( verb.upper ) ;
+    _lower.push_back( verb.lower ) ;
+    _frame.push_back( eigenverb_frame() ) ;
+    _frame.back().compute( verb ) ;
+}
+
+/**
+ * Remove all eigenverbs from this array.
+ */
+void eigenverb_array::clear() {
+    _frequencies = NULL ;
+    _num_freq = 0 ;
+    _time.clear() ;
+    _power.clear() ;
+    _max_power.clear() ;
+    _length.clear() ;
+    _length2.clear() ;
+    _width.clear() ;
+    _width2.clear() ;
+    _position.clear() ;
+    _direction.clear() ;
+    _grazing.clear() ;
+    _sound_speed.clear() ;
+    _slowness.clear() ;
+    _de_index.clear() ;
+    _az_index.clear() ;
+    _source_de.clear() ;
+    _source_az.clear() ;
+    _surface.clear() ;
+    _bottom.clear() ;
+    _caustic.clear() ;
+    _upper.clear() ;
+    _lower.clear() ;
+    _frame.clear() ;
+}
+
+/**
+ * Copy a single eigenverb out of this array.
+ */
+void eigenverb_array::get( size_t n, eigenverb* verb ) const {
+    verb->time = _time[n] ;
+    verb->frequencies = _frequencies ;
+    if ( verb->power.size() != _num_freq ) {
+        verb->power.resize( _num_freq ) ;
+    }
+    const double* p = power(n) ;
+    std::copy( p, p + _num_freq, verb->power.begin() ) ;
+    verb->length = _length[n] ;
+    verb->length2 = _length2[n] ;
+    verb->width = _width[n] ;
+    verb->width2 = _width2[n] ;
+    verb->position = _position[n] ;
+    verb->direction = _direction[n] ;
+    verb->grazing = _grazing[n] ;
+    verb->sound_speed = _sound_speed[n] ;
+    verb->de_index = _de_index[n] ;
+    verb->az_index = _az_index[n] ;
+    verb->source_de = _source_de[n] ;
+    verb->source_az = _source_az[n] ;
+    verb->surface = _surface[n] ;
+    verb->bottom = _bottom[n] ;
+    verb->caustic = _caustic[n] ;
+    verb->upper = _upper[n] ;
+    verb->lower = _lower[n] ;
+}
@@ -0,0 +1,280 @@
+/**
+ * @file eigenverb_array.h
+ * Contiguous storage for the eigenverbs on a single interface.
+ */
+#pragma once
+
+#include <usml/eigenverb/eigenverb.h>
+#include <vector>
+
+namespace usml {
+namespace eigenverb {
+
+/// @ingroup eigenverb
+/// @{
+
+/**
+ * Geometry of an eigenverb that does not change from one eigenverb pair to
+ * the next.  Computed once when the eigenverb is added to an
+ * eigenverb_array, so that the relative position and orientation of two
+ * eigenverbs can be computed without trigonometric functions.
+ *
+ * The location of impact is stored as an earth centered unit vector.
+ * The length and width axes are unit vectors in the plane tangent to the
+ * earth at the point of impact, scaled by the distance to the center of
+ * the earth.  The offset of another eigenverb along each axis is then
+ * just the dot product of that axis with the other eigenverb's unit vector.
+ * This is the projection of the chord between the two points onto the
+ * tangent plane, which differs from the great circle range by a
+ * fraction on the order of (range/earth_radius)^2.
+ */
+struct eigenverb_frame {
+
+    /** Earth centered unit vector to the location of impact. */
+    double unit[3] ;
+
+    /** Direction of the "length" axis, scaled by radius (meters). */
+    double length_axis[3] ;
+
+    /** Direction of the "width" axis, scaled by radius (meters). */
+    double width_axis[3] ;
+
+    /** Cosine of twice the direction of the length axis. */
+    double cos2 ;
+
+    /** Sine of twice the direction of the length axis. */
+    double sin2 ;
+
+    /** Sum of the length and width squares (meters^2). */
+    double sum ;
+
+    /** Difference of the length and width squares (meters^2). */
+    double diff ;
+
+    /** Product of the length and width squares (meters^4). */
+    double prod ;
+
+    /**
+     * Offset of another eigenverb along the length axis of this one (meters).
+     *
+     * @param other     Geometry of the other eigenverb.
+     */
+    double offset_length( const eigenverb_frame& other ) const {
+        return length_axis[0] * other.unit[0]
+             + length_axis[1] * other.unit[1]
+             + length_axis[2] * other.unit[2] ;
+    }
+
+    /**
+     * Offset of another eigenverb along the width axis of this one (meters).
+     *
+     * @param other     Geometry of the other eigenverb.
+     */
+    double offset_width( const eigenverb_frame& other ) const {
+        return width_axis[0] * other.unit[0]
+             + width_axis[1] * other.unit[1]
+             + width_axis[2] * other.unit[2] ;
+    }
+
+    /**
+     * Cosine and sine of twice the angle from the length axis of this
+     * eigenverb to the length axis of another one.
+     *
+     * @param other     Geometry of the other eigenverb.
+     * @param cos2alpha Cosine of twice the relative direction (output).
+     * @param sin2alpha Sine of twice the relative direction (output).
+     */
+    void relative_direction( const eigenverb_frame& other,
+        double* cos2alpha, double* sin2alpha ) const
+    {
+        *cos2alpha = other.cos2 * cos2 + other.sin2 * sin2 ;
+        *sin2alpha = other.sin2 * cos2 - other.cos2 * sin2 ;
+    }
+
+    /**
+     * Computes the geometry for an eigenverb.
+     *
+     * @param verb      Eigenverb to compute the geometry for.
+     */
+    void compute( const eigenverb& verb ) ;
+};
+
+/**
+ * Contiguous storage for the eigenverbs on a single interface.
+ * Each eigenverb attribute is stored in its own array (structure of
+ * arrays), and the frequency dependent power of all eigenverbs is
+ * stored in a single flat matrix organized as [eigenverb][frequency].
+ * This avoids the heap allocation of a separate power vector for each
+ * eigenverb, and allows the reverberation model to refer to eigenverbs
+ * by index, so that the inner loops of envelope generation never copy
+ * an eigenverb.  The eigenverb_frame of each eigenverb is computed
+ * as it is added to the array.
+ *
+ * All eigenverbs in the array must share the same frequency axis.
+ * The frequencies pointer of the first eigenverb added is used for
+ * the whole array.
+ */
+class USML_DECLSPEC eigenverb_array {
+
+public:
+
+    /** Construct an empty array. */
+    eigenverb_array() : _frequencies(NULL), _num_freq(0) {}
+
+    /** Number of eigenverbs in this array. */
+    size_t size() const {
+        return _time.size() ;
+    }
+
+    /** True if there are no eigenverbs in this array. */
+    bool empty() const {
+        return _time.empty() ;
+    }
+
+    /** Frequencies of the wavefront (Hz), NULL if empty. */
+    const seq_vector* frequencies() const {
+        return _frequencies ;
+    }
+
+    /** Number of frequencies for each eigenverb. */
+    size_t num_frequencies() const {
+        return _num_freq ;
+    }
+
+    /**
+     * Reserve memory for a specific number of eigenverbs.
+     *
+     * @param num_verbs     Number of eigenverbs to reserve.
+     * @param num_freq      Number of frequencies for each eigenverb.
+     */
+    void reserve( size_t num_verbs, size_t num_freq ) ;
+
+    /**
+     * Copy an eigenverb onto the end of this array.
+     *
+     * @param verb      Eigenverb to add.
+     */
+    void push_back( const eigenverb& verb ) ;
+
+    /** Remove all eigenverbs from this array. */
+    void clear() ;
+
+    /**
+     * Copy a single eigenverb out of this array. Reuses the memory for
+     * power in the destination if it is already the correct size.
+     *
+     * @param n         Index of the eigenverb to copy.
+     * @param verb      Destination for the copy (output).
+     */
+    void get( size_t n, eigenverb* verb ) const ;
+
+    /** One way travel time for this path (sec). */
+    double time( size_t n ) const { return _time[n] ; }
+
+    /**
+     * Fraction of total source level that reaches the ensonfied patch
+     * (linear units).  Returns a pointer to num_frequencies()
+     * contiguous values.
+     */
+    const double* power( size_t n ) const {
+        return &_power[ n * _num_freq ] ;
+    }
+
+    /** Largest value of power(n) across all frequencies (linear units). */
+    double max_power( size_t n ) const { return _max_power[n] ; }
+
+    /** Length of the D/E projection onto the interface (meters). */
+    double length( size_t n ) const { return _length[n] ; }
+
+    /** Square of the length (meters^2). */
+    double length2( size_t n ) const { return _length2[n] ; }
+
+    /** Width of the AZ projection onto the interface (meters). */
+    double width( size_t n ) const { return _width[n] ; }
+
+    /** Square of the width (meters^2). */
+    double width2( size_t n ) const { return _width2[n] ; }
+
+    /** Location of impact with the interface. */
+    const wposition1& position( size_t n ) const { return _position[n] ; }
+
+    /** Compass heading for the "length" axis (radians). */
+    double direction( size_t n ) const { return _direction[n] ; }
+
+    /** Grazing angle at impact (radians, positive is up). */
+    double grazing( size_t n ) const { return _grazing[n] ; }
+
+    /** Sound speed at the point of impact (m/s). */
+    double sound_speed( size_t n ) const { return _sound_speed[n] ; }
+
+    /**
+     * Horizontal slowness at the point of impact, cos(grazing)/sound_speed.
+     * Precomputed because it scales the duration of every overlap (sec/m).
+     */
+    double slowness( size_t n ) const { return _slowness[n] ; }
+
+    /** Index number of the launch DE. */
+    size_t de_index( size_t n ) const { return _de_index[n] ; }
+
+    /** Index number of the launch AZ. */
+    size_t az_index( size_t n ) const { return _az_index[n] ; }
+
+    /** D/E angle at launch (radians, positive is up). */
+    double source_de( size_t n ) const { return _source_de[n] ; }
+
+    /** AZ angle at launch (radians, clockwise from true north). */
+    double source_az( size_t n ) const { return _source_az[n] ; }
+
+    /** Number of interactions with the surface boundary. */
+    int surface( size_t n ) const { return _surface[n] ; }
+
+    /** Number of interactions with the bottom boundary. */
+    int bottom( size_t n ) const { return _bottom[n] ; }
+
+    /** Number of caustics encountered along this path. */
+    int caustic( size_t n ) const { return _caustic[n] ; }
+
+    /** Number of upper vertices encountered along this path. */
+    int upper( size_t n ) const { return _upper[n] ; }
+
+    /** Number of lower vertices encountered along this path. */
+    int lower( size_t n ) const { return _lower[n] ; }
+
+    /** Precomputed geometry of the footprint. */
+    const eigenverb_frame& frame( size_t n ) const { return _frame[n] ; }
+
+private:
+
+    /** Frequencies of the wavefront (Hz). */
+    const seq_vector* _frequencies ;
+
+    /** Number of frequencies for each eigenverb. */
+    size_t _num_freq ;
+
+    std::vector<double> _time ;         ///< travel time (sec)
+    std::vector<double> _power ;        ///< [eigenverb][frequency]
+    std::vector<double> _max_power ;    ///< peak power over frequency
+    std::vector<double> _length ;       ///< length (meters)
+    std::vector<double> _length2 ;      ///< length squared
+    std::vector<double> _width ;        ///< width (meters)
+    std::vector<double> _width2 ;       ///< width squared
+    std::vector<wposition1> _position ; ///< location of impact
+    std::vector<double> _direction ;    ///< heading of length axis (rad)
+    std::vector<double> _grazing ;      ///< grazing angle (rad)
+    std::vector<double> _sound_speed ;  ///< sound speed (m/s)
+    std::vector<double> _slowness ;     ///< cos(grazing)/sound_speed (s/m)
+    std::vector<size_t> _de_index ;     ///< launch D/E index
+    std::vector<size_t> _az_index ;     ///< launch AZ index
+    std::vector<double> _source_de ;    ///< launch D/E (rad)
+    std::vector<double> _source_az ;    ///< launch AZ (rad)
+    std::vector<int> _surface ;         ///< surface bounces
+    std::vector<int> _bottom ;          ///< bottom bounces
+    std::vector<int> _caustic ;         ///< caustics
+    std::vector<int> _upper ;           ///< upper vertices
+    std::vector<int> _lower ;           ///< lower vertices
+    std::vector<eigenverb_frame> _frame ; ///< precomputed geometry
+};
+
+/// @}
+}   // end of namespace eigenverb
+}   // end of namespace usml
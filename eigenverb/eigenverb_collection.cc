@@ -5,7 +5,10 @@
 #include <boost/foreach.hpp>
 #include <usml/types/seq_data.h>
 #include <usml/eigenverb/eigenverb_collection.h>
+#include <usml/eigenverb/eigenverb_interpolator.h>
 #include <netcdfcpp.h>
+#include <limits>
+#include <algorithm>
 
 using namespace usml::types;
 using namespace usml::eigenverb;
@@ -14,66 +17,330 @@ using namespace boost;
 // meters/degree  60 nmiles/degree * 1852 meters/nmiles
 double eigenverb_collection::latitude_scaler = (60.0 * 1852.0);
 
+double eigenverb_collection::merge_tolerance = 0.0;
+double eigenverb_collection::merge_angle = 1.0;		// degrees
+
+/**
+ * Wraps an angle difference into the range [-pi,pi].
+ */
+static inline double wrap_angle(double angle) {
+	return atan2(sin(angle), cos(angle));
+}
+
+/**
+ * Sorts eigenverb indices by travel time.
+ */
+struct time_order {
+	const eigenverb_array& verbs;
+	time_order(const eigenverb_array& v) : verbs(v) {}
+	bool operator()(size_t a, size_t b) const {
+		return verbs.time(a) < verbs.time(b);
+	}
+};
+
 /**
  * Builds a box to insert in an rtree and to query the rtree
  */
-box eigenverb_collection::build_box(eigenverb verb, float sigma) {
+box eigenverb_collection::build_box(const wposition1& position, double length,
+		double width, double min_time, double max_time,
+		double min_power, double max_power, float sigma) {
 	double q;
 	double latitude;
 	double longitude;
 	double delta_lat;
 	double delta_long;
 
-	q = max(verb.length, verb.width);
-	latitude = verb.position.latitude();
-	longitude = verb.position.longitude();
+	q = max(length, width);
+	latitude = position.latitude();
+	longitude = position.longitude();
 	delta_lat = (sigma * q) / latitude_scaler;
 	delta_long = (sigma * q) / (latitude_scaler * cos(to_radians(latitude)));
 
 	// create a box, first point bottom left, second point upper right
-	box b(point(latitude - delta_lat, longitude - delta_long),
-			point(latitude + delta_lat, longitude + delta_long));
+	point lower(latitude - delta_lat, longitude - delta_long, min_time);
+	bg::set<3>(lower, min_power);
+	point upper(latitude + delta_lat, longitude + delta_long, max_time);
+	bg::set<3>(upper, max_power);
+	box b(lower, upper);
 
 	return b;
 }
 
+/**
+ * Copies all of the eigenverbs from another collection onto the end of this one.
+ */
+void eigenverb_collection::append(const eigenverb_collection& other) {
+	eigenverb verb;
+	for (size_t n = 0; n < num_interfaces(); ++n) {
+		const eigenverb_array& verbs = other._collection[n];
+		for (size_t i = 0; i < verbs.size(); ++i) {
+			verbs.get(i, &verb);
+			_collection[n].push_back(verb);
+		}
+	}
+	rtrees_ready = false;
+}
+
 /**
  * Queries the RTree for this collection of eigenverbs at the interface and the
  * spatial box specified the rcv_eigenverb.
- * Results are return via the third parameter.
+ * Results are return via the last parameter.
  */
-void eigenverb_collection::query_rtree(size_t interface, eigenverb verb,
-		std::vector<value_pair>& result_s) {
+void eigenverb_collection::query_rtree(size_t interface,
+		const eigenverb_array& verbs, size_t n,
+		double min_time, double max_time, double min_power,
+		std::vector<value_pair>& result_s) const {
 	read_lock_guard guard(_rtree_mutex);
 	float scaling = 1.0;
-	box query_box = build_box(verb, scaling);
-	_rtrees[interface].query(bgi::within(query_box),
+	box query_box = build_box(verbs.position(n), verbs.length(n), verbs.width(n),
+			min_time, max_time, min_power,
+			std::numeric_limits<double>::max(), scaling);
+	_rtrees[interface].query(bgi::intersects(query_box),
 			std::back_inserter(result_s));
 }
+
 /**
- * Generates the rtrees for this collection of eigenverbs.
+ * Largest peak power of any eigenverb on an interface.
  */
-void eigenverb_collection::generate_rtrees() {
-	if (rtrees_ready) return;
-	write_lock_guard guard(_rtree_mutex);
+double eigenverb_collection::max_power(size_t interface) const {
+	read_lock_guard guard(_rtree_mutex);
+	if (_rtrees[interface].empty()) return 0.0;
+	return bg::get<3>(_rtrees[interface].bounds().max_corner());
+}
+/**
+ * Copy of this collection interpolated onto a new frequency axis.
+ */
+eigenverb_collection::reference eigenverb_collection::interpolated(
+		const seq_vector* frequencies) const {
+	write_lock_guard guard(_interpolated_mutex);
+
+	// search for an earlier copy on the same frequency axis
+
+	const std::vector<double> key(frequencies->data().begin(),
+			frequencies->data().end());
+	interpolated_entry* entry = NULL;
+	BOOST_FOREACH(interpolated_entry& e, _interpolated) {
+		if (e.key == key) {
+			entry = &e;
+			break;
+		}
+	}
+	if (entry == NULL) {
+		_interpolated.push_back(interpolated_entry());
+		entry = &_interpolated.back();
+		entry->key = key;
+		entry->frequencies.reset(frequencies->clone());
+		entry->verbs.reset(new eigenverb_collection(num_interfaces() / 2 - 1));
+	}
 
-	// Use local pair to package in rtree
-	std::list<value_pair> collection_pair;
+	// interpolate the eigenverbs added since the last call
+
+	eigenverb_collection& copy = *entry->verbs;
+	eigenverb verb;
+	verb.frequencies = entry->frequencies.get();
+	verb.power.resize(frequencies->size());
+	for (size_t n = 0; n < num_interfaces(); ++n) {
+		const eigenverb_array& verbs = _collection[n];
+		const size_t first = copy._collection[n].size();
+		if (first >= verbs.size()) continue;
+		eigenverb_interpolator interpolator(verbs.frequencies(), verb.frequencies);
+		copy._collection[n].reserve(verbs.size(), frequencies->size());
+		for (size_t i = first; i < verbs.size(); ++i) {
+			interpolator.interpolate(verbs, i, &verb);
+			copy.add_eigenverb(verb, n);
+		}
+	}
+	return entry->verbs;
+}
+
+/**
+ * Merges neighboring eigenverbs into composite Gaussian footprints.
+ */
+void eigenverb_collection::merge_eigenverbs() {
+	if (merge_tolerance <= 0.0) return;
+	write_lock_guard guard(_rtree_mutex);
+	{
+		write_lock_guard cache_guard(_interpolated_mutex);
+		_interpolated.clear();	// copies no longer match the eigenverbs
+	}
+	const double max_angle = to_radians(merge_angle);
 
+	std::vector<size_t> order;
+	std::vector<size_t> members;
+	std::vector<bool> used;
 	eigenverb verb;
-	eigenverb_list::iterator iter;
 
-	for (int n = 0; n < num_interfaces(); ++n) {
+	for (size_t n = 0; n < num_interfaces(); ++n) {
+		const eigenverb_array& verbs = _collection[n];
+		const size_t num_verbs = verbs.size();
+		if (num_verbs < 2) continue;
+
+		// visit eigenverbs in order of travel time
+
+		order.resize(num_verbs);
+		for (size_t i = 0; i < num_verbs; ++i) order[i] = i;
+		std::sort(order.begin(), order.end(), time_order(verbs));
+		used.assign(num_verbs, false);
+
+		eigenverb_array merged;
+		merged.reserve(num_verbs, verbs.num_frequencies());
+		for (size_t i = 0; i < num_verbs; ++i) {
+			const size_t seed = order[i];
+			if (used[seed]) continue;
+			used[seed] = true;
+			members.clear();
+			members.push_back(seed);
+
+			// search later eigenverbs within the time tolerance
+
+			const double distance = merge_tolerance
+					* min(verbs.length(seed), verbs.width(seed));
+			const double max_time = verbs.time(seed)
+					+ distance / verbs.sound_speed(seed);
+			for (size_t j = i + 1; j < num_verbs; ++j) {
+				const size_t k = order[j];
+				if (verbs.time(k) > max_time) break;
+				if (used[k]
+						|| verbs.az_index(k) != verbs.az_index(seed)
+						|| verbs.surface(k) != verbs.surface(seed)
+						|| verbs.bottom(k) != verbs.bottom(seed)
+						|| abs(verbs.grazing(k) - verbs.grazing(seed)) > max_angle
+						|| abs(wrap_angle(verbs.direction(k)
+								- verbs.direction(seed))) > max_angle
+						|| verbs.position(seed).gc_range(verbs.position(k))
+								> distance)
+				{
+					continue;
+				}
+				used[k] = true;
+				members.push_back(k);
+			}
+
+			if (members.size() == 1) {
+				verbs.get(seed, &verb);
+			} else {
+				combine_eigenverbs(verbs, members, &verb);
+			}
+			merged.push_back(verb);
+		}
+		_merged[n] += num_verbs - merged.size();
+		_collection[n] = merged;
+	}
+	rtrees_ready = false;
+}
+
+/**
+ * Combine a group of eigenverbs into a single composite eigenverb.
+ */
+void eigenverb_collection::combine_eigenverbs(const eigenverb_array& verbs,
+		const std::vector<size_t>& members, eigenverb* verb)
+{
+	const size_t seed = members.front();
+	const wposition1& origin = verbs.position(seed);
+	verbs.get(seed, verb);
+	std::fill(verb->power.begin(), verb->power.end(), 0.0);
+
+	// power weights, use equal weights if all members have zero power
+
+	std::vector<double> weight(members.size());
+	double total = 0.0;
+	for (size_t m = 0; m < members.size(); ++m) {
+		weight[m] = verbs.max_power(members[m]);
+		total += weight[m];
+	}
+	if (total <= 0.0) {
+		std::fill(weight.begin(), weight.end(), 1.0);
+		total = (double) members.size();
+	}
+
+	// sum power, and average everything else, relative to the seed
+
+	std::vector<double> east(members.size());
+	std::vector<double> north(members.size());
+	double time = 0.0, grazing = 0.0, sound_speed = 0.0, altitude = 0.0;
+	double source_de = 0.0, source_az = 0.0, direction = 0.0;
+	double east_mean = 0.0, north_mean = 0.0;
+	for (size_t m = 0; m < members.size(); ++m) {
+		const size_t k = members[m];
+		const double w = weight[m] / total;
+		const double* power = verbs.power(k);
+		for (size_t f = 0; f < verbs.num_frequencies(); ++f) {
+			verb->power[f] += power[f];
+		}
+		double bearing;
+		const double range = origin.gc_range(verbs.position(k), &bearing);
+		east[m] = range * sin(bearing);
+		north[m] = range * cos(bearing);
+		east_mean += w * east[m];
+		north_mean += w * north[m];
+		altitude += w * verbs.position(k).altitude();
+		time += w * verbs.time(k);
+		grazing += w * verbs.grazing(k);
+		sound_speed += w * verbs.sound_speed(k);
+		source_de += w * verbs.source_de(k);
+		source_az += w * wrap_angle(verbs.source_az(k) - verbs.source_az(seed));
+		direction += w * wrap_angle(verbs.direction(k) - verbs.direction(seed));
+	}
+	direction += verbs.direction(seed);
+
+	// second moments along and across the average direction
+
+	const double sin_dir = sin(direction);
+	const double cos_dir = cos(direction);
+	double length2 = 0.0, width2 = 0.0;
+	for (size_t m = 0; m < members.size(); ++m) {
+		const size_t k = members[m];
+		const double w = weight[m] / total;
+		const double alpha = verbs.direction(k) - direction;
+		const double cos2 = cos(alpha) * cos(alpha);
+		const double sin2 = 1.0 - cos2;
+		const double dx = east[m] - east_mean;
+		const double dy = north[m] - north_mean;
+		const double along = dx * sin_dir + dy * cos_dir;
+		const double across = dx * cos_dir - dy * sin_dir;
+		length2 += w * (verbs.length2(k) * cos2 + verbs.width2(k) * sin2
+				+ along * along);
+		width2 += w * (verbs.length2(k) * sin2 + verbs.width2(k) * cos2
+				+ across * across);
+	}
+
+	verb->time = time;
+	verb->length2 = length2;
+	verb->length = sqrt(length2);
+	verb->width2 = width2;
+	verb->width = sqrt(width2);
+	verb->position = wposition1(origin,
+			sqrt(east_mean * east_mean + north_mean * north_mean),
+			atan2(east_mean, north_mean));
+	verb->position.altitude(altitude);
+	verb->direction = direction;
+	verb->grazing = grazing;
+	verb->sound_speed = sound_speed;
+	verb->source_de = source_de;
+	verb->source_az = verbs.source_az(seed) + source_az;
+}
 
-		for (iter = _collection[n].begin(); iter != _collection[n].end();
-				++iter) {
+/**
+ * Generates the rtrees for this collection of eigenverbs.
+ */
+void eigenverb_collection::generate_rtrees() {
+	write_lock_guard guard(_rtree_mutex);
+	if (rtrees_ready) return;	// tested under lock, collection may be shared
+
+	// Use local pair to package in rtree
+	std::vector<value_pair> collection_pair;
 
-			verb = *iter;
+	for (size_t n = 0; n < num_interfaces(); ++n) {
 
+		const eigenverb_array& verbs = _collection[n];
+		collection_pair.reserve(verbs.size());
+		for (size_t i = 0; i < verbs.size(); ++i) {
+			const double time = verbs.time(i);
 			collection_pair.push_back(
 					std::make_pair(
-							point(verb.position.latitude(),
-									verb.position.longitude()), iter));
+							build_box(verbs.position(i), verbs.length(i),
+									verbs.width(i), time, time,
+									verbs.max_power(i), verbs.max_power(i)), i));
 		}
 		// Use Packed constructor of rtree for fastest insertion
 		_rtrees[n] = rtree_type(collection_pair.begin(), collection_pair.end());
@@ -89,7 +356,7 @@ void eigenverb_collection::write_netcdf(
 		const char* filename, size_t interface_num) const
 {
 	NcFile* nc_file = new NcFile(filename, NcFile::Replace);
-	const eigenverb_list& curr = _collection[interface_num];
+	const eigenverb_array& curr = _collection[interface_num];
 
 	switch (interface_num) {
 	case eigenverb::BOTTOM:
@@ -126,7 +393,7 @@ void eigenverb_collection::write_netcdf(
 		NcDim* eigenverb_dim = nc_file->add_dim("eigenverbs",
 				(long) curr.size());
 		NcDim* freq_dim = nc_file->add_dim("frequency",
-				(long) curr.begin()->frequencies->size());
+				(long) curr.num_frequencies());
 
 		// variables
 
@@ -191,10 +458,11 @@ void eigenverb_collection::write_netcdf(
 
 		// data
 
-		freq_var->put(curr.begin()->frequencies->data().begin(),
-				(long) curr.begin()->frequencies->size());
-		int record = 0;    // current record
-		BOOST_FOREACH( eigenverb verb, curr ) {
+		freq_var->put(curr.frequencies()->data().begin(),
+				(long) curr.num_frequencies());
+		eigenverb verb;
+		for (size_t record = 0; record < curr.size(); ++record) {
+			curr.get(record, &verb);
 
 			// sets current index
 
@@ -217,7 +485,6 @@ void eigenverb_collection::write_netcdf(
 			caustic_var->set_cur(record);
 			upper_var->set_cur(record);
 			lower_var->set_cur(record);
-			++record;
 
 			// inserts data
 
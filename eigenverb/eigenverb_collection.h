@@ -1,6 +1,6 @@
 /**
  * @file eigenverb_collection.h
- * Collection of eigenverbs in the form of a vector of eigenverbs_lists.
+ * Collection of eigenverbs in the form of a vector of eigenverb_arrays.
  */
 #pragma once
 
@@ -10,6 +10,7 @@
 #include <boost/geometry/index/rtree.hpp>
 #include <usml/threads/threads.h>
 #include <usml/eigenverb/eigenverb.h>
+#include <usml/eigenverb/eigenverb_array.h>
 #include <usml/eigenverb/eigenverb_listener.h>
 
 
@@ -22,16 +23,27 @@ namespace bgi = boost::geometry::index;
 namespace usml {
 namespace eigenverb {
 
-typedef bg::model::point<double, 2, bg::cs::cartesian > point;
+/**
+ * Rtree coordinate: latitude (deg), longitude (deg),
+ * one way travel time (sec), and peak power (linear units).
+ * Because each node of the rtree bounds the coordinates of its children,
+ * the upper corner of each node also records the maximum power of
+ * the eigenverbs in that subtree.
+ */
+typedef bg::model::point<double, 4, bg::cs::cartesian > point;
 
 typedef bg::model::box<point> box;
 
-typedef std::pair<point, eigenverb_list::iterator> value_pair;
+/**
+ * Rtree value: footprint of an eigenverb, at its travel time,
+ * and its index in the eigenverb_array for its interface.
+ */
+typedef std::pair<box, size_t> value_pair;
 
 typedef bgi::rtree<value_pair, bgi::rstar<16,4> > rtree_type;
 
 /**
- * Collection of eigenverbs in the form of a vector of eigenverbs_lists.
+ * Collection of eigenverbs in the form of a vector of eigenverb_arrays.
  * Each index represents a different interface.
  *
  *    - index=0 is eigenverbs for the bottom.
@@ -47,6 +59,22 @@ class USML_DECLSPEC eigenverb_collection : public eigenverb_listener {
 
 public:
 
+    /**
+     * Size of the neighborhood used to merge eigenverbs, as a ratio of
+     * the smaller of the length and width of each eigenverb.
+     * Eigenverbs whose peaks are closer than this distance, and whose travel
+     * times differ by less than the time needed for sound to cross this
+     * distance, are candidates for merging. Defaults to zero, which
+     * disables merge_eigenverbs().
+     */
+    static double merge_tolerance;
+
+    /**
+     * Maximum difference in grazing angle and direction between
+     * eigenverbs that are merged (degrees). Defaults to 1.0.
+     */
+    static double merge_angle;
+
     /**
      * Shared pointer reference to an eigenverb _collection.
      */
@@ -61,7 +89,8 @@ public:
      */
     eigenverb_collection(size_t num_volumes) :
             _rtrees((1 + num_volumes) * 2),
-            _collection((1 + num_volumes) * 2)
+            _collection((1 + num_volumes) * 2),
+            _merged((1 + num_volumes) * 2, 0)
     {
         rtrees_ready = false;
     }
@@ -88,7 +117,7 @@ public:
      *                     this number.  For some layers, you can also use the
      *                     eigenverb::interface_type.
      */
-    const eigenverb_list& eigenverbs(size_t interface) const {
+    const eigenverb_array& eigenverbs(size_t interface) const {
         return _collection[interface];
     }
 
@@ -104,22 +133,105 @@ public:
      */
     void add_eigenverb(const eigenverb& verb, size_t interface_num) {
         _collection[interface_num].push_back(verb);
+        rtrees_ready = false;   // rebuild rtrees to include this eigenverb
     }
 
+    /**
+     * Copies all of the eigenverbs from another collection onto
+     * the end of this one.  Both collections must have the same
+     * number of interfaces.
+     *
+     * @param other     Collection of eigenverbs to add to this one.
+     */
+    void append(const eigenverb_collection& other);
+
     /**
      * Queries the RTree for this collection of eigenverbs at the interface and the
      * spatial box specified the rcv_eigenverb.
-     * Results are return via the third parameter.
+     * Returns every eigenverb whose footprint intersects the footprint of
+     * the rcv_eigenverb, whose travel time falls in the range
+     * [min_time, max_time], and whose peak power is at least min_power.
+     * Because footprints are compared, large eigenverbs whose centers
+     * are outside of the receiver footprint are still found. Subtrees
+     * whose maximum power is below min_power are skipped without
+     * visiting their eigenverbs. Results are return via the last parameter.
      *
      * @param interface        Interface number of the desired list of eigenverbs.
      *                             See the class header for documentation on interpreting
      *                             this number. For some layers, you can also use the
      *                             eigenverb::interface_type.
-     * @param eigenverb        Eigenverb which to covert to a spatial box that
-     *                             is used as the query for the rtree.
+     * @param verbs            Contiguous storage for the receiver eigenverbs.
+     * @param n                Index of the eigenverb in verbs which to convert
+     *                             to a spatial box that is used as the query
+     *                             for the rtree.
+     * @param min_time         Earliest travel time of interest (sec).
+     * @param max_time         Latest travel time of interest (sec).
+     * @param min_power        Smallest peak power of interest (linear units).
      * @param result_s        This is the result set of value_pairs in and std::vector
      */
-    void query_rtree(size_t interface, eigenverb verb, std::vector<value_pair>& result_s);
+    void query_rtree(size_t interface, const eigenverb_array& verbs, size_t n,
+                     double min_time, double max_time, double min_power,
+                     std::vector<value_pair>& result_s) const;
+
+    /**
+     * Largest peak power of any eigenverb on an interface, taken
+     * from the bounds of its rtree. Only valid after generate_rtrees().
+     *
+     * @param interface        Interface number of the desired list of eigenverbs.
+     * @return                 Maximum power (linear units), or zero if
+     *                         there are no eigenverbs on this interface.
+     */
+    double max_power(size_t interface) const;
+
+    /**
+     * Merges neighboring eigenverbs into composite Gaussian footprints, to
+     * reduce the number of source/receiver pairs in the reverberation model.
+     * Eigenverbs are merged if they are within merge_tolerance of the
+     * earliest eigenverb in the group, have grazing angles and directions
+     * within merge_angle of it, and have the same launch AZ index and
+     * number of surface and bottom bounces.
+     *
+     * The power of the composite is the sum of the powers of its members,
+     * at each frequency, so that the total scattered energy is conserved.
+     * Its location, travel time, angles, and sound speed are power weighted
+     * averages. Its length and width are the square roots of the power
+     * weighted second moments of the group along and across the average
+     * direction, including the spread of the member locations. Integer
+     * attributes are copied from the earliest member.
+     *
+     * Must be called before generate_rtrees(). Does nothing if
+     * merge_tolerance is zero. Use envelope_collection::compare() to
+     * measure the effect of merging on the reverberation envelopes.
+     */
+    void merge_eigenverbs();
+
+    /**
+     * Copy of this collection with the frequency dependent terms of each
+     * eigenverb interpolated onto a new frequency axis.  Used by the
+     * envelope_generator to put receiver eigenverbs onto the frequencies
+     * of each sensor_pair.
+     *
+     * The copies are cached for each frequency axis, so that all of the
+     * sensor_pairs that share this receiver, and later runs of each pair,
+     * reuse the same interpolation.  Because eigenverbs are only appended
+     * by add_eigenverb() and append(), each call only interpolates the
+     * eigenverbs added since the previous call. The cache is cleared by
+     * merge_eigenverbs(), which replaces the eigenverbs, and is discarded
+     * with this collection when a new wavefront replaces it.
+     *
+     * @param frequencies   New frequency axis (Hz).
+     * @return              Eigenverbs on the new frequency axis.
+     */
+    reference interpolated(const seq_vector* frequencies) const;
+
+    /**
+     * Number of eigenverbs removed from an interface by merge_eigenverbs().
+     *
+     * @param interface        Interface number of the desired list of eigenverbs.
+     */
+    size_t merged(size_t interface) const {
+        return _merged[interface];
+    }
 
     /**
      * Generates the rtrees for this collection of eigenverbs.
@@ -127,9 +239,12 @@ public:
      * for each collection interface. The rtrees are created with the dual
      * Iterator constructor, which uses the RTree Packing Algorithm
      * to provide the fastest insertion of the data and the fastest querying.
-     * A std::list is first populated with a "collection_pair"'s. A
-     * collection_pair is a std::pair type that consit of a point (lat, lon)
-     * and the eigenverb_list::iterator of the eigenverb_collection.
+     * A std::vector is first populated with a "collection_pair"'s. A
+     * collection_pair is a std::pair type that consit of the footprint of
+     * the eigenverb, as a box in (lat, lon, time, power) with zero
+     * extent in time and power,
+     * and the index of the eigenverb in the eigenverb_array for that
+     * interface.
      * See http://www.boost.org/doc/libs/1_58_0/libs/geometry/doc/html/geometry/spatial_indexes/introduction.html
      */
     void generate_rtrees();
@@ -242,14 +357,40 @@ private:
 
     /**
      * Builds a box to insert in an rtree and/or to query the rtree.
+     * The spatial extent is the larger of the length and width
+     * of the eigenverb in all directions.
      *
-     * @param  eigenverb    Eigenverb which to covert to a box.
+     * @param  position     Location of the eigenverb.
+     * @param  length       Length of the eigenverb (meters).
+     * @param  width        Width of the eigenverb (meters).
+     * @param  min_time     Lower limit of the box in travel time (sec).
+     * @param  max_time     Upper limit of the box in travel time (sec).
+     * @param  min_power    Lower limit of the box in power (linear units).
+     * @param  max_power    Upper limit of the box in power (linear units).
      * @param  sigma        Integer amount to scale up the size of the box.
      */
-    box build_box(eigenverb verb, float sigma = 1);
+    static box build_box(const wposition1& position, double length,
+                         double width, double min_time, double max_time,
+                         double min_power, double max_power,
+                         float sigma = 1);
+
+    /**
+     * Combine a group of eigenverbs into a single composite eigenverb.
+     * See merge_eigenverbs() for the rules used to combine attributes.
+     *
+     * @param verbs         Eigenverbs for a single interface.
+     * @param members       Indices of the eigenverbs to combine.
+     *                      The first member is used as the reference.
+     * @param verb          Composite eigenverb (output).
+     */
+    static void combine_eigenverbs(const eigenverb_array& verbs,
+                                   const std::vector<size_t>& members,
+                                   eigenverb* verb);
 
     /**
      * Boolean to determine if the rtree have all ready been generated.
+     * Only read or written by generate_rtrees() while holding _rtree_mutex,
+     * or by the methods that add eigenverbs before the collection is shared.
      */
     bool rtrees_ready;
 
@@ -264,9 +405,39 @@ private:
     std::vector<rtree_type> _rtrees;
 
     /**
-     * Collection of eigenverbs.
+     * Collection of eigenverbs, stored contiguously for each interface.
+     */
+    std::vector<eigenverb_array> _collection;
+
+    /**
+     * Number of eigenverbs removed from each interface by merge_eigenverbs().
+     */
+    std::vector<size_t> _merged;
+
+    /**
+     * Copy of this collection on a different frequency axis.
+     */
+    struct interpolated_entry {
+
+        /** Values of the new frequency axis, used to find the entry. */
+        std::vector<double> key;
+
+        /** New frequency axis, shared by all of the copied eigenverbs. */
+        boost::shared_ptr<seq_vector> frequencies;
+
+        /** Eigenverbs interpolated onto the new frequency axis. */
+        reference verbs;
+    };
+
+    /**
+     * Cache of the copies created by interpolated().
+     */
+    mutable std::vector<interpolated_entry> _interpolated;
+
+    /**
+     * Mutex that locks the cache of interpolated copies.
      */
-    std::vector<eigenverb_list> _collection;
+    mutable read_write_lock _interpolated_mutex;
 };
 
 }   // end of namespace waveq3d
@@ -62,3 +62,48 @@ void eigenverb_interpolator::interpolate(
 		new_verb->power[f] = _power_interp->interpolate(location);
 	}
 }
+
+/**
+ * Interpolate frequency dependent terms of an eigenverb, stored in
+ * contiguous storage, onto a new frequency axis.
+ */
+void eigenverb_interpolator::interpolate(
+		const eigenverb_array& verbs, size_t n, eigenverb* new_verb)
+{
+	// fill the interpolating data_grids with data
+
+	const double* power = verbs.power(n) ;
+	for (size_t f = 0; f < _freq_size; ++f) {
+		size_t index[1] = { f };
+		_power_interp->data(index, power[f]);
+	}
+
+	// copy terms that are not frequency dependent
+
+	new_verb->length = verbs.length(n) ;
+	new_verb->length2 = verbs.length2(n) ;
+	new_verb->width = verbs.width(n) ;
+	new_verb->width2 = verbs.width2(n) ;
+	new_verb->time = verbs.time(n) ;
+	new_verb->position = verbs.position(n) ;
+	new_verb->direction = verbs.direction(n) ;
+	new_verb->grazing = verbs.grazing(n) ;
+	new_verb->sound_speed = verbs.sound_speed(n) ;
+	new_verb->de_index = verbs.de_index(n) ;
+	new_verb->az_index = verbs.az_index(n) ;
+	new_verb->source_de = verbs.source_de(n) ;
+	new_verb->source_az = verbs.source_az(n) ;
+	new_verb->surface = verbs.surface(n) ;
+	new_verb->bottom = verbs.bottom(n) ;
+	new_verb->caustic = verbs.caustic(n) ;
+	new_verb->upper = verbs.upper(n) ;
+	new_verb->lower = verbs.lower(n) ;
+
+	// interpolate results to new frequency axis
+	// assume that calling routine has set new_verb->freq
+
+	for (size_t f = 0; f < _new_freq->size(); ++f) {
+		double location[1] = { (*_new_freq)[f] };
+		new_verb->power[f] = _power_interp->interpolate(location);
+	}
+}
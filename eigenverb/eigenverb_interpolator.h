@@ -5,6 +5,7 @@
 #pragma once
 
 #include <usml/eigenverb/eigenverb.h>
+#include <usml/eigenverb/eigenverb_array.h>
 #include <usml/types/data_grid.h>
 
 namespace usml {
@@ -46,6 +47,17 @@ public:
      */
     void interpolate( const eigenverb& verb, eigenverb* new_verb ) ;
 
+    /**
+     * Interpolate frequency dependent terms of an eigenverb, stored in
+     * contiguous storage, onto a new frequency axis.  Avoids making
+     * a temporary copy of the original eigenverb.
+     *
+     * @param verbs        Contiguous storage for original eigenverbs.
+     * @param n            Index of the eigenverb to be interpolated.
+     * @param new_verb     Eigenverb after interpolation.
+     */
+    void interpolate( const eigenverb_array& verbs, size_t n, eigenverb* new_verb ) ;
+
 private:
     size_t _freq_size ;
     const seq_vector* _new_freq ;
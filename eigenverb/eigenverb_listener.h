@@ -40,6 +40,23 @@ public:
      */
     virtual void add_eigenverb(const eigenverb& verb, size_t interface_num) = 0;
 
+    /**
+     * Adds all of the eigenverbs produced by a wavefront time step.
+     * The eigenverbs are owned by the wave_queue and are only valid for
+     * the duration of this call.  The default implementation forwards
+     * each one to add_eigenverb().  Sub-classes may override it to
+     * process the whole step in bulk.
+     *
+     *  @param  verbs     - Array of eigenverbs, and their interface
+     *                      numbers, for this step.
+     *  @param  count     - Number of eigenverbs in the array.
+     */
+    virtual void add_eigenverbs(const interface_eigenverb* verbs, size_t count) {
+        for ( size_t n=0 ; n < count ; ++n ) {
+            add_eigenverb( verbs[n].verb, verbs[n].interface_num ) ;
+        }
+    }
+
 protected:
 
     /**
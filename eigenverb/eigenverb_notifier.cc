@@ -30,3 +30,11 @@ void eigenverb_notifier::notify_eigenverb_listeners( const eigenverb& verb, size
 	}
 }
 
+/**
+ * Distribute all of the eigenverbs for a time step to all listeners.
+ */
+void eigenverb_notifier::notify_eigenverb_listeners( const interface_eigenverb* verbs, size_t count ) {
+	BOOST_FOREACH( eigenverb_listener* listener, _listeners ) {
+		listener->add_eigenverbs(verbs, count) ;
+	}
+}
@@ -34,6 +34,12 @@ public:
      */
     void notify_eigenverb_listeners( const eigenverb& verb, size_t interface_num) ;
 
+    /**
+     * Distribute all of the eigenverbs for a time step to all listeners.
+     * Makes a single call to each listener, without copying the eigenverbs.
+     */
+    void notify_eigenverb_listeners( const interface_eigenverb* verbs, size_t count ) ;
+
     /**
      * Determines if any listeners exist
      * @return true when listeners exist, false otherwise.
@@ -0,0 +1,118 @@
+/**
+ * @file eigenverb_stream.cc
+ * Time ordered channel that passes eigenverbs from a running
+ * wavefront to the reverberation model.
+ */
+#include <usml/eigenverb/eigenverb_stream.h>
+#include <boost/thread/locks.hpp>
+#include <limits>
+
+using namespace usml::eigenverb ;
+
+/**
+ * Construct a stream for a specific scenario.
+ */
+eigenverb_stream::eigenverb_stream( size_t num_volumes ) :
+    _verbs( (1 + num_volumes) * 2 ),
+    _watermark( 0.0 ),
+    _closed( false ),
+    _aborted( false )
+{
+}
+
+/**
+ * Adds a single eigenverb to the stream.
+ */
+void eigenverb_stream::add_eigenverb( const eigenverb& verb, size_t interface_num ) {
+    boost::lock_guard<boost::mutex> guard( _mutex ) ;
+    _verbs[interface_num].push_back( verb ) ;
+}
+
+/**
+ * Adds all of the eigenverbs produced by a wavefront time step.
+ */
+void eigenverb_stream::add_eigenverbs( const interface_eigenverb* verbs, size_t count ) {
+    {
+        boost::lock_guard<boost::mutex> guard( _mutex ) ;
+        for ( size_t n=0 ; n < count ; ++n ) {
+            _verbs[ verbs[n].interface_num ].push_back( verbs[n].verb ) ;
+        }
+    }
+    _ready.notify_all() ;
+}
+
+/**
+ * Advance the watermark to a new travel time.
+ */
+void eigenverb_stream::advance( double time ) {
+    {
+        boost::lock_guard<boost::mutex> guard( _mutex ) ;
+        if ( _closed || time <= _watermark ) return ;
+        _watermark = time ;
+    }
+    _ready.notify_all() ;
+}
+
+/**
+ * Signals that no more eigenverbs will be added.
+ */
+void eigenverb_stream::close( bool aborted ) {
+    {
+        boost::lock_guard<boost::mutex> guard( _mutex ) ;
+        _watermark = std::numeric_limits<double>::max() ;
+        _closed = true ;
+        _aborted = aborted ;
+    }
+    _ready.notify_all() ;
+}
+
+/**
+ * Waits until the watermark reaches a specific time.
+ */
+bool eigenverb_stream::wait( double time, long msec ) {
+    boost::unique_lock<boost::mutex> guard( _mutex ) ;
+    if ( _watermark < time ) {
+        _ready.timed_wait( guard, boost::posix_time::milliseconds(msec) ) ;
+    }
+    return _watermark >= time ;
+}
+
+/**
+ * Travel time before which all eigenverbs have been added.
+ */
+double eigenverb_stream::watermark() const {
+    boost::lock_guard<boost::mutex> guard( _mutex ) ;
+    return _watermark ;
+}
+
+/**
+ * True if no more eigenverbs will be added.
+ */
+bool eigenverb_stream::closed() const {
+    boost::lock_guard<boost::mutex> guard( _mutex ) ;
+    return _closed ;
+}
+
+/**
+ * True if the wavefront that feeds this stream was aborted.
+ */
+bool eigenverb_stream::aborted() const {
+    boost::lock_guard<boost::mutex> guard( _mutex ) ;
+    return _aborted ;
+}
+
+/**
+ * Copies the eigenverbs added after a specific index.
+ */
+size_t eigenverb_stream::read( size_t interface_num, size_t first,
+    eigenverb_collection* collection ) const
+{
+    boost::lock_guard<boost::mutex> guard( _mutex ) ;
+    const eigenverb_array& verbs = _verbs[interface_num] ;
+    eigenverb verb ;
+    for ( size_t n=first ; n < verbs.size() ; ++n ) {
+        verbs.get( n, &verb ) ;
+        collection->add_eigenverb( verb, interface_num ) ;
+    }
+    return verbs.size() ;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file eigenverb_stream.h
+ * Time ordered channel that passes eigenverbs from a running
+ * wavefront to the reverberation model.
+ */
+#pragma once
+
+#include <usml/eigenverb/eigenverb_array.h>
+#include <usml/eigenverb/eigenverb_collection.h>
+#include <usml/eigenverb/eigenverb_listener.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <vector>
+
+namespace usml {
+namespace eigenverb {
+
+/// @ingroup eigenverb
+/// @{
+
+/**
+ * Time ordered channel that passes eigenverbs from a running
+ * wavefront to the reverberation model.  The wave_queue adds eigenverbs
+ * to the stream as a listener, in the same way that it adds them to an
+ * eigenverb_collection, while the wavefront_generator advances the
+ * stream's watermark after each time step.  The watermark is the
+ * one way travel time before which all eigenverbs have been added.
+ * Because the early part of the reverberation envelope only depends on
+ * early eigenverbs, a consumer can compute envelope contributions for
+ * all eigenverbs below the watermark before the wavefront is finished.
+ *
+ * Eigenverbs are only appended, so each consumer keeps track of the
+ * number of eigenverbs that it has already read from each interface.
+ * The stream is shared between the producer and its consumers, and is
+ * safe to use from multiple threads.
+ */
+class USML_DECLSPEC eigenverb_stream : public eigenverb_listener {
+
+public:
+
+    /**
+     * Shared pointer reference to an eigenverb_stream.
+     */
+    typedef boost::shared_ptr<eigenverb_stream> reference;
+
+    /**
+     * Construct a stream for a specific scenario.  Creates a minimum
+     * of interfaces (index 0=bottom, 1=surface), plus two for each
+     * volume scattering layer.
+     *
+     * @param num_volumes    Number of volume scattering layers in the ocean.
+     */
+    eigenverb_stream(size_t num_volumes) ;
+
+    /** Number of interfaces in this stream. */
+    size_t num_interfaces() const {
+        return _verbs.size() ;
+    }
+
+    /**
+     * Number of volume scattering layers in the ocean.
+     */
+    size_t num_volumes() const {
+        return _verbs.size() / 2 - 1 ;
+    }
+
+    /**
+     * Adds a single eigenverb to the stream.
+     *
+     * @param verb              Eigenverb to add.
+     * @param interface_num     Interface number for this eigenverb.
+     */
+    virtual void add_eigenverb(const eigenverb& verb, size_t interface_num) ;
+
+    /**
+     * Adds all of the eigenverbs produced by a wavefront time step,
+     * and wakes up any consumers waiting for them.
+     *
+     * @param verbs     Array of eigenverbs, and their interface numbers.
+     * @param count     Number of eigenverbs in the array.
+     */
+    virtual void add_eigenverbs(const interface_eigenverb* verbs, size_t count) ;
+
+    /**
+     * Advance the watermark to a new travel time.  Called by the producer
+     * when all eigenverbs before this time have been added.
+     *
+     * @param time      New watermark (sec).
+     */
+    void advance(double time) ;
+
+    /**
+     * Signals that no more eigenverbs will be added.
+     *
+     * @param aborted   True if the wavefront did not finish, and the
+     *                  eigenverbs in this stream are incomplete.
+     */
+    void close(bool aborted = false) ;
+
+    /**
+     * Waits until the watermark reaches a specific time,
+     * the stream is closed, or the timeout expires.
+     *
+     * @param time      Watermark needed by the consumer (sec).
+     * @param msec      Maximum time to wait (milliseconds).
+     * @return          True if the watermark has reached this time,
+     *                  or if the stream is closed.
+     */
+    bool wait(double time, long msec) ;
+
+    /**
+     * Travel time before which all eigenverbs have been added (sec).
+     * Set to the largest double value once the stream is closed.
+     */
+    double watermark() const ;
+
+    /** True if no more eigenverbs will be added. */
+    bool closed() const ;
+
+    /** True if the wavefront that feeds this stream was aborted. */
+    bool aborted() const ;
+
+    /**
+     * Copies the eigenverbs for one interface, that were added after a
+     * specific index, into an eigenverb_collection.
+     *
+     * @param interface_num     Interface number of the eigenverbs to copy.
+     * @param first             Number of eigenverbs already read.
+     * @param collection        Destination for the new eigenverbs.
+     * @return                  Number of eigenverbs read so far,
+     *                          used as "first" in the next call.
+     */
+    size_t read(size_t interface_num, size_t first,
+                eigenverb_collection* collection) const ;
+
+private:
+
+    /** Eigenverbs for each interface, in the order they were added. */
+    std::vector<eigenverb_array> _verbs ;
+
+    /** Travel time before which all eigenverbs have been added (sec). */
+    double _watermark ;
+
+    /** True if no more eigenverbs will be added. */
+    bool _closed ;
+
+    /** True if the wavefront that feeds this stream was aborted. */
+    bool _aborted ;
+
+    /** Mutex that locks the stream during updates and reads. */
+    mutable boost::mutex _mutex ;
+
+    /** Wakes up consumers when the watermark advances. */
+    boost::condition_variable _ready ;
+};
+
+/// @}
+}   // end of namespace eigenverb
+}   // end of namespace usml
@@ -0,0 +1,174 @@
+/**
+ * @file envelope_bins.cc
+ * Reverberation intensities binned by launch angle, before beam
+ * patterns are applied.
+ */
+#include <usml/eigenverb/envelope_bins.h>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+using namespace usml::eigenverb ;
+
+double envelope_bins::de_spacing = 5.0 ;	// degrees
+double envelope_bins::az_spacing = 10.0 ;	// degrees
+
+/**
+ * Marker in the table of block locations for blocks without contributions.
+ */
+const size_t envelope_bins::inactive = std::numeric_limits<size_t>::max() ;
+
+/**
+ * Create empty bins for a collection of envelopes.
+ */
+envelope_bins::envelope_bins( size_t num_freq, size_t num_times,
+	size_t num_azimuths, size_t block_size
+) :
+	_num_freq( num_freq ),
+	_num_times( num_times ),
+	_num_azimuths( num_azimuths ),
+	_block_size( std::max( block_size, (size_t) 1 ) ),
+	_num_blocks( ( num_times + _block_size - 1 ) / _block_size ),
+	_block_stride( num_freq * _block_size ),
+	_de_spacing( de_spacing ),
+	_az_spacing( az_spacing ),
+	_num_de( std::max( (size_t) ceil( 180.0 / de_spacing - 1e-9 ), (size_t) 1 ) ),
+	_num_az( std::max( (size_t) ceil( 360.0 / az_spacing - 1e-9 ), (size_t) 1 ) )
+{
+}
+
+/**
+ * Copy the bins from another collection.
+ */
+envelope_bins::envelope_bins( const envelope_bins& other ) :
+	_num_freq( other._num_freq ),
+	_num_times( other._num_times ),
+	_num_azimuths( other._num_azimuths ),
+	_block_size( other._block_size ),
+	_num_blocks( other._num_blocks ),
+	_block_stride( other._block_stride ),
+	_de_spacing( other._de_spacing ),
+	_az_spacing( other._az_spacing ),
+	_num_de( other._num_de ),
+	_num_az( other._num_az )
+{
+	read_lock_guard guard( other._mutex ) ;
+	_index = other._index ;
+	_envelopes = other._envelopes ;
+	_blocks = other._blocks ;
+	_pool = other._pool ;
+}
+
+/**
+ * Launch angle bin that contains a specific direction.
+ */
+size_t envelope_bins::bin( double de, double az ) const {
+	double x = ( to_degrees(de) + 90.0 ) / _de_spacing ;
+	const size_t d = std::min( (size_t) std::max( x, 0.0 ), _num_de - 1 ) ;
+
+	double y = fmod( to_degrees(az), 360.0 ) ;	// wraps at 360 deg
+	if ( y < 0.0 ) y += 360.0 ;
+	const size_t a = std::min( (size_t) ( y / _az_spacing ), _num_az - 1 ) ;
+	return d * _num_az + a ;
+}
+
+/**
+ * Launch angle at the center of a bin.
+ */
+void envelope_bins::center( size_t bin, double* de, double* az ) const {
+	const size_t d = bin / _num_az ;
+	const size_t a = bin % _num_az ;
+	*de = to_radians( std::min( -90.0 + ( d + 0.5 ) * _de_spacing, 90.0 ) ) ;
+	*az = to_radians( std::min( ( a + 0.5 ) * _az_spacing, 360.0 ) ) ;
+}
+
+/**
+ * Row of block locations for one combination, created if needed.
+ */
+size_t* envelope_bins::allocate_envelope( size_t key ) {
+	std::map< size_t, size_t >::iterator iter = _index.lower_bound( key ) ;
+	if ( iter == _index.end() || iter->first != key ) {
+		iter = _index.insert( iter, std::make_pair( key, _envelopes.size() ) ) ;
+		_envelopes.push_back( key ) ;
+		_blocks.resize( _blocks.size() + _num_blocks, inactive ) ;
+	}
+	return &_blocks[ iter->second * _num_blocks ] ;
+}
+
+/**
+ * Storage for one block, allocated from the pool if needed.
+ */
+envelope_bins::value_type* envelope_bins::allocate_block( size_t& location ) {
+	if ( location == inactive ) {
+		location = _pool.size() ;
+		_pool.resize( _pool.size() + _block_stride, 0.0 ) ;
+	}
+	return &_pool[location] ;
+}
+
+/**
+ * Adds a portion of an intensity time series to one bin.
+ */
+void envelope_bins::accumulate( size_t azimuth, size_t src_bin, size_t rcv_bin,
+	const matrix<double>& intensity, size_t first, size_t last )
+{
+	if ( last <= first ) return ;
+	const size_t first_block = first / _block_size ;
+	const size_t last_block = ( last - 1 ) / _block_size ;
+	write_lock_guard guard( _mutex ) ;
+	size_t* row = allocate_envelope( key( azimuth, src_bin, rcv_bin ) ) ;
+	for ( size_t b=first_block ; b <= last_block ; ++b ) {
+
+		// portion of the time series in this block
+
+		const size_t start = b * _block_size ;
+		const size_t t1 = std::max( first, start ) ;
+		const size_t t2 = std::min( last, start + _block_size ) ;
+		value_type* block = allocate_block( row[b] ) ;
+		for ( size_t f=0 ; f < _num_freq ; ++f ) {
+			const double* level = &intensity(f, t1) ;
+			value_type* row = block + f * _block_size + ( t1 - start ) ;
+			for ( size_t t=0 ; t < t2 - t1 ; ++t ) {
+				row[t] += level[t] ;
+			}
+		}
+	}
+}
+
+/**
+ * Adds the bins from another collection to this one.
+ */
+void envelope_bins::add_bins( const envelope_bins& other, double scale ) {
+	if ( other._block_stride != _block_stride
+		|| other._num_blocks != _num_blocks
+		|| other._num_azimuths != _num_azimuths
+		|| other.num_bins() != num_bins() )
+	{
+		throw std::invalid_argument("envelope bin dimensions do not match") ;
+	}
+	write_lock_guard guard( _mutex ) ;
+	for ( size_t n=0 ; n < other._envelopes.size() ; ++n ) {
+		size_t* row = allocate_envelope( other._envelopes[n] ) ;
+		for ( size_t b=0 ; b < _num_blocks ; ++b ) {
+			const value_type* theirs = other.block( n, b ) ;
+			if ( theirs == NULL ) continue ;
+			value_type* mine = allocate_block( row[b] ) ;
+			for ( size_t i=0 ; i < _block_stride ; ++i ) {
+				mine[i] += scale * theirs[i] ;
+			}
+		}
+	}
+}
+
+/**
+ * Indices of an active combination.
+ */
+void envelope_bins::decode( size_t envelope, size_t* azimuth, size_t* src_bin,
+	size_t* rcv_bin ) const
+{
+	size_t key = _envelopes[envelope] ;
+	*rcv_bin = key % num_bins() ;
+	key /= num_bins() ;
+	*src_bin = key % num_bins() ;
+	*azimuth = key / num_bins() ;
+}
@@ -0,0 +1,293 @@
+/**
+ * @file envelope_bins.h
+ * Reverberation intensities binned by launch angle, before beam
+ * patterns are applied.
+ */
+#pragma once
+
+#include <usml/usml_config.h>
+#include <usml/types/seq_vector.h>
+#include <usml/threads/read_write_lock.h>
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <vector>
+
+namespace usml {
+namespace eigenverb {
+
+using namespace usml::types;
+using namespace usml::threads;
+
+/// @ingroup eigenverb
+/// @{
+
+/**
+ * Reverberation intensities binned by launch angle, before beam
+ * patterns are applied. Each contribution is added to the bin for its
+ * receiver azimuth number, the launch angle of its source eigenverb,
+ * and the launch angle of its receiver eigenverb.  Each launch angle bin
+ * spans de_spacing degrees of depression/elevation and az_spacing degrees
+ * of azimuth.
+ *
+ * Because the beam levels only depend on the launch angles, the envelopes
+ * for any set of source and receiver beams, and any sensor orientation,
+ * can then be rebuilt as a weighted sum of these bins, without repeating
+ * the eigenverb pair search.  The beam levels of each bin are evaluated at
+ * the center of the bin, so the accuracy of the rebuilt envelopes depends on
+ * the bin spacing relative to the width of the beam patterns.
+ *
+ * Like envelope_collection, the travel time axis is divided into blocks,
+ * and storage is only allocated for the blocks that receive a contribution.
+ * Each block is organized as [frequency][time].  Because most combinations
+ * of azimuth and launch angle bins never receive a contribution, the blocks
+ * are found through a sparse index, that maps each active combination of
+ * azimuth, source bin, and receiver bin onto a row in a flat table.  Each
+ * row has the pool location of each block.  Memory use therefore grows
+ * with the number of active combinations, not with the number of
+ * possible combinations.
+ *
+ * Contributions may be added by several threads at once, so that all of
+ * the partitions of an envelope_generator can share one set of bins.
+ * The order of summation then depends on the threads, and the bins
+ * are only reproducible to within round-off error.
+ */
+class USML_DECLSPEC envelope_bins {
+
+public:
+
+    /**
+     * Data type used for reference to an envelope_bins.
+     */
+    typedef boost::shared_ptr<envelope_bins> reference;
+
+    /**
+     * Data type used to store binned intensities.
+     */
+#ifdef USML_ENVELOPE_FLOAT
+    typedef float value_type ;
+#else
+    typedef double value_type ;
+#endif
+
+    /**
+     * Marker in the table of block locations for blocks that have
+     * not received any contributions.
+     */
+    static const size_t inactive ;
+
+    /**
+     * Width of the depression/elevation launch angle bins (deg).
+     * Only affects bins constructed after it is changed. Defaults to 5.0.
+     */
+    static double de_spacing ;
+
+    /**
+     * Width of the azimuthal launch angle bins (deg).
+     * Only affects bins constructed after it is changed. Defaults to 10.0.
+     */
+    static double az_spacing ;
+
+    /**
+     * Create empty bins for a collection of envelopes.
+     *
+     * @param num_freq      Number of envelope frequencies.
+     * @param num_times     Number of travel times.
+     * @param num_azimuths  Number of receiver azimuths.
+     * @param block_size    Number of travel times in each block.
+     */
+    envelope_bins( size_t num_freq, size_t num_times,
+                   size_t num_azimuths, size_t block_size ) ;
+
+    /**
+     * Copy the bins from another collection.
+     *
+     * @param other     Collection of bins to copy.
+     */
+    envelope_bins( const envelope_bins& other ) ;
+
+    /** Number of launch angle bins for each sensor. */
+    size_t num_bins() const {
+        return _num_de * _num_az ;
+    }
+
+    /** Number of blocks needed to span the travel times. */
+    size_t num_blocks() const {
+        return _num_blocks ;
+    }
+
+    /** Number of travel times in each block. */
+    size_t block_size() const {
+        return _block_size ;
+    }
+
+    /** Number of blocks that have received contributions. */
+    size_t active_blocks() const {
+        return _pool.size() / _block_stride ;
+    }
+
+    /**
+     * Number of combinations of azimuth, source bin, and receiver bin
+     * that have received contributions.
+     */
+    size_t active_envelopes() const {
+        return _envelopes.size() ;
+    }
+
+    /**
+     * Launch angle bin that contains a specific direction.
+     *
+     * @param de        Depression/Elevation angle (rad).
+     * @param az        Azimuthal angle (rad).
+     */
+    size_t bin( double de, double az ) const ;
+
+    /**
+     * Launch angle at the center of a bin.
+     *
+     * @param bin       Launch angle bin number.
+     * @param de        Depression/Elevation angle (rad, output).
+     * @param az        Azimuthal angle (rad, output).
+     */
+    void center( size_t bin, double* de, double* az ) const ;
+
+    /**
+     * Adds a portion of an intensity time series to one bin.
+     * Safe to call from several threads at once.
+     *
+     * @param azimuth   Receiver azimuth number.
+     * @param src_bin   Launch angle bin of the source eigenverb.
+     * @param rcv_bin   Launch angle bin of the receiver eigenverb.
+     * @param intensity Intensity at each envelope frequency (rows)
+     *                  and travel time (columns).
+     * @param first     First travel time index to add.
+     * @param last      One past the last travel time index to add.
+     */
+    void accumulate( size_t azimuth, size_t src_bin, size_t rcv_bin,
+        const matrix<double>& intensity, size_t first, size_t last ) ;
+
+    /**
+     * Adds the bins from another collection to this one.
+     * Both collections must have the same dimensions.
+     *
+     * @param other     Collection of bins to add to this one.
+     * @param scale     Scale factor applied to the other bins.
+     */
+    void add_bins( const envelope_bins& other, double scale = 1.0 ) ;
+
+    /**
+     * Storage for one block of an active combination, organized as
+     * [frequency][time], or NULL if this block is zero.
+     *
+     * @param envelope  Active combination number, less than
+     *                  active_envelopes().
+     * @param block     Block number along the travel time axis.
+     */
+    const value_type* block( size_t envelope, size_t block ) const {
+        const size_t location = _blocks[ envelope * _num_blocks + block ] ;
+        return ( location == inactive ) ? NULL : &_pool[location] ;
+    }
+
+    /**
+     * Indices of an active combination.
+     *
+     * @param envelope  Active combination number, less than
+     *                  active_envelopes().
+     * @param azimuth   Receiver azimuth number (output).
+     * @param src_bin   Launch angle bin of the source (output).
+     * @param rcv_bin   Launch angle bin of the receiver (output).
+     */
+    void decode( size_t envelope, size_t* azimuth, size_t* src_bin,
+                 size_t* rcv_bin ) const ;
+
+private:
+
+    /**
+     * Index of one combination in the table of combinations.
+     *
+     * @param azimuth   Receiver azimuth number.
+     * @param src_bin   Launch angle bin of the source.
+     * @param rcv_bin   Launch angle bin of the receiver.
+     */
+    size_t key( size_t azimuth, size_t src_bin, size_t rcv_bin ) const {
+        return ( azimuth * num_bins() + src_bin ) * num_bins() + rcv_bin ;
+    }
+
+    /**
+     * Row of block locations for one combination, created
+     * if this combination has not received contributions yet.
+     * The pointer is only valid until the next row is created.
+     * The caller must hold a write lock on _mutex.
+     *
+     * @param key       Index of the combination from key().
+     */
+    size_t* allocate_envelope( size_t key ) ;
+
+    /**
+     * Storage for one block, allocated from the pool and cleared
+     * if this block has not received contributions yet.  The pointer
+     * is only valid until the next block is allocated.
+     *
+     * @param location  Entry for this block in a row of block locations.
+     */
+    value_type* allocate_block( size_t& location ) ;
+
+    /** Number of envelope frequencies. */
+    const size_t _num_freq ;
+
+    /** Number of travel times. */
+    const size_t _num_times ;
+
+    /** Number of receiver azimuths. */
+    const size_t _num_azimuths ;
+
+    /** Number of travel times in each block. */
+    const size_t _block_size ;
+
+    /** Number of blocks needed to span the travel times. */
+    const size_t _num_blocks ;
+
+    /** Number of intensities in each block (frequencies * block size). */
+    const size_t _block_stride ;
+
+    /** Width of the depression/elevation bins (deg). */
+    const double _de_spacing ;
+
+    /** Width of the azimuthal bins (deg). */
+    const double _az_spacing ;
+
+    /** Number of depression/elevation bins. */
+    const size_t _num_de ;
+
+    /** Number of azimuthal bins. */
+    const size_t _num_az ;
+
+    /**
+     * Active combination number for each key() that
+     * has received contributions.
+     */
+    std::map< size_t, size_t > _index ;
+
+    /** Key of each active combination, in the order they were created. */
+    std::vector< size_t > _envelopes ;
+
+    /**
+     * Pool location of each block in each active combination,
+     * organized as [envelope][block], or inactive.
+     */
+    std::vector< size_t > _blocks ;
+
+    /** Contiguous storage for all active blocks. */
+    std::vector< value_type > _pool ;
+
+    /** Locks the bins while contributions are added. */
+    mutable read_write_lock _mutex ;
+
+    /**
+     * Disable assignment.
+     */
+    envelope_bins& operator=( const envelope_bins& other ) ;
+};
+
+/// @}
+}   // end of namespace eigenverb
+}   // end of namespace usml
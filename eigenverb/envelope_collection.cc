@@ -4,15 +4,25 @@
  * receiver azimuth, source beam number, receiver beam number.
  */
 #include <usml/eigenverb/envelope_collection.h>
-#include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/foreach.hpp>
 #include <netcdfcpp.h>
+#include <stdexcept>
+#include <limits>
 
 using namespace usml::eigenverb;
 
 /**
- * Reserve memory in which to store results as a series of
- * nested dynamic arrays.
+ * Number of travel times in each block of envelope storage.
+ */
+size_t envelope_collection::block_size = 64 ;
+
+/**
+ * Marker in the block table for blocks without contributions.
+ */
+const size_t envelope_collection::inactive = std::numeric_limits<size_t>::max() ;
+
+/**
+ * Reserve memory for the table of blocks in each envelope.
  */
 envelope_collection::envelope_collection(
 	const seq_vector* envelope_freq,
@@ -39,115 +49,410 @@ envelope_collection::envelope_collection(
 	_num_src_beams(num_src_beams),
 	_num_rcv_beams(num_rcv_beams),
 	_initial_time(initial_time),
+	_complete_time( std::numeric_limits<double>::max() ),
 	_source_id(source_id),
 	_receiver_id(receiver_id),
 	_source_position(src_position),
 	_receiver_position(rcv_position),
 	_envelope_model( _envelope_freq, src_freq_first, _travel_time,
-	                        _initial_time, _pulse_length, _threshold)
+	                        _initial_time, _pulse_length, _threshold),
+	_block_size( std::max( block_size, (size_t) 1 ) ),
+	_num_blocks( ( _travel_time->size() + _block_size - 1 ) / _block_size ),
+	_block_stride( _envelope_freq->size() * _block_size ),
+	_time_offset( 0.0 ),
+	_gain( 1.0 ),
+	_shifted_time( NULL )
 {
     // Store range from source to receiver when eigenverbs were obtained.
     _slant_range = _receiver_position.distance(_source_position);
 
-	_envelopes = new matrix<double>***[_num_azimuths];
-	matrix<double>**** pa = _envelopes;
-	for (size_t a = 0; a < _num_azimuths; ++a, ++pa) {
-		*pa = new matrix<double>**[_num_src_beams];
-		matrix<double>*** ps = *pa;
-		for (size_t s = 0; s < _num_src_beams; ++s, ++ps) {
-			*ps = new matrix<double>*[_num_rcv_beams];
-			matrix<double>** pr = *ps;
-			for (size_t r = 0; r < _num_rcv_beams; ++r, ++pr) {
-				*pr = new matrix< double >(
-						_envelope_freq->size(), _travel_time->size() ) ;
-				(*pr)->clear();
-			}
-		}
-	}
+	_blocks.resize( _num_azimuths * _num_src_beams * _num_rcv_beams
+		* _num_blocks, inactive ) ;
 }
 
 /**
- * Delete dynamic memory in each of the nested dynamic arrays.
+ * Delete dynamic memory owned by this collection.
  */
 envelope_collection::~envelope_collection() {
-	matrix<double>**** pa = _envelopes;
-	for (size_t a = 0; a < _num_azimuths; ++a, ++pa) {
-		matrix<double>*** ps = *pa;
-		for (size_t s = 0; s < _num_src_beams; ++s, ++ps) {
-			matrix<double>** pr = *ps;
-			for (size_t r = 0; r < _num_rcv_beams; ++r, ++pr) {
-				delete *pr ;
+	delete _envelope_freq ;
+	delete _travel_time ;
+	delete _shifted_time ;
+}
+
+/**
+ * Sets the intensity time series for one combination of parameters.
+ */
+void envelope_collection::envelope( const matrix< double >& intensities,
+	size_t azimuth, size_t src_beam, size_t rcv_beam )
+{
+	if ( intensities.size1() != _envelope_freq->size()
+		|| intensities.size2() != _travel_time->size() )
+	{
+		throw std::invalid_argument("envelope dimensions do not match") ;
+	}
+	const double scale = 1.0 / gain() ;	// stored without dead reckoning
+	write_lock_guard guard(_envelopes_mutex);
+	const size_t first_block = offset(azimuth,src_beam,rcv_beam) ;
+	for ( size_t b=0 ; b < _num_blocks ; ++b ) {
+		const size_t first = b * _block_size ;
+		const size_t count = std::min( _block_size, _travel_time->size() - first ) ;
+
+		// only allocate blocks that have non-zero intensities
+
+		bool zero = true ;
+		for ( size_t f=0 ; f < intensities.size1() && zero ; ++f ) {
+			for ( size_t t=first ; t < first + count ; ++t ) {
+				if ( intensities(f,t) != 0.0 ) {
+					zero = false ;
+					break ;
+				}
+			}
+		}
+		if ( zero && _blocks[first_block+b] == inactive ) continue ;
+
+		value_type* block = allocate_block( first_block + b ) ;
+		for ( size_t f=0 ; f < intensities.size1() ; ++f ) {
+			for ( size_t t=0 ; t < count ; ++t ) {
+				block[ f * _block_size + t ] = (value_type) ( scale * intensities(f,first+t) ) ;
 			}
-			delete[] *ps ;
 		}
-		delete[] *pa ;
 	}
-	delete[] _envelopes ;
-	delete _envelope_freq ;
-	delete _travel_time ;
+}
+
+/**
+ * Storage for one block, allocated from the pool if needed.
+ */
+envelope_collection::value_type* envelope_collection::allocate_block( size_t index ) {
+	size_t& location = _blocks[index] ;
+	if ( location == inactive ) {
+		location = _pool.size() ;
+		_pool.resize( _pool.size() + _block_stride, 0.0 ) ;
+	}
+	return &_pool[location] ;
 }
 
 /**
  * Adds the intensity contribution for a single combination of source
  * and receiver eigenverbs.
  */
-void envelope_collection::add_contribution(
-	const eigenverb& src_verb, const eigenverb& rcv_verb,
+bool envelope_collection::add_contribution(
+	const eigenverb_array& src_verbs, size_t src,
+	const eigenverb_array& rcv_verbs, size_t rcv,
 	const matrix<double>& src_beam, const matrix<double>& rcv_beam,
 	const vector<double>& scatter, double xs2, double ys2 )
 {
-	size_t azimuth = rcv_verb.az_index ;
-	bool ok = _envelope_model.compute_intensity(src_verb,rcv_verb,scatter,xs2,ys2) ;
-	if ( ok ) {
-		for ( size_t s=0 ; s < src_beam.size2() ; ++s ) {
-			for ( size_t r=0 ; r < rcv_beam.size2() ; ++r ) {
-				for ( size_t f=0 ; f < _envelope_freq->size() ; ++f ) {
-					matrix_row< matrix<double> > intensity(_envelope_model.intensity(), f);
-					matrix_row< matrix<double> > envelope(*_envelopes[azimuth][s][r], f);
-					envelope += src_beam(f, s) * rcv_beam(f, r) * intensity;
+	bool ok = _envelope_model.compute_intensity(src_verbs,src,rcv_verbs,rcv,scatter,xs2,ys2) ;
+	if ( !ok ) return false ;
+	accumulate( rcv_verbs.az_index(rcv), src_beam, rcv_beam ) ;
+	accumulate_bins( rcv_verbs.az_index(rcv), src_verbs, src, rcv_verbs, rcv ) ;
+	return true ;
+}
+
+/**
+ * Adds the intensity contributions for both orderings of a monostatic pair.
+ */
+size_t envelope_collection::add_monostatic_contribution(
+	const eigenverb_array& verbs, size_t src,
+	const eigenverb_array& rcv_verbs, size_t rcv,
+	const matrix<double>& src_beam, const matrix<double>& rcv_beam,
+	const matrix<double>& reverse_src_beam, const matrix<double>& reverse_rcv_beam,
+	const vector<double>& scatter, double xs2, double ys2,
+	bool forward, bool reverse )
+{
+	size_t added = 0 ;
+	const bool ok = _envelope_model.compute_intensity(verbs,src,rcv_verbs,rcv,scatter,xs2,ys2) ;
+	if ( ok && forward ) {
+		const size_t azimuth = rcv_verbs.az_index(rcv) ;
+		accumulate( azimuth, src_beam, rcv_beam ) ;
+		accumulate_bins( azimuth, verbs, src, rcv_verbs, rcv ) ;
+		++added ;
+	}
+
+	// the reverse ordering has its own duration, even if the
+	// forward ordering was below threshold
+
+	if ( reverse && _envelope_model.compute_reverse_intensity(verbs,src,rcv_verbs,rcv) ) {
+		const size_t azimuth = verbs.az_index(src) ;
+		accumulate( azimuth, reverse_src_beam, reverse_rcv_beam ) ;
+		accumulate_bins( azimuth, rcv_verbs, rcv, verbs, src ) ;
+		++added ;
+	}
+	return added ;
+}
+
+/**
+ * Adds the time series in the active window to the envelopes for one azimuth.
+ */
+void envelope_collection::accumulate( size_t azimuth,
+	const matrix<double>& src_beam, const matrix<double>& rcv_beam )
+{
+	// only accumulate the portion of the time series that the model wrote
+
+	const size_t first = _envelope_model.window_first() ;
+	const size_t num_times = _envelope_model.window_last() - first ;
+	if ( num_times == 0 ) return ;
+
+	const matrix<double>& intensity = _envelope_model.intensity() ;
+	const size_t num_freq = _envelope_freq->size() ;
+	const size_t last = first + num_times ;
+	const size_t first_block = first / _block_size ;
+	const size_t last_block = ( last - 1 ) / _block_size ;
+	for ( size_t s=0 ; s < src_beam.size2() ; ++s ) {
+		for ( size_t r=0 ; r < rcv_beam.size2() ; ++r ) {
+			const size_t envelope = offset(azimuth, s, r) ;
+			for ( size_t b=first_block ; b <= last_block ; ++b ) {
+
+				// portion of the active window in this block
+
+				const size_t start = b * _block_size ;
+				const size_t t1 = std::max( first, start ) ;
+				const size_t t2 = std::min( last, start + _block_size ) ;
+				value_type* block = allocate_block( envelope + b ) ;
+				for ( size_t f=0 ; f < num_freq ; ++f ) {
+					const double gain = src_beam(f, s) * rcv_beam(f, r) ;
+					const double* level = &intensity(f, t1) ;
+					value_type* row = block + f * _block_size + ( t1 - start ) ;
+					for ( size_t t=0 ; t < t2 - t1 ; ++t ) {
+						row[t] += gain * level[t] ;
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Adds the time series in the active window to the beam independent bins.
+ */
+void envelope_collection::accumulate_bins( size_t azimuth,
+	const eigenverb_array& src_verbs, size_t src,
+	const eigenverb_array& rcv_verbs, size_t rcv )
+{
+	if ( !_bins ) return ;
+	_bins->accumulate( azimuth,
+		_bins->bin( src_verbs.source_de(src), src_verbs.source_az(src) ),
+		_bins->bin( rcv_verbs.source_de(rcv), rcv_verbs.source_az(rcv) ),
+		_envelope_model.intensity(),
+		_envelope_model.window_first(), _envelope_model.window_last() ) ;
+}
+
+/**
+ * Creates an envelope_bins for the beam independent contributions.
+ */
+void envelope_collection::enable_bins() {
+	write_lock_guard guard(_envelopes_mutex);
+	_bins.reset( new envelope_bins( _envelope_freq->size(),
+		_travel_time->size(), _num_azimuths, _block_size ) ) ;
+}
+
+/**
+ * Shares the envelope_bins of another collection.
+ */
+void envelope_collection::share_bins( const envelope_collection& other ) {
+	write_lock_guard guard(_envelopes_mutex);
+	_bins = other.bins() ;
+}
+
+/**
+ * Creates a new collection of envelopes from the beam independent bins.
+ */
+envelope_collection* envelope_collection::apply_beams(
+	const beam_gain_table& src_gains, const beam_gain_table& rcv_gains ) const
+{
+	const size_t num_freq = _envelope_freq->size() ;
+	if ( !_bins ) {
+		throw std::invalid_argument("envelope bins not enabled") ;
+	}
+	if ( src_gains.num_frequencies() != num_freq
+		|| rcv_gains.num_frequencies() != num_freq )
+	{
+		throw std::invalid_argument("beam level frequencies do not match") ;
+	}
+	envelope_collection* result = new envelope_collection(
+		_envelope_freq, _envelope_model.src_freq_first(), _travel_time,
+		_reverb_duration, _pulse_length, _threshold, _num_azimuths,
+		src_gains.num_beams(), rcv_gains.num_beams(), _initial_time,
+		_source_id, _receiver_id, _source_position, _receiver_position ) ;
+	result->_complete_time = _complete_time ;
+	{
+		read_lock_guard guard(_transform_mutex);
+		result->_slant_range = _slant_range ;
+		result->_time_offset = _time_offset ;
+		result->_gain = _gain ;
+		if ( _shifted_time != NULL ) {
+			result->_shifted_time = _shifted_time->clone() ;
+		}
+	}
+	read_lock_guard guard(_envelopes_mutex);
+
+	// the new collection gets its own copy of the bins,
+	// so that later contributions to either one are not shared
+
+	result->_bins.reset( new envelope_bins( *_bins ) ) ;
+
+	// beam levels at the center of each launch angle bin, computed on first use
+
+	const envelope_bins& bins = *_bins ;
+	std::vector< matrix<double> > src_level( bins.num_bins() ) ;
+	std::vector< matrix<double> > rcv_level( bins.num_bins() ) ;
+	const size_t num_time = _travel_time->size() ;
+	const size_t bin_size = bins.block_size() ;
+	const size_t out_size = result->_block_size ;
+
+	for ( size_t n=0 ; n < bins.active_envelopes() ; ++n ) {
+		size_t azimuth, src_bin, rcv_bin ;
+		bins.decode( n, &azimuth, &src_bin, &rcv_bin ) ;
+		double de, az ;
+		if ( src_level[src_bin].size1() == 0 ) {
+			src_level[src_bin].resize( num_freq, src_gains.num_beams(), false ) ;
+			bins.center( src_bin, &de, &az ) ;
+			src_gains.gain( de, az, &src_level[src_bin] ) ;
+		}
+		if ( rcv_level[rcv_bin].size1() == 0 ) {
+			rcv_level[rcv_bin].resize( num_freq, rcv_gains.num_beams(), false ) ;
+			bins.center( rcv_bin, &de, &az ) ;
+			rcv_gains.gain( de, az, &rcv_level[rcv_bin] ) ;
+		}
+		const matrix<double>& src_beam = src_level[src_bin] ;
+		const matrix<double>& rcv_beam = rcv_level[rcv_bin] ;
+
+		// add each active block to every beam combination, one destination
+		// block at a time, in case the block sizes are different
+
+		for ( size_t b=0 ; b < bins.num_blocks() ; ++b ) {
+			const envelope_bins::value_type* level = bins.block( n, b ) ;
+			if ( level == NULL ) continue ;
+			const size_t first = b * bin_size ;
+			const size_t last = std::min( first + bin_size, num_time ) ;
+			for ( size_t s=0 ; s < src_beam.size2() ; ++s ) {
+				for ( size_t r=0 ; r < rcv_beam.size2() ; ++r ) {
+					const size_t envelope = result->offset(azimuth, s, r) ;
+					for ( size_t t1=first ; t1 < last ; ) {
+						const size_t start = ( t1 / out_size ) * out_size ;
+						const size_t t2 = std::min( last, start + out_size ) ;
+						value_type* block = result->allocate_block( envelope + t1 / out_size ) ;
+						for ( size_t f=0 ; f < num_freq ; ++f ) {
+							const double gain = src_beam(f, s) * rcv_beam(f, r) ;
+							const envelope_bins::value_type* in = level + f * bin_size + ( t1 - first ) ;
+							value_type* out = block + f * out_size + ( t1 - start ) ;
+							for ( size_t t=0 ; t < t2 - t1 ; ++t ) {
+								out[t] += gain * in[t] ;
+							}
+						}
+						t1 = t2 ;
+					}
 				}
 			}
 		}
 	}
+	return result ;
+}
+
+/**
+ * Adds the envelopes from another collection to this one.
+ */
+void envelope_collection::add_envelopes( const envelope_collection& other ) {
+	if ( other._blocks.size() != _blocks.size()
+		|| other._block_stride != _block_stride )
+	{
+		throw std::invalid_argument("envelope dimensions do not match") ;
+	}
+	if ( other.time_offset() != time_offset() ) {
+		throw std::invalid_argument("envelope time offsets do not match") ;
+	}
+	const double scale = other.gain() / gain() ;
+	write_lock_guard guard(_envelopes_mutex);
+	read_lock_guard other_guard(other._envelopes_mutex);
+
+	// only visit the blocks that are active in the other collection
+
+	for ( size_t n=0 ; n < _blocks.size() ; ++n ) {
+		if ( other._blocks[n] == inactive ) continue ;
+		const value_type* theirs = &other._pool[ other._blocks[n] ] ;
+		value_type* mine = allocate_block( n ) ;
+		for ( size_t i=0 ; i < _block_stride ; ++i ) {
+			mine[i] += scale * theirs[i] ;
+		}
+	}
+	if ( _bins && other._bins && _bins != other._bins ) {
+		_bins->add_bins( *other._bins, scale ) ;
+	}
 }
 
 /**
- * Updates the envelope_collection data with the parameters provided.
+ * Compares the envelopes in this collection to those of another collection.
+ */
+size_t envelope_collection::compare( const envelope_collection& other,
+	double* rms_db, double* max_db ) const
+{
+	if ( other._num_azimuths != _num_azimuths
+		|| other._num_src_beams != _num_src_beams
+		|| other._num_rcv_beams != _num_rcv_beams
+		|| other._envelope_freq->size() != _envelope_freq->size()
+		|| other._travel_time->size() != _travel_time->size() )
+	{
+		throw std::invalid_argument("envelope dimensions do not match") ;
+	}
+	const double my_gain = gain() ;
+	const double their_gain = other.gain() ;
+	read_lock_guard guard(_envelopes_mutex);
+	read_lock_guard other_guard(other._envelopes_mutex);
+
+	const double min_level = std::max( _threshold, 1e-30 ) ;
+	double sum = 0.0 ;
+	double peak = 0.0 ;
+	size_t count = 0 ;
+	const size_t num_freq = _envelope_freq->size() ;
+	const size_t num_time = _travel_time->size() ;
+	for ( size_t n=0 ; n < _blocks.size() ; ++n ) {
+
+		// skip blocks that are zero in both collections
+
+		if ( _blocks[n] == inactive && other._blocks[n] == inactive ) continue ;
+		const value_type* mine = ( _blocks[n] == inactive ) ? NULL : &_pool[ _blocks[n] ] ;
+		const value_type* theirs = ( other._blocks[n] == inactive ) ? NULL
+			: &other._pool[ other._blocks[n] ] ;
+		const size_t num_valid = std::min( _block_size,
+			num_time - ( n % _num_blocks ) * _block_size ) ;
+		for ( size_t f=0 ; f < num_freq ; ++f ) {
+			for ( size_t t=0 ; t < num_valid ; ++t ) {
+				const size_t i = f * _block_size + t ;
+				const double x = ( mine == NULL ) ? 0.0 : my_gain * mine[i] ;
+				const double y = ( theirs == NULL ) ? 0.0 : their_gain * theirs[i] ;
+				if ( x <= _threshold && y <= _threshold ) continue ;
+				const double diff = 10.0 * log10(
+					std::max( x, min_level ) / std::max( y, min_level ) ) ;
+				sum += diff * diff ;
+				peak = std::max( peak, std::abs(diff) ) ;
+				++count ;
+			}
+		}
+	}
+	*rms_db = ( count == 0 ) ? 0.0 : sqrt( sum / count ) ;
+	*max_db = peak ;
+	return count ;
+}
+
+/**
+ * Updates the dead reckoning transform with the parameters provided.
  */
 void envelope_collection::dead_reckon(double delta_time,
                                     double slant_range, double prev_range) {
-    // Set new slant_range
+    double gain = slant_range/prev_range;
+    gain *= gain ;
+
+    write_lock_guard guard(_transform_mutex);
     _slant_range = slant_range;
+    _time_offset += delta_time;
+    _gain *= gain;
+
+    // shift the travel times reported to consumers,
+    // without changing the axis that the envelopes are stored on
 
-    // Shift the time series
-    delete _travel_time;
-    boost::numeric::ublas::vector<double> temp_data = (*_travel_time);
-    temp_data = temp_data + delta_time;
-    _travel_time = new seq_data( temp_data );
-
-    { // Scope for lock
-
-        // Perform copy and intensity update
-        double gain = slant_range/prev_range;
-        gain *= gain ;
-
-        write_lock_guard guard(this->_envelopes_mutex);
-        // Copy "this" envelopes to new_collection
-        matrix<double>**** pa = _envelopes;
-        for (size_t a = 0; a < _num_azimuths; ++a, ++pa)
-        {
-            matrix<double>*** ps = *pa;
-            for (size_t s = 0; s < _num_src_beams; ++s, ++ps)
-            {
-                matrix<double>** pr = *ps;
-                for (size_t r = 0; r < _num_rcv_beams; ++r, ++pr)
-                {
-                    (**pr) = this->envelope(a, s, r);
-                    (**pr) *= gain;
-                }
-            }
-        }
-    }
+    vector<double> times = _travel_time->data() ;
+    times += scalar_vector<double>( times.size(), _time_offset ) ;
+    delete _shifted_time ;
+    _shifted_time = seq_vector::build_best( times ) ;
 }
 
 /**
@@ -189,18 +494,25 @@ void envelope_collection::write_netcdf(const char* filename) const {
 	threshold_var->put( &_threshold ) ;
 	initial_time_var->put( &_initial_time ) ;
 	freq_var->put( _envelope_freq->data().begin(), (long) _envelope_freq->size());
-	time_var->put( _travel_time->data().begin(), (long) _travel_time->size());
+	vector<double> travel_time = _travel_time->data() ;
+	travel_time += scalar_vector<double>( travel_time.size(), time_offset() ) ;
+	time_var->put( travel_time.data().begin(), (long) travel_time.size());
+
+	// expand each envelope to dense storage as it is written
 
-	for (size_t a = 0; a < _num_azimuths; ++a) {
+	const size_t num_freq = _envelope_freq->size() ;
+	const size_t num_time = _travel_time->size() ;
+	std::vector<double> envelope( num_freq * num_time ) ;
+	for (size_t a = 0; a < _num_azimuths && !envelope.empty(); ++a) {
 		for (size_t s = 0; s < _num_src_beams; ++s) {
 			for (size_t r = 0; r < _num_rcv_beams; ++r) {
-				for (size_t f = 0; f < _envelope_freq->size(); ++f) {
-					matrix_row< matrix<double> > row(*_envelopes[a][s][r], f);
-					vector<double> envelope = 10.0*log10(max(row, 1e-30));
-					envelopes_var->set_cur((long)a, (long)s, (long)r, (long) f, 0L );
-					envelopes_var->put(envelope.data().begin(), 1L, 1L, 1L, 1L,
-						(long) _travel_time->size() );
+				this->envelope(a, s, r).dense( &envelope[0] ) ;
+				BOOST_FOREACH( double& level, envelope ) {
+					level = 10.0*log10( std::max( level, 1e-30 ) ) ;
 				}
+				envelopes_var->set_cur((long)a, (long)s, (long)r, 0L, 0L );
+				envelopes_var->put(&envelope[0], 1L, 1L, 1L,
+					(long) num_freq, (long) num_time );
 			}
 		}
 	}
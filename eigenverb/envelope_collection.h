@@ -5,9 +5,14 @@
  */
 #pragma once
 
+#include <usml/usml_config.h>
 #include <usml/eigenverb/envelope_model.h>
+#include <usml/eigenverb/envelope_bins.h>
 #include <usml/sensors/sensor_model.h>
+#include <usml/sensors/beam_gain_table.h>
 #include <usml/types/seq_linear.h>
+#include <algorithm>
+#include <vector>
 
 namespace usml {
 namespace eigenverb {
@@ -19,9 +24,26 @@ using namespace usml::types;
  * Computes and stores the reverberation envelope time series for all
  * combinations of receiver azimuth, source beam number, receiver beam number.
  * Relies on envelope_model to calculate the actual time series for each
- * envelope frequency.  Each envelope is stored as a matrix that represents
- * the results as a function of the sensor_pair's envelope frequency (rows)
- * and two-way travel time (columns).
+ * envelope frequency.  Each envelope represents the results as a function
+ * of the sensor_pair's envelope frequency (rows) and two-way travel time
+ * (columns).
+ *
+ * Because each contribution is concentrated near its own travel time,
+ * most of each envelope is zero.  The travel time axis is divided into
+ * blocks of block_size samples, and storage is only allocated for the
+ * blocks of each envelope that receive a contribution.  The active blocks
+ * of all envelopes share a single contiguous pool of memory, in which
+ * each block is organized as [frequency][time].  Individual envelopes are
+ * accessed through an envelope_view that copies only the active blocks
+ * of that envelope, and that can be converted to a dense matrix
+ * on demand.  The intensities are stored in single precision if
+ * USML_ENVELOPE_FLOAT is defined in usml_config.h.
+ *
+ * If enable_bins() is called before the contributions are added, each
+ * contribution is also stored, without beam patterns, in an envelope_bins
+ * organized by the launch angles of its eigenverbs.  The apply_beams()
+ * method can then create the envelopes for another set of beams, or
+ * another sensor orientation, without repeating the eigenverb pair search.
  */
 class USML_DECLSPEC envelope_collection {
 
@@ -38,8 +60,160 @@ public:
     typedef boost::shared_ptr<envelope_collection> reference;
 
     /**
-     * Reserve memory in which to store results as a series of
-     * nested dynamic arrays.
+     * Data type used to store envelope intensities.
+     */
+#ifdef USML_ENVELOPE_FLOAT
+    typedef float value_type ;
+#else
+    typedef double value_type ;
+#endif
+
+    /**
+     * Number of travel times in each block of envelope storage.
+     * Smaller blocks use less memory for envelopes with narrow
+     * contributions, at the cost of a larger block table. Only
+     * affects collections constructed after it is changed. Defaults to 64.
+     */
+    static size_t block_size ;
+
+    /**
+     * Marker in the block table for blocks that have not received
+     * any contributions.
+     */
+    static const size_t inactive ;
+
+    /**
+     * Read only copy of the intensity time series for one combination of
+     * receiver azimuth, source beam number, receiver beam number.
+     * Only the active blocks of this envelope are copied, so it remains
+     * valid after the envelope_collection is modified or destroyed, and
+     * the copies are shared when the view itself is copied.  Each row
+     * represents a specific envelope frequency.  Each column represents
+     * a specific travel time.  Intensities in blocks that have not
+     * received any contributions are zero.
+     */
+    class USML_DECLSPEC envelope_view {
+    public:
+
+        /**
+         * Copy the active blocks of one envelope from block sparse storage.
+         *
+         * @param blocks        Pool index of each block in this envelope.
+         * @param pool          Contiguous storage for all active blocks.
+         * @param size1         Number of envelope frequencies.
+         * @param size2         Number of travel times.
+         * @param block_size    Number of travel times in each block.
+         * @param gain          Intensity scale factor from dead reckoning.
+         * @param time_offset   Travel time shift from dead reckoning (sec).
+         */
+        envelope_view( const size_t* blocks, const value_type* pool,
+                size_t size1, size_t size2, size_t block_size,
+                double gain = 1.0, double time_offset = 0.0 ) :
+            _blocks( new std::vector<size_t>( ( size2 + block_size - 1 ) / block_size, inactive ) ),
+            _pool( new std::vector<value_type>() ),
+            _size1(size1), _size2(size2), _block_size(block_size),
+            _gain(gain), _time_offset(time_offset)
+        {
+            const size_t stride = size1 * block_size ;
+            std::vector<size_t>& index = *_blocks ;
+            std::vector<value_type>& storage = *_pool ;
+            for ( size_t b=0 ; b < index.size() ; ++b ) {
+                if ( blocks[b] == inactive ) continue ;
+                index[b] = storage.size() ;
+                storage.insert( storage.end(), pool + blocks[b],
+                                pool + blocks[b] + stride ) ;
+            }
+        }
+
+        /** Number of envelope frequencies. */
+        size_t size1() const { return _size1 ; }
+
+        /** Number of travel times. */
+        size_t size2() const { return _size2 ; }
+
+        /** Number of travel times in each block. */
+        size_t block_size() const { return _block_size ; }
+
+        /**
+         * Intensity scale factor from dead reckoning (ratio).
+         * Applied by operator() and dense(), but not by block().
+         */
+        double gain() const { return _gain ; }
+
+        /**
+         * Time shift from dead reckoning, to be added to the
+         * collection's computed_travel_time() (sec).
+         */
+        double time_offset() const { return _time_offset ; }
+
+        /** Number of blocks needed to span the travel times. */
+        size_t num_blocks() const {
+            return _blocks->size() ;
+        }
+
+        /**
+         * Storage for one block of this envelope, organized as
+         * [frequency][time], or NULL if this block is zero.
+         * Values are stored without the dead reckoning gain.
+         */
+        const value_type* block( size_t b ) const {
+            const size_t location = (*_blocks)[b] ;
+            return ( location == inactive ) ? NULL : &(*_pool)[location] ;
+        }
+
+        /** Intensity at a specific frequency and travel time. */
+        value_type operator()( size_t f, size_t t ) const {
+            const value_type* data = block( t / _block_size ) ;
+            return ( data == NULL ) ? 0 : (value_type) ( _gain *
+                data[ f * _block_size + t % _block_size ] ) ;
+        }
+
+        /**
+         * Copies this envelope into dense storage.
+         *
+         * @param dense     Destination for size1()*size2() intensities,
+         *                  organized as [frequency][time].
+         */
+        template< class T > void dense( T* dense ) const {
+            for ( size_t b=0 ; b < num_blocks() ; ++b ) {
+                const value_type* data = block(b) ;
+                const size_t first = b * _block_size ;
+                const size_t count = std::min( _block_size, _size2 - first ) ;
+                for ( size_t f=0 ; f < _size1 ; ++f ) {
+                    T* row = dense + f * _size2 + first ;
+                    if ( data == NULL ) {
+                        std::fill( row, row + count, T(0) ) ;
+                    } else {
+                        const value_type* level = data + f * _block_size ;
+                        for ( size_t t=0 ; t < count ; ++t ) {
+                            row[t] = (T) ( _gain * level[t] ) ;
+                        }
+                    }
+                }
+            }
+        }
+
+        /** Copy of this envelope as a dense matrix. */
+        matrix<double> copy() const {
+            matrix<double> result( _size1, _size2 ) ;
+            dense( &result.data()[0] ) ;
+            return result ;
+        }
+
+    private:
+        boost::shared_ptr< std::vector<size_t> > _blocks ;     ///< index of each block
+        boost::shared_ptr< std::vector<value_type> > _pool ;   ///< copy of active blocks
+        size_t _size1 ;             ///< number of frequencies
+        size_t _size2 ;             ///< number of travel times
+        size_t _block_size ;        ///< travel times per block
+        double _gain ;              ///< dead reckoning intensity scale
+        double _time_offset ;       ///< dead reckoning time shift (sec)
+    };
+
+    /**
+     * Reserve memory for the table of blocks in each envelope.
+     * Storage for the blocks themselves is allocated as they
+     * receive contributions.
      *
      * @param envelope_freq     Frequencies at which the source and receiver
      *                          eigenverbs overlap (Hz).  Frequencies at which
@@ -80,7 +254,7 @@ public:
         wposition1 rcv_position) ;
 
     /**
-     * Delete dynamic memory in each of the nested dynamic arrays.
+     * Delete dynamic memory owned by this collection.
      */
     ~envelope_collection();
 
@@ -107,12 +281,41 @@ public:
 
     /**
      * Times at which the sensor_pair's reverberation envelopes
-     * are computed (sec).
+     * currently apply (sec).  Includes the time_offset() from
+     * dead reckoning.  The axis is rebuilt by each call to
+     * dead_reckon(), which invalidates the previous pointer.
      */
     const seq_vector* travel_time() const {
+        read_lock_guard guard(_transform_mutex);
+        return ( _shifted_time != NULL ) ? _shifted_time : _travel_time;
+    }
+
+    /**
+     * Times at which the sensor_pair's reverberation envelopes
+     * were computed (sec).  Does not include the time_offset()
+     * from dead reckoning, and never changes.
+     */
+    const seq_vector* computed_travel_time() const {
         return _travel_time;
     }
 
+    /**
+     * Time shift applied to the travel times by dead reckoning (sec).
+     */
+    double time_offset() const {
+        read_lock_guard guard(_transform_mutex);
+        return _time_offset;
+    }
+
+    /**
+     * Intensity scale factor applied to the envelopes by dead reckoning
+     * (ratio).  Applied by envelope_view as the envelopes are read.
+     */
+    double gain() const {
+        read_lock_guard guard(_transform_mutex);
+        return _gain;
+    }
+
     /**
      * Duration of the transmitted pulse (sec).
      * Defines the temporal resolution of the envelope.
@@ -160,6 +363,24 @@ public:
         _initial_time = initial_time;
     }
 
+    /**
+     * Time, relative to the start of the envelope time axis, before which
+     * all contributions have been added (sec). Partial results published
+     * by a streaming envelope_generator are only valid before this time.
+     * Defaults to the largest double value for complete results.
+     */
+    double complete_time() const {
+        return _complete_time;
+    }
+
+    /**
+     * Set the time before which all contributions have been added.
+     * @param time  Time relative to the start of the time axis (sec).
+     */
+    void complete_time(double time) {
+        _complete_time = time;
+    }
+
     /** Range from source to receiver . */
     double slant_range() const {
         return _slant_range;
@@ -207,33 +428,50 @@ public:
      * @param azimuth     Receiver azimuth number.
      * @param src_beam    Source beam number.
      * @param rcv_beam    Receiver beam number
-     * @return            Reverberation intensity at each point the time series.
-     *                      Each row represents a specific envelope frequency.
-     *                      Each column represents a specific travel time.
+     * @return            Copy of the reverberation intensity at each point
+     *                      the time series, which only stores active blocks.  Each row represents a specific
+     *                      envelope frequency. Each column represents a
+     *                      specific travel time.
      */
-    const matrix< double >& envelope(
+    envelope_view envelope(
         size_t azimuth, size_t src_beam, size_t rcv_beam ) const
     {
         read_lock_guard guard(_envelopes_mutex);
-        return *_envelopes[azimuth][src_beam][rcv_beam];
+        read_lock_guard transform_guard(_transform_mutex);
+        return envelope_view( &_blocks[ offset(azimuth,src_beam,rcv_beam) ],
+            _pool.empty() ? NULL : &_pool[0],
+            _envelope_freq->size(), _travel_time->size(), _block_size,
+            _gain, _time_offset ) ;
     }
 
     /**
      * Sets the intensity time series for one combination of parameters.
      *
-     * @param intensities Matrix of
+     * @param intensities Reverberation intensity at each point the time series.
+     *                      Each row represents a specific envelope frequency.
+     *                      Each column represents a specific travel time.
      * @param azimuth     Receiver azimuth number.
      * @param src_beam    Source beam number.
      * @param rcv_beam    Receiver beam number
-     * @return            Reverberation intensity at each point the time series.
-     *                      Each row represents a specific envelope frequency.
-     *                      Each column represents a specific travel time.
      */
-    void envelope( matrix< double >& intensities,
-        size_t azimuth, size_t src_beam, size_t rcv_beam ) const
-    {
-        write_lock_guard guard(_envelopes_mutex);
-        *_envelopes[azimuth][src_beam][rcv_beam] = intensities;
+    void envelope( const matrix< double >& intensities,
+        size_t azimuth, size_t src_beam, size_t rcv_beam ) ;
+
+    /**
+     * Number of blocks that have received contributions,
+     * across all of the envelopes in this collection.
+     */
+    size_t active_blocks() const {
+        read_lock_guard guard(_envelopes_mutex);
+        return _pool.size() / _block_stride ;
+    }
+
+    /**
+     * Number of blocks that would be needed to store all of the envelopes
+     * in this collection densely.
+     */
+    size_t total_blocks() const {
+        return _blocks.size() ;
     }
 
     /**
@@ -246,8 +484,11 @@ public:
      * It also assumes that the calling routine has computed the scattering
      * coefficient and beam levels for this combination of eigenverbs,
      *
-     * @param src_verb    Eigenverb contribution from the source.
-     * @param rcv_verb    Eigenverb contribution from the receiver.
+     * @param src_verbs   Contiguous storage for the source eigenverbs.
+     * @param src         Index of the source eigenverb in src_verbs.
+     * @param rcv_verbs   Contiguous storage for the receiver eigenverbs,
+     *                     interpolated onto the envelope frequencies.
+     * @param rcv         Index of the receiver eigenverb in rcv_verbs.
      * @param src_beam    Source beam level at each envelope frequency (ratio).
      *                     Each row represents a specific envelope frequency.
      *                     Each column represents a beam number.
@@ -261,15 +502,134 @@ public:
      * @param ys2        Square of the relative distance from the
      *                     receiver to the target along the direction
      *                     of the receiver's width.
+     * @return           False if reverberation power below threshold.
      */
-    void add_contribution(
-            const eigenverb& src_verb, const eigenverb& rcv_verb,
+    bool add_contribution(
+            const eigenverb_array& src_verbs, size_t src,
+            const eigenverb_array& rcv_verbs, size_t rcv,
             const matrix<double>& src_beam, const matrix<double>& rcv_beam,
             const vector<double>& scatter, double xs2, double ys2 ) ;
 
+    /**
+     * Adds the intensity contributions for both orderings of a pair of
+     * eigenverbs from the same monostatic sensor. The power of the overlap
+     * between two Gaussian footprints is symmetric, so it is only computed
+     * once, using src as the source and rcv as the receiver.  But the
+     * duration depends on the receiver eigenverb, so each ordering
+     * renders its own time series and applies its own threshold test.
+     * The forward contribution is added to the azimuth of rcv, using
+     * the beam levels src_beam and rcv_beam.  The reverse contribution,
+     * in which rcv is the source, is added to the azimuth of src, using
+     * the beam levels reverse_src_beam and reverse_rcv_beam.
+     *
+     * @param verbs             Contiguous storage for the eigenverbs.
+     * @param src               Index of the source eigenverb in verbs.
+     * @param rcv_verbs         Contiguous storage for the receiver
+     *                          eigenverbs, on the envelope frequencies.
+     * @param rcv               Index of the receiver eigenverb in rcv_verbs.
+     * @param src_beam          Source beam levels for the forward ordering.
+     * @param rcv_beam          Receiver beam levels for the forward ordering.
+     * @param reverse_src_beam  Source beam levels for the reverse ordering.
+     * @param reverse_rcv_beam  Receiver beam levels for the reverse ordering.
+     * @param scatter           Scattering strength at each envelope
+     *                          frequency (ratio).
+     * @param xs2               Square of the relative distance along the
+     *                          receiver's length.
+     * @param ys2               Square of the relative distance along the
+     *                          receiver's width.
+     * @param forward           Add the forward ordering.
+     * @param reverse           Add the reverse ordering.
+     * @return                  Number of orderings added, those with
+     *                          reverberation power below threshold are
+     *                          not included.
+     */
+    size_t add_monostatic_contribution(
+            const eigenverb_array& verbs, size_t src,
+            const eigenverb_array& rcv_verbs, size_t rcv,
+            const matrix<double>& src_beam, const matrix<double>& rcv_beam,
+            const matrix<double>& reverse_src_beam,
+            const matrix<double>& reverse_rcv_beam,
+            const vector<double>& scatter, double xs2, double ys2,
+            bool forward, bool reverse ) ;
+
+    /**
+     * Creates an envelope_bins to store the beam independent
+     * contributions added after this call.  Must be called before
+     * any contributions are added, if the bins are to be complete.
+     */
+    void enable_bins() ;
+
+    /**
+     * Adds future contributions to the same envelope_bins as another
+     * collection, instead of creating bins for this one.  Used by the
+     * partitions of an envelope_generator, so that only the final result
+     * has bins.  add_envelopes() does not add bins that are shared.
+     *
+     * @param other     Collection whose bins are shared.
+     */
+    void share_bins( const envelope_collection& other ) ;
+
+    /**
+     * Beam independent contributions to these envelopes,
+     * or a NULL reference if enable_bins() was not called.
+     * Any collection created by apply_beams() has its own copy of the bins.
+     */
+    envelope_bins::reference bins() const {
+        return _bins ;
+    }
+
+    /**
+     * Creates a new collection of envelopes, by applying a new set of beam
+     * levels to the beam independent bins of this collection.  The number of
+     * source and receiver beams in the result are taken from the beam level
+     * tables, which must be computed on the envelope frequencies of this
+     * collection.  The result gets its own copy of the bins of this
+     * collection, and of its dead reckoning transform, so that beams can be
+     * changed again later, and so that contributions added to either
+     * collection afterwards are not shared.  The caller takes ownership of the result.
+     *
+     * @param src_gains     Source beam levels for new beams and orientation.
+     * @param rcv_gains     Receiver beam levels for new beams and orientation.
+     * @return              New collection of envelopes.
+     * @throws std::invalid_argument if this collection has no bins, or if
+     *                      the beam level tables use other frequencies.
+     */
+    envelope_collection* apply_beams( const beam_gain_table& src_gains,
+                                      const beam_gain_table& rcv_gains ) const ;
+
+    /**
+     * Adds the envelopes from another collection to this one.
+     * Used to combine partial results computed in separate threads.
+     * Both collections must have the same dimensions. The bins of the
+     * other collection are also added, if both collections have bins.
+     *
+     * @param other     Collection of envelopes to add to this one.
+     */
+    void add_envelopes( const envelope_collection& other ) ;
+
+    /**
+     * Compares the envelopes in this collection to those of another
+     * collection with the same dimensions. Used to measure the effect of
+     * approximations, such as eigenverb_collection::merge_eigenverbs(),
+     * against a reference calculation. Only the points where either
+     * envelope is above the threshold are included in the comparison.
+     *
+     * @param other     Reference collection of envelopes.
+     * @param rms_db    Root mean square difference in level (dB, output).
+     * @param max_db    Largest absolute difference in level (dB, output).
+     * @return          Number of points compared.
+     */
+    size_t compare( const envelope_collection& other,
+                    double* rms_db, double* max_db ) const ;
+
     /**
      * Updates the current envelope_collection
      * via dead_reckoning with the parameters provided.
+     * The envelopes are not modified.  Instead, the time shift and
+     * change in intensity are accumulated into time_offset() and gain(),
+     * which are applied as the envelopes are read or written to disk.
+     * Only the travel_time() axis is rebuilt, so each update never
+     * waits for readers of the envelopes.
      *
      * @param delta_time    The time amount to shift the envelopes
      * @param slant_range   The range in meters from the source and receiver.
@@ -285,6 +645,54 @@ public:
 
 private:
 
+    /**
+     * Adds the time series in the envelope_model's active window to the
+     * envelopes for one azimuth, weighted by the product of the source
+     * and receiver beam levels.
+     *
+     * @param azimuth       Receiver azimuth number.
+     * @param src_beam      Source beam levels.
+     * @param rcv_beam      Receiver beam levels.
+     */
+    void accumulate( size_t azimuth,
+            const matrix<double>& src_beam, const matrix<double>& rcv_beam ) ;
+
+    /**
+     * Adds the time series in the envelope_model's active window to the
+     * beam independent bins, if enabled.
+     *
+     * @param azimuth       Receiver azimuth number.
+     * @param src_verbs     Contiguous storage for the source eigenverbs.
+     * @param src           Index of the source eigenverb in src_verbs.
+     * @param rcv_verbs     Contiguous storage for the receiver eigenverbs.
+     * @param rcv           Index of the receiver eigenverb in rcv_verbs.
+     */
+    void accumulate_bins( size_t azimuth,
+            const eigenverb_array& src_verbs, size_t src,
+            const eigenverb_array& rcv_verbs, size_t rcv ) ;
+
+    /**
+     * Index of the first block for one combination of parameters
+     * in the block table.
+     *
+     * @param azimuth     Receiver azimuth number.
+     * @param src_beam    Source beam number.
+     * @param rcv_beam    Receiver beam number
+     */
+    size_t offset( size_t azimuth, size_t src_beam, size_t rcv_beam ) const {
+        return ( ( azimuth * _num_src_beams + src_beam ) * _num_rcv_beams
+            + rcv_beam ) * _num_blocks ;
+    }
+
+    /**
+     * Storage for one block, allocated from the pool and cleared
+     * if this block has not received contributions yet.  The pointer
+     * is only valid until the next block is allocated.
+     *
+     * @param index     Index of the block in the block table.
+     */
+    value_type* allocate_block( size_t index ) ;
+
     /**
      * Frequencies at which the source and receiver eigenverbs overlap (Hz).
      * Frequencies at which envelope will be computed.
@@ -334,6 +742,11 @@ private:
      */
     double _initial_time;
 
+    /**
+     * Time before which all contributions have been added (sec).
+     */
+    double _complete_time;
+
     /**
      * The slant range (in meters) of the sensor when the eigenverbs were obtained.
      */
@@ -365,18 +778,64 @@ private:
     envelope_model _envelope_model ;
 
     /**
-     * Reverberation envelopes for each combination of parameters.
-     * The order of indices is azimuth number, source beam number,
-     * and then receiver beam number.  Each envelope is stored as a
-     * matrix that represents the results a function of the sensor_pair's
-     * envelope frequency (rows) and two-way travel time (columns).
+     * Number of travel times in each block of envelope storage.
+     */
+    const size_t _block_size ;
+
+    /**
+     * Number of blocks needed to span the travel times.
+     */
+    const size_t _num_blocks ;
+
+    /**
+     * Number of intensities in each block (frequencies * block size).
+     */
+    const size_t _block_stride ;
+
+    /**
+     * Index of each block in the pool, or inactive if the block has not
+     * received any contributions. The order of indices is azimuth number,
+     * source beam number, receiver beam number, and then block number.
+     */
+    std::vector< size_t > _blocks;
+
+    /**
+     * Contiguous storage for all active blocks.  Each block is organized
+     * as [frequency][time], with block_size travel times in each row.
+     */
+    std::vector< value_type > _pool;
+
+    /**
+     * Beam independent contributions, or NULL if not enabled.
      */
-    matrix< double >**** _envelopes;
+    envelope_bins::reference _bins ;
 
     /**
      * Mutex that locks during envelopes access
      */
     mutable read_write_lock _envelopes_mutex ;
+
+    /**
+     * Time shift applied to the travel times by dead reckoning (sec).
+     */
+    double _time_offset ;
+
+    /**
+     * Intensity scale factor applied by dead reckoning (ratio).
+     */
+    double _gain ;
+
+    /**
+     * Travel times shifted by the time_offset() from dead reckoning,
+     * or NULL if the envelopes have not been dead reckoned.
+     */
+    seq_vector* _shifted_time ;
+
+    /**
+     * Mutex that locks during updates to the dead reckoning transform,
+     * so that these updates never wait for the envelopes.
+     */
+    mutable read_write_lock _transform_mutex ;
 };
 
 }   // end of namespace eigenverb
@@ -7,7 +7,12 @@
 #include <usml/sensors/beam_pattern_map.h>
 #include <usml/sensors/beam_pattern_model.h>
 #include <usml/threads/smart_ptr.h>
+#include <usml/types/seq_data.h>
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <limits>
 
 using namespace usml::eigenverb ;
 using namespace usml::sensors ;
@@ -22,6 +27,51 @@ double envelope_generator::intensity_threshold = -300.0 ;
  */
 double envelope_generator::distance_threshold = 6.0 ;
 
+/**
+ * Number of partitions of the receiver eigenverbs.
+ */
+size_t envelope_generator::num_partitions = 4 ;
+
+/**
+ * Maximum number of threads used by run(), zero for hardware concurrency.
+ */
+size_t envelope_generator::max_threads = 1 ;
+
+/**
+ * Upper limit on the interface scattering strength (dB).
+ */
+double envelope_generator::max_scattering = 0.0 ;
+
+/**
+ * Interval of one way travel time between partial results in streaming mode.
+ */
+double envelope_generator::segment_duration = 5.0 ;
+
+/**
+ * Number of travel time samples per pulse length, zero for a fixed axis.
+ */
+double envelope_generator::samples_per_pulse = 0.0 ;
+
+/**
+ * Largest number of samples on the adaptive travel time axis.
+ */
+size_t envelope_generator::max_time_samples = 10000 ;
+
+/**
+ * Smallest sampling period of the adaptive travel time axis.
+ */
+double envelope_generator::min_time_step = 0.001 ;
+
+/**
+ * Growth in the sampling period as a fraction of the two way travel time.
+ */
+double envelope_generator::time_growth = 0.0 ;
+
+/**
+ * Store beam independent contributions in the result.
+ */
+bool envelope_generator::beam_bins = false ;
+
 /**
  * The mutex for static properties.
  */
@@ -41,15 +91,20 @@ envelope_generator::envelope_generator(
 	sensor_pair* sensor_pair,
 	double initial_time,
 	size_t src_freq_first,
-	size_t num_azimuths
+	size_t num_azimuths,
+	eigenverb_stream::reference src_stream,
+	eigenverb_stream::reference rcv_stream
 ):
     _done(false),
     _initial_time(initial_time),
+    _src_freq_first(src_freq_first),
+    _num_azimuths(num_azimuths),
     _ocean( ocean_shared::current() ),
     _sensor_pair(sensor_pair),
     _src_eigenverbs(sensor_pair->source()->eigenverbs()),
     _rcv_eigenverbs(sensor_pair->receiver()->eigenverbs()),
-    _eigenverb_interpolator(sensor_pair->receiver()->frequencies(),sensor_pair->frequencies())
+    _src_stream(src_stream),
+    _rcv_stream(rcv_stream)
 {
     write_lock_guard guard(_property_mutex);
 
@@ -63,24 +118,66 @@ envelope_generator::envelope_generator(
         receiver_params_map::instance()->find(rcv_params_ID);
 
     _rcv_beam_list = rcv_params->beam_list();
+    _reverb_duration = src_params->reverb_duration() ;
+    _pulse_length = src_params->pulse_length() ;
+    _time_axis.reset( create_travel_time() ) ;
+    std::fill( _pairs, _pairs + NUM_PRUNING_LEVELS, 0 ) ;
 
     add_envelope_listener(_sensor_pair);
 
-    _envelopes = envelope_collection::reference( new envelope_collection(
+    _envelopes = envelope_collection::reference( create_envelopes() ) ;
+    _beam_bins = beam_bins ;
+    if ( _beam_bins ) _envelopes->enable_bins() ;
+}
+
+/**
+ * Create the travel time axis for this sensor_pair.
+ */
+const seq_vector* envelope_generator::create_travel_time() const {
+	if ( samples_per_pulse <= 0.0 || _pulse_length <= 0.0 ) {
+		return _travel_time->clone() ;
+	}
+	double step = std::max( _pulse_length / samples_per_pulse,
+		std::max( min_time_step, 1e-6 ) ) ;
+
+	// a uniform axis at this step is the largest axis for any time_growth
+
+	const size_t max_samples = std::max( max_time_samples, (size_t) 2 ) ;
+	step = std::max( step, _reverb_duration / ( max_samples - 1 ) ) ;
+	if ( time_growth <= 0.0 ) {
+		return new seq_linear( 0.0, step, _reverb_duration ) ;
+	}
+
+	// sampling period grows with the two way travel time since transmission
+
+	std::vector<double> times ;
+	double time = 0.0 ;
+	do {
+		times.push_back( time ) ;
+		time += std::max( step, time_growth * ( _initial_time + time ) ) ;
+	} while ( time <= _reverb_duration ) ;
+	return new seq_data( &times[0], times.size() ) ;
+}
+
+/**
+ * Create an empty collection of envelopes for this sensor_pair.
+ */
+envelope_collection* envelope_generator::create_envelopes() const {
+    return new envelope_collection(
     	_sensor_pair->frequencies(),
-        src_freq_first,
-        _travel_time.get(),
-        src_params->reverb_duration(),
-        src_params->pulse_length(),
+        _src_freq_first,
+        _time_axis.get(),
+        _reverb_duration,
+        _pulse_length,
         pow(10.0,intensity_threshold/10.0),
-        num_azimuths,
+        _num_azimuths,
         _src_beam_list.size(),
         _rcv_beam_list.size(),
         _initial_time,
         _sensor_pair->source()->sensorID(),
         _sensor_pair->receiver()->sensorID(),
         _sensor_pair->source()->position(),
-        _sensor_pair->receiver()->position() ) ) ;
+        _sensor_pair->receiver()->position() ) ;
 }
 
 /**
@@ -88,95 +185,351 @@ envelope_generator::envelope_generator(
  */
 void envelope_generator::run() {
 
+	// precompute beam levels for the current sensor orientations
+
+	_src_gains = beam_gain_table::shared( _src_beam_list,
+		_envelopes->envelope_freq(), _sensor_pair->source()->orient() ) ;
+	_rcv_gains = beam_gain_table::shared( _rcv_beam_list,
+		_envelopes->envelope_freq(), _sensor_pair->receiver()->orient() ) ;
+
+	if ( _src_stream && _rcv_stream ) {
+		run_stream() ;
+		return ;
+	}
+
+	// create an accumulator for each partition
+	// the first partition accumulates directly into the final result,
+	// and all partitions add to the bins of the final result
+
+	const size_t partitions = std::max( num_partitions, (size_t) 1 ) ;
+	std::vector<envelope_collection*> accumulators( partitions ) ;
+	accumulators[0] = _envelopes.get() ;
+	for ( size_t p=1 ; p < partitions ; ++p ) {
+		accumulators[p] = create_envelopes() ;
+		if ( _beam_bins ) accumulators[p]->share_bins( *_envelopes ) ;
+	}
+
+	// distribute partitions across threads
+
+	size_t num_threads = max_threads ;
+	if ( num_threads == 0 ) {
+		num_threads = std::max( boost::thread::hardware_concurrency(), 1u ) ;
+	}
+	num_threads = std::min( num_threads, partitions ) ;
+
+	std::vector<size_t> counts( partitions * NUM_PRUNING_LEVELS, 0 ) ;
+	boost::thread_group workers ;
+	for ( size_t t=1 ; t < num_threads ; ++t ) {
+		workers.create_thread( boost::bind(
+			&envelope_generator::run_partitions, this,
+			t, num_threads, boost::cref(accumulators), &counts[0] ) ) ;
+	}
+	run_partitions( 0, num_threads, accumulators, &counts[0] ) ;
+	workers.join_all() ;
+
+	std::fill( _pairs, _pairs + NUM_PRUNING_LEVELS, 0 ) ;
+	for ( size_t p=0 ; p < partitions ; ++p ) {
+		for ( size_t n=0 ; n < NUM_PRUNING_LEVELS ; ++n ) {
+			_pairs[n] += counts[ p * NUM_PRUNING_LEVELS + n ] ;
+		}
+	}
+
+	// reduce partitions in a fixed order, so that results
+	// do not depend on the number of threads
+
+	for ( size_t p=1 ; p < partitions ; ++p ) {
+		if ( !_abort ) _envelopes->add_envelopes( *accumulators[p] ) ;
+		delete accumulators[p] ;
+	}
+	if ( _abort ) return ;
+	this->notify_envelope_listeners(_envelopes) ;
+}
+
+/**
+ * Computes the contributions for every partition assigned to one thread.
+ */
+void envelope_generator::run_partitions( size_t first, size_t step,
+	const std::vector<envelope_collection*>& accumulators, size_t* counts )
+{
+	for ( size_t p=first ; p < accumulators.size() && !_abort ; p += step ) {
+		run_partition( *_src_eigenverbs, *_rcv_eigenverbs,
+			p, accumulators.size(), accumulators[p],
+			counts + p * NUM_PRUNING_LEVELS ) ;
+	}
+}
+
+/**
+ * Computes the envelopes in streaming mode.
+ */
+void envelope_generator::run_stream() {
+	const size_t num_volumes = _src_stream->num_volumes() ;
+	const size_t num_interfaces = _src_stream->num_interfaces() ;
+	std::vector<size_t> src_read( num_interfaces, 0 ) ;
+	std::vector<size_t> rcv_read( num_interfaces, 0 ) ;
+	eigenverb_collection all_src( num_volumes ) ;
+	eigenverb_collection all_rcv( num_volumes ) ;
+	std::fill( _pairs, _pairs + NUM_PRUNING_LEVELS, 0 ) ;
+
+	// largest footprint variance, divided by the sound speed squared,
+	// of the eigenverbs read so far.  Bounds the duration of any pair that
+	// includes one of these eigenverbs, because the variance of an overlap
+	// can not exceed the variance of either footprint.
+
+	double max_spread = 0.0 ;
+
+	double horizon = 0.0 ;
+	bool finished = false ;
+	while ( !finished ) {
+
+		// wait for both wavefronts to pass the next horizon,
+		// check for closed streams before reading, so that
+		// the last segment includes every eigenverb
+
+		horizon += std::max( segment_duration, 1e-3 ) ;
+		while ( !_src_stream->wait( horizon, 100 ) || !_rcv_stream->wait( horizon, 100 ) ) {
+			if ( _abort ) return ;
+		}
+		if ( _abort || _src_stream->aborted() || _rcv_stream->aborted() ) return ;
+		const double watermark = std::min(
+			_src_stream->watermark(), _rcv_stream->watermark() ) ;
+		finished = _src_stream->closed() && _rcv_stream->closed() ;
+
+		// read the eigenverbs added since the last segment
+
+		eigenverb_collection new_src( num_volumes ) ;
+		eigenverb_collection new_rcv( num_volumes ) ;
+		for ( size_t n=0 ; n < num_interfaces ; ++n ) {
+			src_read[n] = _src_stream->read( n, src_read[n], &new_src ) ;
+			rcv_read[n] = _rcv_stream->read( n, rcv_read[n], &new_rcv ) ;
+		}
+
+		// merge them in the same way as the wavefront_generator,
+		// except that groups can not span two segments
+
+		new_src.merge_eigenverbs() ;
+		new_rcv.merge_eigenverbs() ;
+		for ( size_t n=0 ; n < num_interfaces ; ++n ) {
+			const eigenverb_array& src_verbs = new_src.eigenverbs(n) ;
+			for ( size_t v=0 ; v < src_verbs.size() ; ++v ) {
+				const double speed = src_verbs.sound_speed(v) ;
+				max_spread = std::max( max_spread, std::max( src_verbs.length2(v),
+					src_verbs.width2(v) ) / ( speed * speed ) ) ;
+			}
+			const eigenverb_array& rcv_verbs = new_rcv.eigenverbs(n) ;
+			for ( size_t v=0 ; v < rcv_verbs.size() ; ++v ) {
+				const double speed = rcv_verbs.sound_speed(v) ;
+				max_spread = std::max( max_spread, std::max( rcv_verbs.length2(v),
+					rcv_verbs.width2(v) ) / ( speed * speed ) ) ;
+			}
+		}
+		all_src.append( new_src ) ;
+		all_src.generate_rtrees() ;
+		new_src.generate_rtrees() ;
+
+		// pair new receivers with all sources, and
+		// new sources with the receivers from earlier segments
+
+		run_partition( all_src, new_rcv, 0, 1, _envelopes.get(), _pairs ) ;
+		run_partition( new_src, all_rcv, 0, 1, _envelopes.get(), _pairs ) ;
+		all_rcv.append( new_rcv ) ;
+		if ( _abort ) return ;
+
+		// publish a copy of the partial result,
+		// complete up to the point where the two way travel time
+		// could include eigenverbs that have not been read yet.
+		// each time series starts four durations before its two way
+		// travel time, so back off by the longest possible duration,
+		// which is never less than half a pulse length.
+
+		if ( !finished ) {
+			const double lead = 4.0 * 0.5 * sqrt( _pulse_length * _pulse_length
+				+ max_spread ) ;
+			envelope_collection::reference partial( create_envelopes() ) ;
+			partial->add_envelopes( *_envelopes ) ;
+			partial->complete_time( watermark - _initial_time - lead ) ;
+			this->notify_envelope_listeners( partial ) ;
+		}
+	}
+	this->notify_envelope_listeners( _envelopes ) ;
+}
+
+/**
+ * Computes the contributions for one partition of the receiver eigenverbs.
+ */
+void envelope_generator::run_partition(
+	const eigenverb_collection& src_eigenverbs,
+	const eigenverb_collection& rcv_eigenverbs,
+	size_t partition, size_t partitions,
+	envelope_collection* envelopes, size_t* counts )
+{
 	// create memory for work products
 
-    const seq_vector* freq = _envelopes->envelope_freq() ;
+    const seq_vector* freq = envelopes->envelope_freq() ;
     const size_t num_freq = freq->size() ;
 
 	vector<double> scatter( num_freq, 1.0 ) ;
-	matrix<double> src_beam( num_freq, _envelopes->num_src_beams(), 1.0 ) ;
-	matrix<double> rcv_beam( num_freq, _envelopes->num_rcv_beams(), 1.0 ) ;
+	matrix<double> src_beam( num_freq, envelopes->num_src_beams(), 1.0 ) ;
+	matrix<double> rcv_beam( num_freq, envelopes->num_rcv_beams(), 1.0 ) ;
+	matrix<double> reverse_src_beam( num_freq, envelopes->num_src_beams(), 1.0 ) ;
+	matrix<double> reverse_rcv_beam( num_freq, envelopes->num_rcv_beams(), 1.0 ) ;
+
+	std::vector<value_pair> result_s ;
+
+	// bound on the intensity of any contribution, relative to the power
+	// of the receiver eigenverb, from the overlap scale of 0.125*pulse_length
+	// divided by the minimum duration of 0.5*pulse_length
+
+	const double threshold = envelopes->threshold() ;
+	const double scatter_bound = 0.25 * pow( 10.0, max_scattering / 10.0 ) ;
+
+	// monostatic sensors use the same eigenverbs for source and receiver,
+	// so each unordered pair is evaluated once, in both directions
+
+	const bool symmetric = !_sensor_pair->multistatic()
+		&& &src_eigenverbs == &rcv_eigenverbs && _src_freq_first == 0 ;
+
+	// receiver eigenverbs on the envelope frequencies,
+	// shared with other pairs that use this receiver
 
-	eigenverb rcv_verb ;
-	rcv_verb.frequencies = freq ;
-	rcv_verb.power = vector<double>( num_freq ) ;
+	const eigenverb_collection::reference rcv_interpolated =
+		rcv_eigenverbs.interpolated( freq ) ;
 
-	// loop through eigenrays for each interface
+	// loop through this partition's eigenverbs for each interface
 
-	for ( size_t interface=0 ; interface < _rcv_eigenverbs->num_interfaces() ; ++interface) {
+	for ( size_t interface=0 ; interface < rcv_eigenverbs.num_interfaces() ; ++interface) {
+		const eigenverb_array& rcv_verbs = rcv_interpolated->eigenverbs(interface) ;
+		const eigenverb_array& src_verbs = src_eigenverbs.eigenverbs(interface) ;
+		const size_t first = rcv_verbs.size() * partition / partitions ;
+		const size_t last = rcv_verbs.size() * ( partition + 1 ) / partitions ;
+		const double src_max_power = src_eigenverbs.max_power(interface) ;
 
-		BOOST_FOREACH( eigenverb verb, _rcv_eigenverbs->eigenverbs(interface) ) {
-			_eigenverb_interpolator.interpolate(verb,&rcv_verb) ;
+		for ( size_t n=first ; n < last ; ++n ) {
+			if ( _abort ) return ;
+			const eigenverb_frame& rcv_frame = rcv_verbs.frame(n) ;
+			const double rcv_length = rcv_verbs.length(n) ;
+			const double rcv_width = rcv_verbs.width(n) ;
 
 			// Cull eigenverbs down with rtree.query
-			std::vector<value_pair> result_s;
-			_src_eigenverbs->query_rtree(interface, rcv_verb, result_s);
+			// only keep sources whose footprint overlaps the receiver and
+			// whose contribution reaches the reverberation time axis
+
+			// pad the time window by the longest time series that any source
+			// can create with this receiver, because the peak is delayed by one
+			// duration, and the series extends five durations either side of it.
+			// the spatial variance of an overlap can not exceed the largest
+			// variance of the receiver footprint
+
+			const double rcv_speed = rcv_verbs.sound_speed(n) ;
+			const double max_duration = 0.5 * sqrt( _pulse_length * _pulse_length
+				+ max( rcv_verbs.length2(n), rcv_verbs.width2(n) ) / ( rcv_speed * rcv_speed ) ) ;
+			const double min_time = _initial_time - rcv_verbs.time(n) - 6.0 * max_duration ;
+			const double max_time = _initial_time - rcv_verbs.time(n) + _reverb_duration
+				+ 6.0 * max_duration ;
+
+			// skip this receiver eigenverb if even the strongest source,
+			// with a point sized footprint, can not reach the threshold
+
+			const double rcv_bound = scatter_bound * rcv_verbs.max_power(n) ;
+			const double min_power = ( rcv_bound > 0.0 ) ?
+				threshold * rcv_length * rcv_width / rcv_bound
+				: std::numeric_limits<double>::max() ;
+			if ( max_time < 0.0 || min_power > src_max_power ) {
+				counts[PRUNED_RECEIVER] += src_verbs.size() ;
+				continue ;
+			}
+
+			result_s.clear() ;
+			src_eigenverbs.query_rtree(interface, rcv_verbs, n,
+				min_time, max_time, min_power, result_s);
+			counts[PRUNED_INDEX] += src_verbs.size() - result_s.size() ;
 
 			BOOST_FOREACH( value_pair const& vp, result_s ) {
 
-				eigenverb src_verb = *(vp.second);
+				const size_t src = vp.second ;
+				if ( symmetric && src > n ) continue ;	// evaluated with src as receiver
+				const bool reciprocal = symmetric && src != n ;
 
-				// determine relative range and bearing between the projected Gaussians
-				// skip this combo if source peak too far away
+				// skip this combo if the source footprint is too large
+				// for its power to reach the threshold
 
-			    double bearing ;
-			    const double range = rcv_verb.position.gc_range( src_verb.position, &bearing ) ;
-			    if ( range > distance_threshold * max(rcv_verb.length,rcv_verb.width)) continue ;
+				const double src_min2 = min( src_verbs.length2(src), src_verbs.width2(src) ) ;
+				if ( rcv_bound * src_verbs.max_power(src) <= threshold * sqrt(
+						( src_min2 + rcv_verbs.length2(n) ) * ( src_min2 + rcv_verbs.width2(n) ) ) )
+				{
+					++counts[PRUNED_BOUND] ;
+					continue ;
+				}
 
-			    if ( range < 1e-6 ) bearing = 0 ;	// fixes bearing = NaN
-			    bearing -= rcv_verb.direction ;		// relative bearing
+				// determine relative position of the source in the receiver's frame
+				// skip this combo if source peak too far away
 
-			    const double ys = range * cos( bearing ) ;
+				const eigenverb_frame& src_frame = src_verbs.frame(src) ;
+			    const double ys = rcv_frame.offset_length( src_frame ) ;
 			    const double ys2 = ys * ys ;
-			    if ( abs(ys) > distance_threshold * rcv_verb.length ) continue ;
-
-			    const double xs = range * sin( bearing ) ;
+			    const double xs = rcv_frame.offset_width( src_frame ) ;
 			    const double xs2 = xs * xs ;
-			    if ( abs(xs) > distance_threshold * rcv_verb.width ) continue ;
+			    const double range2 = xs2 + ys2 ;
+			    const double rcv_max = distance_threshold * max(rcv_length,rcv_width) ;
+			    const bool forward =
+			    	range2 <= rcv_max * rcv_max
+			    	&& abs(ys) <= distance_threshold * rcv_length
+			    	&& abs(xs) <= distance_threshold * rcv_width ;
+
+			    // repeat this test with src as the receiver,
+			    // using the position of the receiver in the source's frame
+
+			    bool reverse = false ;
+			    if ( reciprocal ) {
+			    	const double src_max = distance_threshold
+			    		* max(src_verbs.length(src),src_verbs.width(src)) ;
+			    	reverse =
+			    		range2 <= src_max * src_max
+			    		&& abs(src_frame.offset_length(rcv_frame)) <= distance_threshold * src_verbs.length(src)
+			    		&& abs(src_frame.offset_width(rcv_frame)) <= distance_threshold * src_verbs.width(src) ;
+			    }
+			    if ( !forward && !reverse ) continue ;
 
 				// compute interface scattering strength
 			    // skip this combo if scattering strength is trivial
 
 				if ( ! scattering( interface,
-					 rcv_verb.position, *freq,
-					 src_verb.grazing, rcv_verb.grazing,
-					 src_verb.direction, rcv_verb.direction,
+					 rcv_verbs.position(n), *freq,
+					 src_verbs.grazing(src), rcv_verbs.grazing(n),
+					 src_verbs.direction(src), rcv_verbs.direction(n),
 					 &scatter ) ) continue ;
 
 				// compute beam levels
 
-				src_beam = beam_gain(_src_beam_list, freq, src_verb.source_de,
-					src_verb.source_az, _sensor_pair->source()->orient());
-				rcv_beam = beam_gain(_rcv_beam_list, freq, rcv_verb.source_de,
-					rcv_verb.source_az, _sensor_pair->receiver()->orient());
+				_src_gains->gain( src_verbs.source_de(src), src_verbs.source_az(src), &src_beam ) ;
+				_rcv_gains->gain( rcv_verbs.source_de(n), rcv_verbs.source_az(n), &rcv_beam ) ;
 
 				// create envelope contribution
 
-				_envelopes->add_contribution( src_verb, rcv_verb,
-						src_beam, rcv_beam, scatter, xs2, ys2 ) ;
+				if ( !reciprocal ) {
+					if ( envelopes->add_contribution( src_verbs, src, rcv_verbs, n,
+							src_beam, rcv_beam, scatter, xs2, ys2 ) )
+					{
+						++counts[CONTRIBUTED] ;
+					} else {
+						++counts[PRUNED_OVERLAP] ;
+					}
+					continue ;
+				}
+
+				// swap the roles of the eigenverbs for the reverse direction
+
+				_src_gains->gain( rcv_verbs.source_de(n), rcv_verbs.source_az(n), &reverse_src_beam ) ;
+				_rcv_gains->gain( src_verbs.source_de(src), src_verbs.source_az(src), &reverse_rcv_beam ) ;
+				const size_t directions = ( forward ? 1 : 0 ) + ( reverse ? 1 : 0 ) ;
+				const size_t added = envelopes->add_monostatic_contribution(
+						src_verbs, src, rcv_verbs, n,
+						src_beam, rcv_beam, reverse_src_beam, reverse_rcv_beam,
+						scatter, xs2, ys2, forward, reverse ) ;
+				counts[CONTRIBUTED] += added ;
+				counts[PRUNED_OVERLAP] += directions - added ;
 			}
 		}
 	}
-	this->notify_envelope_listeners(_envelopes) ;
-}
-
-/**
- * Computes the beam_gain
- */
-matrix<double> envelope_generator::beam_gain(
-    sensor_params::beam_pattern_list beam_list,
-    const seq_vector* freq, double de_rad, double az_rad, orientation orient)
-{
-    const vector<double> frequencies = *freq;	// beam_level requires ublas vector
-    matrix<double> beam_matrix( freq->size(), beam_list.size() ) ;
-    vector<double> level( freq->size(), 0.0 ) ;
-    BOOST_FOREACH( beam_pattern_model::id_type id, beam_list) {
-        beam_pattern_model::reference bp = beam_pattern_map::instance()->find(id);
-        bp->beam_level(de_rad, az_rad, orient, frequencies, &level ) ;
-
-        std::copy(level.begin(), level.end(), beam_matrix.begin1());
-    }
-    return beam_matrix;
 }
 
 /**
@@ -9,8 +9,10 @@
 #include <usml/sensors/sensor_manager.h>
 #include <usml/sensors/sensor_model.h>
 #include <usml/sensors/sensor_params.h>
+#include <usml/sensors/beam_gain_table.h>
 #include <usml/eigenverb/eigenverb_collection.h>
 #include <usml/eigenverb/eigenverb_interpolator.h>
+#include <usml/eigenverb/eigenverb_stream.h>
 #include <usml/eigenverb/envelope_notifier.h>
 
 namespace usml {
@@ -44,6 +46,23 @@ using namespace usml::threads;
  * updates its eigenverbs. If an existing envelope_generator is running for
  * this sensor_pair, that task is aborted before the new envelope_generator
  * is created.
+ *
+ * In streaming mode, the generator reads eigenverbs from the
+ * eigenverb_stream of each sensor while their wavefronts are still running.
+ * Each time both streams advance by segment_duration, the contributions of
+ * the new eigenverbs are added to the envelopes, and a copy of the partial
+ * result is published to the envelope listeners. The complete_time() of
+ * each copy marks the end of the portion of the time axis that is final.
+ * It is backed off from the stream watermarks by four times the longest
+ * duration of the eigenverbs read so far, because each contribution
+ * starts that far ahead of its two way travel time.
+ * When both streams are closed, the complete envelopes are published as
+ * the final result, and the sensor_pair does not repeat the pair search
+ * for these eigenverbs, unless the initial time estimated when the
+ * streams started differs from the actual one by more than one time step.  The eigenverbs of each segment are merged by
+ * eigenverb_collection::merge_eigenverbs() before they are used, so the
+ * partial and final results use the same merged eigenverbs. Unlike the
+ * merge in the wavefront_generator, groups do not span segments.
  */
 class USML_DECLSPEC envelope_generator: public thread_task, public envelope_notifier {
 public:
@@ -61,6 +80,121 @@ public:
      */
     static double distance_threshold;
 
+    /**
+     * Number of partitions into which the receiver eigenverbs are divided.
+     * Each partition accumulates its contributions into its own
+     * envelope_collection, and these are summed in partition order
+     * at the end of run().  Because the partitioning does not depend on
+     * the number of threads, the results are identical for any value of
+     * max_threads. Larger values allow more threads to be used, at the
+     * cost of one extra envelope_collection per partition. Defaults to 4.
+     */
+    static size_t num_partitions;
+
+    /**
+     * Maximum number of threads used to process partitions.
+     * Each envelope_generator already runs as a task in the
+     * thread_controller's pool, so extra threads in every task would
+     * oversubscribe the machine when several sensor_pairs are updated
+     * at once. Defaults to 1, which processes all partitions in the
+     * calling thread. Set to zero to use the number of hardware threads,
+     * which is only useful when few sensor_pairs are updated at a time.
+     */
+    static size_t max_threads;
+
+    /**
+     * Upper limit on the interface scattering strength (dB), used to
+     * prune source/receiver pairs that can not exceed the
+     * intensity_threshold before their scattering strength is computed.
+     * Defaults to 0 dB, which is larger than any physical scattering
+     * strength. Set to a large value to disable power pruning.
+     */
+    static double max_scattering;
+
+    /**
+     * Interval of one way travel time between the partial results
+     * published in streaming mode (sec). Defaults to 5.0.
+     */
+    static double segment_duration;
+
+    /**
+     * Number of travel time samples per pulse length, used to choose the
+     * sampling period of each envelope_generator's travel time axis.
+     * Because the duration of each Gaussian contribution is at least half
+     * of the pulse length, a value of 4.0 samples each contribution at
+     * least twice per standard deviation. Defaults to zero, which uses
+     * the fixed travel_time() axis for all sensor_pairs.
+     */
+    static double samples_per_pulse;
+
+    /**
+     * Largest number of samples on the adaptive travel time axis.
+     * The sampling period is increased above that chosen from
+     * samples_per_pulse and min_time_step to stay within this limit,
+     * so that short pulses and long reverberation durations can not
+     * create arbitrarily large envelopes. Defaults to 10000.
+     */
+    static size_t max_time_samples;
+
+    /**
+     * Smallest sampling period allowed on the adaptive travel time axis
+     * (sec). Limits the size of the envelopes for very short pulses.
+     * Defaults to 0.001.
+     */
+    static double min_time_step;
+
+    /**
+     * Growth in the sampling period of the adaptive travel time axis,
+     * as a fraction of the two way travel time since transmission.
+     * Contributions from long ranges are spread out in time by the size
+     * of their footprints, so they can be sampled less often.  The sampling
+     * period at each time is the larger of pulse_length/samples_per_pulse
+     * and time_growth times the sum of the initial time and the time on the
+     * axis. Defaults to zero, which creates a uniform axis.
+     */
+    static double time_growth;
+
+    /**
+     * Also store the beam independent contributions in the envelope_bins
+     * of the result, so that sensor_pair::update_beams() can rebuild the
+     * envelopes for new beams or steering without repeating the eigenverb
+     * pair search. All partitions add to the bins of the result, instead
+     * of creating their own.  The partial results published in streaming
+     * mode do not include bins.  Defaults to false, because the bins can use more
+     * memory than the envelopes themselves.
+     */
+    static bool beam_bins;
+
+    /**
+     * Stages at which source/receiver eigenverb pairs are removed
+     * from the reverberation calculation, used as an index into pairs().
+     *
+     *    - PRUNED_RECEIVER: pairs skipped because the receiver eigenverb
+     *      arrives after the end of the time axis, or because its power
+     *      can not reach the threshold even with the strongest source.
+     *    - PRUNED_INDEX: pairs skipped by the rtree query, because their
+     *      footprints do not overlap, their Gaussian time series can not
+     *      reach the time axis, or because the maximum source power for the
+     *      whole subtree can not reach the threshold.
+     *    - PRUNED_BOUND: candidates whose power bound, using their
+     *      own peak power and smallest footprint dimension, can not
+     *      reach the threshold.
+     *    - PRUNED_OVERLAP: candidates rejected after the full overlap
+     *      calculation in envelope_model::compute_overlap().
+     *    - CONTRIBUTED: pairs added to the reverberation envelopes.
+     *
+     * Pairs rejected by the distance_threshold or by the scattering
+     * strength are not included in any of these counts.
+     */
+    enum pruning_level {
+        PRUNED_RECEIVER = 0,
+        PRUNED_INDEX,
+        PRUNED_BOUND,
+        PRUNED_OVERLAP,
+        CONTRIBUTED,
+        NUM_PRUNING_LEVELS
+    };
+
     /**
      * Constructor - Initialize model parameters and reserve memory.
      *
@@ -70,13 +204,20 @@ public:
      *                          source frequencies seq_vector.  Used to map
      *                          source eigenverbs onto envelope_freq values.
      * @param num_azimuths      Number of receiver azimuths in result.
+     * @param src_stream        Eigenverbs streamed from the source wavefront.
+     *                          Uses streaming mode if this and rcv_stream are
+     *                          both defined, and the sensors' last
+     *                          eigenverb_collection otherwise.
+     * @param rcv_stream        Eigenverbs streamed from the receiver wavefront.
      */
 
     envelope_generator(
         sensor_pair* sensor_pair,
         double initial_time,
         size_t src_freq_first,
-        size_t num_azimuths ) ;
+        size_t num_azimuths,
+        eigenverb_stream::reference src_stream = eigenverb_stream::reference(),
+        eigenverb_stream::reference rcv_stream = eigenverb_stream::reference() ) ;
 
     /**
      * Virtual destructor
@@ -88,8 +229,9 @@ public:
      * Executes the Eigenverb reverberation model.  For each receiver eigenverb,
      * it loops through the list of source eigenverbs looking for overlaps.
      *
-     * First, it computes the great circle range and bearing of the source
-     * relative to the receiver.  The combination is skipped if the location
+     * First, it computes the offset of the source along the length and width
+     * axes of the receiver, using the eigenverb_frame that was precomputed
+     * for each eigenverb.  The combination is skipped if the location
      * of the source (its peak intensity) is more than three (3) times the
      * length/width of the receiver eigenverb,
      * Next, it computes the scattering strength and beam patterns for
@@ -97,11 +239,18 @@ public:
      * Finally, it uses the evelope_collection.add_contribution() method
      * to add this this source/receiver combination to the reverberation
      * envelopes.
+     *
+     * The receiver eigenverbs on each interface are divided into
+     * num_partitions contiguous blocks, which are processed in parallel
+     * by up to max_threads threads.
      */
     virtual void run() ;
 
     /**
-     * Time axis for reverberation calculation.
+     * Fixed time axis for reverberation calculation. Used for all
+     * sensor_pairs by default, because samples_per_pulse defaults to zero.
+     * Ignored if samples_per_pulse is positive, unless the pulse length
+     * is not positive.
      */
     static const seq_vector* travel_time() {
         write_lock_guard guard(_property_mutex);
@@ -109,7 +258,7 @@ public:
     }
 
     /**
-     * Resets time axis for reverberation calculation.
+     * Resets fixed time axis for reverberation calculation.
      */
     static void travel_time( const seq_vector* time ) {
         write_lock_guard guard(_property_mutex);
@@ -123,20 +272,96 @@ public:
         return _done;
     }
 
+    /**
+     * Number of source/receiver eigenverb pairs removed at a specific
+     * stage of the last run(). Only valid once done() is true.
+     *
+     * @param level     Stage at which pairs were counted.
+     */
+    size_t pairs( pruning_level level ) const {
+        return _pairs[level];
+    }
+
 private:
 
     /**
-     * Computes the beam_gain matrix
+     * Create the travel time axis for this sensor_pair. Spans the
+     * reverb_duration with a sampling period chosen from the pulse length,
+     * initial time, samples_per_pulse, min_time_step, max_time_samples
+     * and time_growth.
+     * Uses a copy of the fixed travel_time() axis if samples_per_pulse is
+     * zero, or if the pulse length is not positive.
+     * Assumes that the caller holds the lock on the static properties.
+     */
+    const seq_vector* create_travel_time() const ;
+
+    /**
+     * Create an empty collection of envelopes for this sensor_pair.
+     * Used for the final result and for each partition's accumulator.
+     */
+    envelope_collection* create_envelopes() const ;
+
+    /**
+     * Computes the contributions for every partition assigned to
+     * one thread. Processes partitions first, first+step, first+2*step, etc.
      *
-     * @param beam_list Location at which to compute attenuation.
-     * @param freq      Frequencies to get beam levels (Hz)
-     * @param de_rad    Depression incident angle (radians).
-     * @param az_rad    Azimuthal incident angle  (radians).
-     * @param orient    orientation
+     * @param first         First partition for this thread.
+     * @param step          Number of threads.
+     * @param accumulators  Envelopes for each partition.
+     * @param counts        Pair counts for each partition, organized as
+     *                      [partition][pruning_level].
      */
-    matrix<double> beam_gain( sensor_params::beam_pattern_list beam_list,
-            const seq_vector* freq, double de_rad, double az_rad,
-            orientation orient);
+    void run_partitions( size_t first, size_t step,
+        const std::vector<envelope_collection*>& accumulators,
+        size_t* counts ) ;
+
+    /**
+     * Computes the envelopes in streaming mode.  Waits for both streams to
+     * advance by segment_duration, then adds the contributions of every
+     * pair of eigenverbs in which at least one member is new.  New receiver
+     * eigenverbs are paired with all source eigenverbs read so far, and
+     * new source eigenverbs are paired with the receiver eigenverbs
+     * from earlier segments, so that each pair is only added once.
+     * Returns without publishing the final result if either wavefront,
+     * or this task, is aborted.
+     */
+    void run_stream() ;
+
+    /**
+     * Computes the contributions for one partition of the
+     * receiver eigenverbs.
+     *
+     * Before the rtree query, an upper bound on the intensity of any
+     * contribution for this receiver eigenverb is computed from the
+     * results of envelope_model::compute_overlap(). The overlap exponential
+     * is at most one, the duration is at least half the pulse length, and
+     * the determinant of the combined Gaussians is at least
+     * \f$ (m^2 + L_r^2)(m^2 + W_r^2) \f$, where m is the smallest
+     * dimension of the source footprint. The rtree query skips all sources
+     * whose peak power could not exceed the threshold when m is zero,
+     * and each remaining candidate is checked again using its own m.
+     *
+     * If the sensor_pair is monostatic, and the source and receiver
+     * collections are the same object, each unordered pair of eigenverbs is
+     * only evaluated once, when the eigenverb with the larger index is the
+     * receiver.  The power of the overlap is computed for this ordering and
+     * reused in both directions, but each ordering uses its own duration,
+     * threshold test, beam levels, azimuth, and distance_threshold test.
+     * The scattering strength is assumed to be reciprocal.
+     *
+     * @param src_eigenverbs Source eigenverbs, with rtrees.
+     * @param rcv_eigenverbs Receiver eigenverbs, on the receiver frequencies.
+     *                      Their interpolated() copy on the envelope
+     *                      frequencies is shared with other sensor_pairs.
+     * @param partition     Partition number.
+     * @param partitions    Total number of partitions.
+     * @param envelopes     Envelopes in which to accumulate results.
+     * @param counts        Pair counts for this partition (output).
+     */
+    void run_partition( const eigenverb_collection& src_eigenverbs,
+        const eigenverb_collection& rcv_eigenverbs,
+        size_t partition, size_t partitions,
+        envelope_collection* envelopes, size_t* counts ) ;
 
     /**
      * Computes the broadband scattering strength for a specific interface.
@@ -195,6 +420,20 @@ private:
      * Receiver Beam Pattern List.
      */
     sensor_params::beam_pattern_list _rcv_beam_list;
+
+    /**
+     * Source beam levels, precomputed at the start of run() using the
+     * current orientation of the source. Shared with other tasks that
+     * use the same beams, orientation, and frequencies.
+     */
+    beam_gain_table::reference _src_gains ;
+
+    /**
+     * Receiver beam levels, precomputed at the start of run() using the
+     * current orientation of the receiver. Shared with other tasks that
+     * use the same beams, orientation, and frequencies.
+     */
+    beam_gain_table::reference _rcv_gains ;
     
 
     /**
@@ -207,10 +446,32 @@ private:
      */
     eigenverb_collection::reference _rcv_eigenverbs;
 
-    /**
-     * Utility used to interpolate eigenrays.
-     */
-    eigenverb_interpolator _eigenverb_interpolator ;
+    /** Eigenverbs streamed from the source wavefront, if any. */
+    eigenverb_stream::reference _src_stream;
+
+    /** Eigenverbs streamed from the receiver wavefront, if any. */
+    eigenverb_stream::reference _rcv_stream;
+
+    /** Index of the first source frequency that overlaps receiver. */
+    size_t _src_freq_first ;
+
+    /** Number of receiver azimuths in result. */
+    size_t _num_azimuths ;
+
+    /** Length of time in seconds the reverb is to be calculated. */
+    double _reverb_duration ;
+
+    /** Duration of the transmitted pulse (sec). */
+    double _pulse_length ;
+
+    /** Travel time axis for the envelopes of this sensor_pair. */
+    unique_ptr<const seq_vector> _time_axis ;
+
+    /** Store beam independent contributions in the result. */
+    bool _beam_bins ;
+
+    /** Number of eigenverb pairs removed at each stage of the last run(). */
+    size_t _pairs[NUM_PRUNING_LEVELS] ;
 
     /**
      * Collection of envelopes generated by this calculation.
@@ -7,11 +7,37 @@
 #include <boost/numeric/ublas/vector_proxy.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <usml/eigenverb/envelope_model.h>
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cstring>
 
 using namespace usml::eigenverb;
 
 //#define DEBUG_ENVELOPE
 
+/**
+ * Fast approximation of exp(x) for the Gaussian time series.
+ * Splits x into n*ln(2) + r, with |r| <= ln(2)/2, evaluates exp(r) with
+ * a 7th order polynomial, and builds 2^n directly in the exponent bits.
+ * Relative error is less than 1e-8 over the [-12.5,0] domain used by
+ * compute_time_series(). Contains no branches or library calls other than
+ * floor(), so that compilers can vectorize loops that use it.
+ */
+static inline double gaussian_exp( double x ) {
+	const double log2e = 1.4426950408889634 ;
+	const double ln2 = 0.6931471805599453 ;
+	x = std::max( x, -700.0 ) ;
+	const double n = floor( x * log2e + 0.5 ) ;
+	const double r = x - n * ln2 ;
+	const double p = 1.0 + r * ( 1.0 + r * ( 1.0/2.0 + r * ( 1.0/6.0
+		+ r * ( 1.0/24.0 + r * ( 1.0/120.0 + r * ( 1.0/720.0
+		+ r * ( 1.0/5040.0 ) ) ) ) ) ) ) ;
+	const boost::int64_t bits = ( (boost::int64_t) n + 1023 ) << 52 ;
+	double scale ;
+	std::memcpy( &scale, &bits, sizeof(scale) ) ;
+	return p * scale ;
+}
+
 /**
  * Reserve the memory used to store the results of this calculation.
  */
@@ -29,11 +55,20 @@ envelope_model::envelope_model(
 	_initial_time(initial_time),
 	_pulse_length(pulse_length),
 	_threshold(threshold),
-	_level(travel_time->size()),
 	_power(envelope_freq->size()),
 	_duration(envelope_freq->size()),
-	_intensity(envelope_freq->size(), travel_time->size())
+	_cos2alpha(1.0),
+	_det_sr(1.0),
+	_intensity(envelope_freq->size(), travel_time->size()),
+	_times(travel_time->size()),
+	_gaussian(travel_time->size()),
+	_window_first(0),
+	_window_last(0)
 {
+	_intensity.clear() ;
+	for ( size_t n=0 ; n < _times.size() ; ++n ) {
+		_times[n] = (*travel_time)(n) ;
+	}
 }
 
 /**
@@ -48,13 +83,14 @@ envelope_model::~envelope_model() {
  * to this time series.
  */
 bool envelope_model::compute_intensity(
-		const eigenverb& src_verb, const eigenverb& rcv_verb,
+		const eigenverb_array& src_verbs, size_t src,
+		const eigenverb_array& rcv_verbs, size_t rcv,
 		const vector<double>& scatter, double xs2, double ys2 )
 {
-	bool ok = compute_overlap( src_verb, rcv_verb, scatter, xs2, ys2 );
+	bool ok = compute_overlap( src_verbs, src, rcv_verbs, rcv, scatter, xs2, ys2 );
 	if ( !ok ) return false ;
 
-	compute_time_series( src_verb.time, rcv_verb.time ) ;
+	compute_time_series( src_verbs.time(src), rcv_verbs.time(rcv) ) ;
 	return true ;
 }
 
@@ -62,10 +98,15 @@ bool envelope_model::compute_intensity(
  * Compute the total power of the overlap between two eigenverbs.
  */
 bool envelope_model::compute_overlap(
-	const eigenverb& src_verb, const eigenverb& rcv_verb,
+	const eigenverb_array& src_verbs, size_t src,
+	const eigenverb_array& rcv_verbs, size_t rcv,
 	const vector<double>& scatter, double xs2, double ys2 )
 {
 	#ifdef DEBUG_ENVELOPE
+		eigenverb src_verb ;
+		src_verbs.get( src, &src_verb ) ;
+		eigenverb rcv_verb ;
+		rcv_verbs.get( rcv, &rcv_verb ) ;
 		cout << "wave_queue::compute_overlap() " << endl
 			<< "\txs2=" << xs2
 			<< " ys2=" << ys2
@@ -96,47 +137,50 @@ bool envelope_model::compute_overlap(
 
 	// determine the relative tilt between the projected Gaussians
 
-	const double alpha = src_verb.direction - rcv_verb.direction;
-	const double cos2alpha = cos(2.0 * alpha);
-	const double sin2alpha = sin(2.0 * alpha);
+	const eigenverb_frame& src_frame = src_verbs.frame(src) ;
+	const eigenverb_frame& rcv_frame = rcv_verbs.frame(rcv) ;
+	double cos2alpha, sin2alpha ;
+	rcv_frame.relative_direction( src_frame, &cos2alpha, &sin2alpha ) ;
 
 	// define subset of frequency dependent terms in source
-    // Although the use of const_cast<> allows us to ignore the read-only
-    // nature of src_verb, we are *very careful* to not write anything to it.
 
-	range window( _src_freq_first, _src_freq_first + _envelope_freq->size() ) ;
-	eigenverb& verb = const_cast<eigenverb&>( src_verb ) ;
-	const vector_range< vector<double> > src_verb_power( verb.power, window ) ;
+	const double* src_verb_power = src_verbs.power(src) + _src_freq_first ;
+	const double* rcv_verb_power = rcv_verbs.power(rcv) ;
+	const double rcv_length2 = rcv_verbs.length2(rcv) ;
+	const double rcv_width2 = rcv_verbs.width2(rcv) ;
 
-    // compute commonly used terms in the intersection of the Gaussian profiles
+    // commonly used terms in the intersection of the Gaussian profiles
+	// are precomputed for each eigenverb
 
-	const double src_sum = src_verb.length2 + src_verb.width2 ;
-	const double src_diff = src_verb.length2 - src_verb.width2 ;
-	const double src_prod = src_verb.length2 * src_verb.width2 ;
+	const double src_sum = src_frame.sum ;
+	const double src_diff = src_frame.diff ;
+	const double src_prod = src_frame.prod ;
 
-	const double rcv_sum = rcv_verb.length2 + rcv_verb.width2 ;
-	const double rcv_diff = rcv_verb.length2 - rcv_verb.width2 ;
-	const double rcv_prod = rcv_verb.length2 * rcv_verb.width2 ;
+	const double rcv_sum = rcv_frame.sum ;
+	const double rcv_diff = rcv_frame.diff ;
+	const double rcv_prod = rcv_frame.prod ;
 
     // compute the scaling of the exponential
     // equations (26) and (28) from the paper
 
     double det_sr = 0.5 * ( 2.0 * ( src_prod + rcv_prod )
     		+ ( src_sum * rcv_sum ) - ( src_diff * rcv_diff ) * cos2alpha ) ;
-    noalias(_power) = 0.25 * 0.5 * _pulse_length
-    		* src_verb_power * rcv_verb.power * scatter ;
+    const double scale = 0.25 * 0.5 * _pulse_length ;
+    for ( size_t f = 0 ; f < _power.size() ; ++f ) {
+    	_power[f] = scale * src_verb_power[f] * rcv_verb_power[f] * scatter[f] ;
+    }
 
     // compute the power of the exponential
     // equation (28) from the paper
 
     const double new_prod = src_diff * cos2alpha ;
     const double kappa = -0.25 * (
-  		  xs2 * ( src_sum + new_prod + 2.0 * rcv_verb.length2 )
-		+ ys2 * ( src_sum - new_prod + 2.0 * rcv_verb.width2 )
+  		  xs2 * ( src_sum + new_prod + 2.0 * rcv_length2 )
+		+ ys2 * ( src_sum - new_prod + 2.0 * rcv_width2 )
 		- 2.0 * sqrt( xs2 * ys2 ) * src_diff * sin2alpha )
 		/ det_sr ;
 	#ifdef DEBUG_ENVELOPE
-		cout << "\tsrc_verb_power=" << src_verb_power
+		cout << "\tsrc_verb_power=" << src_verb.power
 			 << " rcv_verb.power=" << rcv_verb.power << endl
 			 << "\tdet_sr=" << det_sr
 			 << " kappa=" << kappa
@@ -144,22 +188,12 @@ bool envelope_model::compute_overlap(
 	#endif
 	_power *= exp( kappa ) / sqrt( det_sr ) ;
 
-    // compute the square of the duration of the overlap
-    // equation (41) from the paper
-
-    det_sr = det_sr / ( src_prod * rcv_prod ) ;
-	_duration = 0.5 * (
-			( 1.0 / src_verb.width2 + 1.0 / src_verb.length2 )
-			+ ( 1.0 / src_verb.width2 - 1.0 / src_verb.length2 ) * cos2alpha
-			+ 2.0 / rcv_verb.width2
-			) / det_sr ;
-
-	// combine duration of the overlap with pulse length
-	// equation (33) from the paper
+    // compute the duration, saving the terms that are
+    // shared by both orderings of the eigenverbs
 
-	const double factor = cos( rcv_verb.grazing ) / rcv_verb.sound_speed ;
-	_duration = 0.5 * sqrt( _pulse_length * _pulse_length
-			+ factor * factor * _duration ) ;
+    _cos2alpha = cos2alpha ;
+    _det_sr = det_sr / ( src_prod * rcv_prod ) ;
+	_duration = compute_duration( src_frame, rcv_verbs, rcv ) ;
 	#ifdef DEBUG_ENVELOPE
 		cout << "\tcontribution"
 			<< " duration=" << _duration
@@ -168,6 +202,48 @@ bool envelope_model::compute_overlap(
 
 	// check threshold to avoid calculations for weak signals
 
+	return above_threshold() ;
+}
+
+/**
+ * Computes the intensity for the reverse ordering of the last pair.
+ */
+bool envelope_model::compute_reverse_intensity(
+		const eigenverb_array& src_verbs, size_t src,
+		const eigenverb_array& rcv_verbs, size_t rcv )
+{
+	_duration = compute_duration( rcv_verbs.frame(rcv), src_verbs, src ) ;
+	if ( !above_threshold() ) return false ;
+	compute_time_series( rcv_verbs.time(rcv), src_verbs.time(src) ) ;
+	return true ;
+}
+
+/**
+ * Computes the duration of a contribution.
+ */
+double envelope_model::compute_duration( const eigenverb_frame& src_frame,
+		const eigenverb_array& rcv_verbs, size_t rcv ) const
+{
+    // compute the square of the duration of the overlap
+    // equation (41) from the paper
+
+	const double duration = 0.5 * (
+			( src_frame.sum + src_frame.diff * _cos2alpha ) / src_frame.prod
+			+ 2.0 / rcv_verbs.width2(rcv)
+			) / _det_sr ;
+
+	// combine duration of the overlap with pulse length
+	// equation (33) from the paper
+
+	const double factor = rcv_verbs.slowness(rcv) ;
+	return 0.5 * sqrt( _pulse_length * _pulse_length
+			+ factor * factor * duration ) ;
+}
+
+/**
+ * True if the power divided by the duration exceeds the threshold.
+ */
+bool envelope_model::above_threshold() const {
 	BOOST_FOREACH( double level, _power ) {
 		if ( level / _duration > _threshold ) return true ;
 	}
@@ -181,30 +257,41 @@ bool envelope_model::compute_overlap(
 void envelope_model::compute_time_series(
 		double src_verb_time, double rcv_verb_time )
 {
-	_intensity.clear() ;
+	const size_t num_freq = _envelope_freq->size() ;
 
-	for ( size_t f = 0 ;f < _envelope_freq->size(); ++f ) {
+	// clear the window written by the previous contribution
 
-		// compute the peak time and intensity
+	for ( size_t f = 0 ; f < num_freq ; ++f ) {
+		double* row = &_intensity(f, 0) ;
+		std::fill( row + _window_first, row + _window_last, 0.0 ) ;
+	}
 
-		const double delay = src_verb_time + rcv_verb_time + _duration - _initial_time;
-		const double scale = _power[f] / _duration;
+	// compute the peak time and the window within +/- five (5) times
+	// the duration, which is the same for all frequencies
+	// speeds up the computation by over a factor of 3
 
-		// compute Gaussian intensity as a function of time
+	const double delay = src_verb_time + rcv_verb_time + _duration - _initial_time;
+	_window_first = _travel_time->find_index(delay - 5.0 * _duration);
+	_window_last = _travel_time->find_index(delay + 5.0 * _duration) + 1;
+	const size_t num_times = _window_last - _window_first ;
 
-		matrix_row< matrix<double> > intensity( _intensity, f ) ;
+	// compute the unit Gaussian once, and share it across frequencies
 
-		// use uBLAS vector proxies to only compute the portion of the
-		// time series within +/- five (5) times the duration
-		// speeds up the computation by over a factor of 3
+	const double* time = &_times[_window_first] ;
+	double* gaussian = &_gaussian[0] ;
+	const double factor = -0.5 / ( _duration * _duration ) ;
+	for ( size_t n = 0 ; n < num_times ; ++n ) {
+		const double dt = time[n] - delay ;
+		gaussian[n] = gaussian_exp( factor * dt * dt ) ;
+	}
 
-		_level.clear() ;
-		size_t first = _travel_time->find_index(delay - 5.0 * _duration);
-		size_t last = _travel_time->find_index(delay + 5.0 * _duration) + 1;
-		range window(first, last);
-		vector_range< seq_vector > time(*_travel_time, window);
-		vector_range< vector<double> > level(_level, window);
-		level = scale * exp(-0.5 * abs2((time - delay) / _duration)) ;
-		intensity = _level ;
+	// scale Gaussian by the power at each frequency
+
+	for ( size_t f = 0 ; f < num_freq ; ++f ) {
+		const double scale = _power[f] / _duration;
+		double* level = &_intensity(f, _window_first) ;
+		for ( size_t n = 0 ; n < num_times ; ++n ) {
+			level[n] = scale * gaussian[n] ;
+		}
 	}
 }
@@ -7,6 +7,8 @@
 
 #include <usml/types/seq_vector.h>
 #include <usml/eigenverb/eigenverb.h>
+#include <usml/eigenverb/eigenverb_array.h>
+#include <vector>
 
 namespace usml {
 namespace eigenverb {
@@ -74,7 +76,7 @@ private:
      * Gets the index of the first source frequency that overlaps receiver (Hz).
      * Used to map source eigenverbs onto envelope_freq values.
      */
-    const size_t src_freq_first() {
+    size_t src_freq_first() const {
         return _src_freq_first;
     }
 
@@ -86,10 +88,12 @@ private:
      * has computed the scattering coefficient; which saves this
      * class from having to know anything about the ocean.
      *
-     * @param src_verb	Eigenverb contribution from the source
+     * @param src_verbs	Contiguous storage for the source eigenverbs
      *                  at the original source frequencies.
-     * @param rcv_verb  Eigenverb contribution from the receiver
+     * @param src       Index of the source eigenverb in src_verbs.
+     * @param rcv_verbs Contiguous storage for the receiver eigenverbs
      *                  interpolated onto the envelope frequencies.
+     * @param rcv       Index of the receiver eigenverb in rcv_verbs.
      * @param scatter   Scattering strength coefficient for this
      *                  combination of eigenverbs (ratio).
      * @param xs2       Square of the relative distance from the
@@ -101,9 +105,31 @@ private:
      * @return          False if reverberation power below threshold.
      */
     bool compute_intensity(
-            const eigenverb& src_verb, const eigenverb& rcv_verb,
+            const eigenverb_array& src_verbs, size_t src,
+            const eigenverb_array& rcv_verbs, size_t rcv,
             const vector<double>& scatter, double xs2, double ys2 ) ;
 
+    /**
+     * Computes the intensity for the reverse ordering of the eigenverbs
+     * in the most recent call to compute_intensity(), in which rcv is the
+     * source and src is the receiver. Used for monostatic sensors, where
+     * both orderings of a pair contribute to the envelopes. The power of
+     * the overlap is symmetric, and is reused.  But the duration depends on
+     * the footprint, grazing angle, and sound speed of the receiver,
+     * so it is recomputed, checked against the threshold, and used to
+     * render a new time series. Assumes that src_freq_first() is zero.
+     *
+     * @param src_verbs Eigenverbs used as the source by compute_intensity().
+     * @param src       Index of the source eigenverb in src_verbs.
+     * @param rcv_verbs Eigenverbs used as the receiver by compute_intensity().
+     * @param rcv       Index of the receiver eigenverb in rcv_verbs.
+     * @return          False if the reverberation power of the reverse
+     *                  ordering is below threshold.
+     */
+    bool compute_reverse_intensity(
+            const eigenverb_array& src_verbs, size_t src,
+            const eigenverb_array& rcv_verbs, size_t rcv ) ;
+
     /**
      * Reverberation intensity at each point the time series.
      * Each row represents a specific envelope frequency.
@@ -115,6 +141,23 @@ private:
         return _intensity ;
     }
 
+    /**
+     * Index of the first travel time written by the most recent call to
+     * compute_intensity(). All intensities outside of the window
+     * [window_first(),window_last()) are zero.
+     */
+    size_t window_first() const {
+        return _window_first ;
+    }
+
+    /**
+     * One past the index of the last travel time written by the most
+     * recent call to compute_intensity().
+     */
+    size_t window_last() const {
+        return _window_last ;
+    }
+
 private:
 
     /**
@@ -122,11 +165,15 @@ private:
      * two eigenverbs. Implements the analytic solution for power of
      * the bistatic reverberation contribution from eqn. (28) ans (29)
      * in the paper.  Computes the duration from eqn. (45) and (33).
+     * The terms that only depend on one eigenverb are taken from
+     * the precomputed eigenverb_frame of each eigenverb.
      *
-     * @param src_verb		Eigenverb contribution from the source,
+     * @param src_verbs		Contiguous storage for the source eigenverbs,
      *                      at the original source frequencies.
-     * @param rcv_verb      Eigenverb contribution from the receiver,
+     * @param src           Index of the source eigenverb in src_verbs.
+     * @param rcv_verbs     Contiguous storage for the receiver eigenverbs,
      *                      interpolated onto the envelope frequencies.
+     * @param rcv           Index of the receiver eigenverb in rcv_verbs.
      * @param scatter       Scattering strength coefficient for this
      *                      combination of eigenverbs,
      *                      as a function of envelope frequency (ratio).
@@ -139,18 +186,50 @@ private:
      * @return              False if power below threshold.
      */
     bool compute_overlap(
-            const eigenverb& src_verb, const eigenverb& rcv_verb,
+            const eigenverb_array& src_verbs, size_t src,
+            const eigenverb_array& rcv_verbs, size_t rcv,
             const vector<double>& scatter, double xs2, double ys2 ) ;
 
+    /**
+     * Computes the duration of a contribution from the spatial extent of
+     * the overlap along the receiver's width, eqn. (41), combined with
+     * the pulse length, eqn. (33). Uses the relative tilt and determinant
+     * saved by the most recent call to compute_overlap(), which are
+     * the same for either ordering of the eigenverbs.
+     *
+     * @param src_frame     Precomputed terms of the source eigenverb.
+     * @param rcv_verbs     Contiguous storage for the receiver eigenverbs.
+     * @param rcv           Index of the receiver eigenverb in rcv_verbs.
+     * @return              Duration of the contribution (sec).
+     */
+    double compute_duration( const eigenverb_frame& src_frame,
+            const eigenverb_array& rcv_verbs, size_t rcv ) const ;
+
+    /**
+     * True if the power divided by the duration exceeds the threshold
+     * at any frequency.
+     */
+    bool above_threshold() const ;
+
     /**
      * Computes Gaussian time series contribution given delay, duration, and
      * total power.  Implements equation (6) from the paper.  Replaces the
      * values previously held by the _intensity member variable.
      *
      * In an effort to speed up the calculation of the Gaussian, this
-     * routine uses uBLAS vector and matrix proxies to only compute the
-     * portion of the time series within +/- five (5) times the duration
-     * of each pulse.
+     * routine only computes the portion of the time series within
+     * +/- five (5) times the duration of each pulse.  Because the
+     * duration is the same at all frequencies, this window and the
+     * unit Gaussian within it are computed once, then scaled by the
+     * power at each frequency.  The window is stored so that the
+     * envelope_collection can also limit its work to the active
+     * portion of the time series.  Only the previous window is
+     * cleared before the new one is written, and no memory is
+     * allocated.
+     *
+     * The exponential is evaluated with a polynomial approximation
+     * whose relative error is less than 1e-8 over the +/- five
+     * duration window, well below the accuracy of the model.
      *
      * @param src_verb_time		One way travel time for source eigenverb.
      * @param rcv_verb_time     One way travel time for receiver eigenverb.
@@ -195,15 +274,6 @@ private:
      */
     const double _threshold ;
 
-    /**
-     * Workspace for storing a single eigenverb overlap contribution
-     * as a function of two way travel time. Used to build the intensity
-     * for an individual frequency in the compute_time_serie() method.
-     * Building this as a member variable allows the allocation of memory
-     * to be re-used across eigenverb pairs.
-     */
-    vector<double> _level ;
-
     /**
      * Workspace for storing total power of eigenverb overlap,
      * as a function of envelope frequency (linear units).
@@ -223,6 +293,18 @@ private:
      */
     double _duration ;
 
+    /**
+     * Cosine of twice the relative tilt between the eigenverbs
+     * in the most recent call to compute_overlap().
+     */
+    double _cos2alpha ;
+
+    /**
+     * Determinant of the combined Gaussians, divided by the determinants
+     * of each eigenverb, from the most recent call to compute_overlap().
+     */
+    double _det_sr ;
+
     /**
      * Computed reverberation intensity at each point the time series.
      * Each row represents a specific envelope frequency.
@@ -232,6 +314,29 @@ private:
      * to be re-used across eigenverb pairs.
      */
     matrix< double > _intensity;
+
+    /**
+     * Contiguous copy of the travel times, so that the Gaussian can be
+     * computed without virtual calls into the seq_vector.
+     */
+    std::vector<double> _times ;
+
+    /**
+     * Workspace for the unit Gaussian in the active window,
+     * which is shared by all frequencies.
+     */
+    std::vector<double> _gaussian ;
+
+    /**
+     * Index of the first travel time in the active window of _intensity.
+     */
+    size_t _window_first ;
+
+    /**
+     * One past the index of the last travel time in the active window
+     * of _intensity.
+     */
+    size_t _window_last ;
 };
 
 }   // end of namespace eigenverb
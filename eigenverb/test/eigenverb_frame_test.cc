@@ -0,0 +1,109 @@
+/**
+ * @file eigenverb_frame_test.cc
+ * Regression tests for the precomputed geometry of eigenverbs.
+ */
+#include <boost/test/unit_test.hpp>
+#include <usml/eigenverb/eigenverb_array.h>
+#include <usml/eigenverb/envelope_generator.h>
+#include <iostream>
+
+BOOST_AUTO_TEST_SUITE(eigenverb_frame_test)
+
+using namespace boost::unit_test;
+using namespace usml::eigenverb;
+using std::cout;
+using std::endl;
+
+/**
+ * @ingroup eigenverb_test
+ * @{
+ */
+
+/**
+ * Create a bottom eigenverb at a specific location and heading.
+ */
+static eigenverb make_eigenverb( double latitude, double longitude,
+    double direction )
+{
+    eigenverb verb ;
+    verb.time = 0.0 ;
+    verb.frequencies = NULL ;
+    verb.length = 1000.0 ;
+    verb.length2 = verb.length * verb.length ;
+    verb.width = 500.0 ;
+    verb.width2 = verb.width * verb.width ;
+    verb.position = wposition1( latitude, longitude, -200.0 ) ;
+    verb.direction = direction ;
+    verb.grazing = 0.3 ;
+    verb.sound_speed = 1500.0 ;
+    verb.de_index = 0 ;
+    verb.az_index = 0 ;
+    verb.source_de = 0.0 ;
+    verb.source_az = 0.0 ;
+    verb.surface = 0 ;
+    verb.bottom = 1 ;
+    verb.caustic = 0 ;
+    verb.upper = 0 ;
+    verb.lower = 0 ;
+    return verb ;
+}
+
+/**
+ * Compares the offsets computed by eigenverb_frame::offset_length() and
+ * eigenverb_frame::offset_width() to the great circle range and bearing
+ * used before the frames were precomputed.  Covers several headings of
+ * the length axis, bearings in every quadrant, and separations from a
+ * few meters out to the distance_threshold limit, where the pair search
+ * decides whether to keep the pair.  The frame projects the chord onto
+ * the tangent plane, so the results agree to a fraction on the order
+ * of (range/earth_radius)^2.  Bearings due north and south are avoided,
+ * because gc_range() computes them with acos(), which loses precision
+ * at short ranges.
+ */
+BOOST_AUTO_TEST_CASE( eigenverb_frame_offsets ) {
+    cout << "=== eigenverb_frame_test: eigenverb_frame_offsets ===" << endl;
+    const double headings[] = { 0.0, 0.7, 2.5, -1.2 } ;
+    const double bearings[] = { 0.1, 0.4, 1.9, 3.5, 5.2 } ;
+    const double limit = envelope_generator::distance_threshold * 1000.0 ;
+    const double separations[] = { 10.0, 500.0, 2000.0, limit } ;
+    const double lat1 = 45.0 ;
+    const double lng1 = -45.0 ;
+    const double radius = wposition::earth_radius - 200.0 ;
+
+    for ( size_t h=0 ; h < sizeof(headings)/sizeof(double) ; ++h ) {
+        eigenverb_frame frame ;
+        const eigenverb verb = make_eigenverb( lat1, lng1, headings[h] ) ;
+        frame.compute( verb ) ;
+
+        for ( size_t b=0 ; b < sizeof(bearings)/sizeof(double) ; ++b ) {
+            for ( size_t s=0 ; s < sizeof(separations)/sizeof(double) ; ++s ) {
+
+                // place the other eigenverb at this separation and bearing
+
+                const double d = separations[s] / radius ;
+                const double lat2 = lat1 + to_degrees( d * cos(bearings[b]) ) ;
+                const double lng2 = lng1 + to_degrees( d * sin(bearings[b])
+                                  / cos(to_radians(lat1)) ) ;
+                eigenverb_frame other ;
+                other.compute( make_eigenverb( lat2, lng2, 0.0 ) ) ;
+
+                // offsets from great circle range and bearing
+
+                double bearing ;
+                const double range = verb.position.gc_range(
+                    wposition1( lat2, lng2, -200.0 ), &bearing ) ;
+                const double relative = bearing - headings[h] ;
+                const double ys = range * cos( relative ) ;
+                const double xs = range * sin( relative ) ;
+
+                const double tolerance = 1e-6 * range + 1e-6 ;
+                BOOST_CHECK_SMALL( frame.offset_length( other ) - ys, tolerance ) ;
+                BOOST_CHECK_SMALL( frame.offset_width( other ) - xs, tolerance ) ;
+            }
+        }
+    }
+}
+
+/// @}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,364 @@
+/**
+ * @file envelope_generator_test.cc
+ * Regression tests for the partitioning, pruning, and monostatic
+ * symmetry of the envelope_generator.
+ */
+#include <boost/test/unit_test.hpp>
+#include <usml/eigenverb/envelope_generator.h>
+#include <usml/ocean/ocean.h>
+#include <usml/sensors/sensors.h>
+#include <iostream>
+
+BOOST_AUTO_TEST_SUITE(envelope_generator_test)
+
+using namespace boost::unit_test;
+using namespace usml::eigenverb;
+using namespace usml::ocean;
+using namespace usml::sensors;
+using std::cout;
+using std::endl;
+
+/**
+ * @ingroup eigenverb_test
+ * @{
+ */
+
+static const sensor_params::id_type params_id = 901 ;
+static const size_t num_azimuths = 4 ;
+
+/**
+ * Create a flat, isovelocity ocean with constant bottom scattering,
+ * and a monostatic sensor type with an omni-directional beam.
+ */
+static void setup_scenario() {
+    boundary_model* bottom = new boundary_flat( 200.0 ) ;
+    bottom->scattering( new scattering_constant( -30.0 ) ) ;
+    ocean_shared::reference ocean( new ocean_model(
+        new boundary_flat(), bottom, new profile_linear( 1500.0, 0.0 ) ) ) ;
+    ocean_shared::update( ocean ) ;
+
+    sensor_params::beam_pattern_list beams ;
+    beams.push_back( 0 ) ;
+    const seq_linear freq( 900.0, 100.0, 3 ) ;
+    const vector<double> source_level( 1, 200.0 ) ;
+    source_params_map::instance()->insert( params_id, source_params::reference(
+        new source_params( params_id, source_level, 0.25, 10.0,
+                           800.0, 1200.0, freq, beams, false ) ) ) ;
+    receiver_params_map::instance()->insert( params_id, receiver_params::reference(
+        new receiver_params( params_id, 800.0, 1200.0, freq, beams, false ) ) ) ;
+}
+
+/**
+ * Remove the sensor type and ocean created by setup_scenario().
+ */
+static void teardown_scenario() {
+    source_params_map::instance()->erase( params_id ) ;
+    receiver_params_map::instance()->erase( params_id ) ;
+    ocean_shared::reset() ;
+}
+
+/**
+ * Give a sensor a grid of overlapping bottom eigenverbs with a variety
+ * of directions, sizes, and grazing angles, so that most pairs overlap,
+ * but neither their durations nor their azimuths are symmetric.
+ * Optionally splits each eigenverb into copies, one meter apart, that
+ * share its power, and merges them back together before they are
+ * given to the sensor.
+ *
+ * @param sensor    Sensor to give the eigenverbs to.
+ * @param copies    Number of copies of each eigenverb.
+ * @param merge     Merge the copies using merge_eigenverbs() if true.
+ * @return          Number of bottom eigenverbs removed by merging.
+ */
+static size_t add_eigenverbs( sensor_model* sensor, size_t copies = 1,
+                              bool merge = false )
+{
+    eigenverb_collection::reference collection( new eigenverb_collection(0) ) ;
+    const sensor_model& model = *sensor ;
+    const seq_vector* freq = model.frequencies() ;
+    const double meters_per_degree = 1852.0 * 60.0 ;
+    size_t n = 0 ;
+    for ( size_t y=0 ; y < 5 ; ++y ) {
+        for ( size_t x=0 ; x < 5 ; ++x, ++n ) {
+          for ( size_t c=0 ; c < copies ; ++c ) {
+            eigenverb verb ;
+            verb.time = 0.2 + 0.01 * n ;
+            verb.frequencies = freq ;
+            verb.power.resize( freq->size() ) ;
+            for ( size_t f=0 ; f < freq->size() ; ++f ) {
+                verb.power[f] = 1e-4 * ( 1.0 + 0.1 * f ) / ( 1.0 + 0.05 * n )
+                              / copies ;
+            }
+            verb.length = 100.0 + 10.0 * ( n % 3 ) ;
+            verb.length2 = verb.length * verb.length ;
+            verb.width = 50.0 + 15.0 * ( n % 4 ) ;
+            verb.width2 = verb.width * verb.width ;
+            verb.position = wposition1(
+                45.0 + ( 40.0 * y + 1.0 * c ) / meters_per_degree,
+                -45.0 + 40.0 * x / meters_per_degree, -200.0 ) ;
+            verb.direction = 0.3 * n ;
+            verb.grazing = 0.3 + 0.02 * n ;
+            verb.sound_speed = 1500.0 ;
+            verb.de_index = n ;
+            verb.az_index = n % num_azimuths ;
+            verb.source_de = -verb.grazing ;
+            verb.source_az = verb.direction ;
+            verb.surface = 0 ;
+            verb.bottom = 1 ;
+            verb.caustic = 0 ;
+            verb.upper = 0 ;
+            verb.lower = 0 ;
+            collection->add_eigenverb( verb, eigenverb::BOTTOM ) ;
+          }
+        }
+    }
+    if ( merge ) collection->merge_eigenverbs() ;
+    eigenray_collection::reference eigenrays ;
+    sensor->update_wavefront_data( eigenrays, collection ) ;
+    return merge ? collection->merged( eigenverb::BOTTOM ) : 0 ;
+}
+
+/**
+ * Run the envelope_generator synchronously for one sensor_pair,
+ * and return the envelopes that it sends to the sensor_pair.
+ */
+static envelope_collection::reference compute_envelopes( sensor_pair* pair ) {
+    envelope_generator generator( pair, 0.0, 0, num_azimuths ) ;
+    generator.run() ;
+    BOOST_REQUIRE( pair->envelopes().get() != NULL ) ;
+    return pair->envelopes() ;
+}
+
+/**
+ * Compare two sets of envelopes, and check that some points were
+ * above threshold and that the largest difference is within tolerance.
+ */
+static void check_envelopes( const envelope_collection& result,
+    const envelope_collection& reference, double tolerance )
+{
+    double rms_db, max_db ;
+    const size_t count = result.compare( reference, &rms_db, &max_db ) ;
+    cout << "compared " << count << " points"
+         << " rms=" << rms_db << " dB max=" << max_db << " dB" << endl ;
+    BOOST_CHECK( count > 0 ) ;
+    BOOST_CHECK_SMALL( max_db, tolerance ) ;
+}
+
+/**
+ * Computes the envelopes of a monostatic pair with 1 and 4 threads,
+ * and with 1 and 4 partitions.  Because partitions are reduced in a fixed
+ * order, the number of threads must not change the results at all.
+ * Changing the number of partitions only changes the order of summation.
+ */
+BOOST_AUTO_TEST_CASE( envelope_threads ) {
+    cout << "=== envelope_generator_test: envelope_threads ===" << endl;
+    const size_t saved_partitions = envelope_generator::num_partitions ;
+    const size_t saved_threads = envelope_generator::max_threads ;
+    setup_scenario() ;
+    {
+        sensor_model sensor( 1, params_id, "monostatic" ) ;
+        add_eigenverbs( &sensor ) ;
+        sensor_pair pair( &sensor, &sensor ) ;
+
+        envelope_generator::num_partitions = 4 ;
+        envelope_generator::max_threads = 1 ;
+        envelope_collection::reference single = compute_envelopes( &pair ) ;
+
+        envelope_generator::max_threads = 4 ;
+        envelope_collection::reference multiple = compute_envelopes( &pair ) ;
+        check_envelopes( *multiple, *single, 1e-12 ) ;
+
+        envelope_generator::num_partitions = 1 ;
+        envelope_generator::max_threads = 1 ;
+        envelope_collection::reference serial = compute_envelopes( &pair ) ;
+        check_envelopes( *serial, *single, 1e-6 ) ;
+    }
+    envelope_generator::num_partitions = saved_partitions ;
+    envelope_generator::max_threads = saved_threads ;
+    teardown_scenario() ;
+}
+
+/**
+ * Computes the envelopes of a monostatic pair with the default
+ * power pruning, and with power pruning disabled by a very large
+ * max_scattering.  Pruning must only remove pairs that can not reach
+ * the threshold, so the results must be the same.
+ */
+BOOST_AUTO_TEST_CASE( envelope_pruning ) {
+    cout << "=== envelope_generator_test: envelope_pruning ===" << endl;
+    const double saved_scattering = envelope_generator::max_scattering ;
+    setup_scenario() ;
+    {
+        sensor_model sensor( 1, params_id, "monostatic" ) ;
+        add_eigenverbs( &sensor ) ;
+        sensor_pair pair( &sensor, &sensor ) ;
+
+        envelope_collection::reference pruned = compute_envelopes( &pair ) ;
+        envelope_generator::max_scattering = 300.0 ;
+        envelope_collection::reference complete = compute_envelopes( &pair ) ;
+        check_envelopes( *pruned, *complete, 1e-6 ) ;
+    }
+    envelope_generator::max_scattering = saved_scattering ;
+    teardown_scenario() ;
+}
+
+/**
+ * Computes the envelopes of a monostatic pair, in which each unordered
+ * pair of eigenverbs is evaluated once and added in both directions,
+ * and compares them to the ordered evaluation of every pair, using a
+ * second sensor with a copy of the same eigenverbs.  Each direction has
+ * its own duration, azimuth, and threshold test, so the results must
+ * be the same up to the order of summation.
+ */
+BOOST_AUTO_TEST_CASE( envelope_monostatic ) {
+    cout << "=== envelope_generator_test: envelope_monostatic ===" << endl;
+    setup_scenario() ;
+    {
+        sensor_model sensor( 1, params_id, "monostatic" ) ;
+        sensor_model copy( 2, params_id, "copy" ) ;
+        add_eigenverbs( &sensor ) ;
+        add_eigenverbs( &copy ) ;
+
+        sensor_pair symmetric( &sensor, &sensor ) ;
+        envelope_collection::reference monostatic = compute_envelopes( &symmetric ) ;
+
+        sensor_pair ordered( &sensor, &copy ) ;
+        envelope_collection::reference reference = compute_envelopes( &ordered ) ;
+        check_envelopes( *monostatic, *reference, 1e-3 ) ;
+    }
+    teardown_scenario() ;
+}
+
+/**
+ * Splits each eigenverb into two half power copies, one meter apart,
+ * and merges them back together with merge_eigenverbs().  Every copy
+ * must be merged with its twin, and nothing else, so the envelopes
+ * must match those of the original eigenverbs.  Also checks that
+ * compare() finds no difference between a collection and itself.
+ */
+BOOST_AUTO_TEST_CASE( envelope_merge ) {
+    cout << "=== envelope_generator_test: envelope_merge ===" << endl;
+    const double saved_tolerance = eigenverb_collection::merge_tolerance ;
+    setup_scenario() ;
+    {
+        sensor_model original( 1, params_id, "original" ) ;
+        add_eigenverbs( &original ) ;
+        sensor_pair original_pair( &original, &original ) ;
+        envelope_collection::reference reference = compute_envelopes( &original_pair ) ;
+
+        double rms_db, max_db ;
+        BOOST_CHECK( reference->compare( *reference, &rms_db, &max_db ) > 0 ) ;
+        BOOST_CHECK_EQUAL( rms_db, 0.0 ) ;
+        BOOST_CHECK_EQUAL( max_db, 0.0 ) ;
+
+        eigenverb_collection::merge_tolerance = 0.1 ;
+        sensor_model split( 2, params_id, "split" ) ;
+        BOOST_CHECK_EQUAL( add_eigenverbs( &split, 2, true ), (size_t) 25 ) ;
+        sensor_pair split_pair( &split, &split ) ;
+        envelope_collection::reference merged = compute_envelopes( &split_pair ) ;
+        check_envelopes( *merged, *reference, 0.05 ) ;
+    }
+    eigenverb_collection::merge_tolerance = saved_tolerance ;
+    teardown_scenario() ;
+}
+
+/**
+ * Computes the envelopes with beam_bins enabled, using several partitions
+ * and threads that share the bins of the final result, and rebuilds them
+ * with apply_beams().  Every launch angle bin of an omni-directional beam
+ * has a level of one, so the rebuilt envelopes must match the envelopes
+ * weighted by the beam levels of each eigenverb in the pair search.
+ */
+BOOST_AUTO_TEST_CASE( envelope_apply_beams ) {
+    cout << "=== envelope_generator_test: envelope_apply_beams ===" << endl;
+    const bool saved_bins = envelope_generator::beam_bins ;
+    const size_t saved_partitions = envelope_generator::num_partitions ;
+    const size_t saved_threads = envelope_generator::max_threads ;
+    setup_scenario() ;
+    {
+        sensor_model sensor( 1, params_id, "monostatic" ) ;
+        add_eigenverbs( &sensor ) ;
+        sensor_pair pair( &sensor, &sensor ) ;
+
+        envelope_generator::beam_bins = true ;
+        envelope_generator::num_partitions = 4 ;
+        envelope_generator::max_threads = 4 ;
+        envelope_collection::reference direct = compute_envelopes( &pair ) ;
+        BOOST_REQUIRE( direct->bins().get() != NULL ) ;
+        BOOST_CHECK( direct->bins()->active_envelopes() > 0 ) ;
+
+        sensor_params::beam_pattern_list beams ;
+        beams.push_back( 0 ) ;
+        beam_gain_table::reference gains = beam_gain_table::shared(
+            beams, direct->envelope_freq(), sensor.orient() ) ;
+        envelope_collection::reference rebuilt(
+            direct->apply_beams( *gains, *gains ) ) ;
+        check_envelopes( *rebuilt, *direct, 1e-3 ) ;
+    }
+    envelope_generator::beam_bins = saved_bins ;
+    envelope_generator::num_partitions = saved_partitions ;
+    envelope_generator::max_threads = saved_threads ;
+    teardown_scenario() ;
+}
+
+/**
+ * Checks the size of the adaptive travel time axis.  By default, the pair
+ * uses the fixed travel_time() axis.  Setting samples_per_pulse creates a
+ * uniform axis at pulse_length/samples_per_pulse, that is limited to
+ * max_time_samples, and time_growth makes the sampling period grow
+ * with travel time.
+ */
+BOOST_AUTO_TEST_CASE( envelope_time_axis ) {
+    cout << "=== envelope_generator_test: envelope_time_axis ===" << endl;
+    const double saved_samples = envelope_generator::samples_per_pulse ;
+    const size_t saved_max = envelope_generator::max_time_samples ;
+    const double saved_growth = envelope_generator::time_growth ;
+    const double pulse_length = 0.25 ;
+    const double reverb_duration = 10.0 ;
+    setup_scenario() ;
+    {
+        sensor_model sensor( 1, params_id, "monostatic" ) ;
+        add_eigenverbs( &sensor ) ;
+        sensor_pair pair( &sensor, &sensor ) ;
+
+        // fixed axis by default
+
+        envelope_generator::time_growth = 0.0 ;
+        const seq_vector* axis = compute_envelopes( &pair )->travel_time() ;
+        BOOST_CHECK_CLOSE( axis->increment(0),
+            envelope_generator::travel_time()->increment(0), 1e-10 ) ;
+
+        // uniform axis at four samples per pulse
+
+        envelope_generator::samples_per_pulse = 4.0 ;
+        envelope_collection::reference uniform = compute_envelopes( &pair ) ;
+        axis = uniform->travel_time() ;
+        BOOST_CHECK_CLOSE( axis->increment(0), pulse_length / 4.0, 1e-10 ) ;
+        BOOST_CHECK_EQUAL( axis->size(), (size_t) 161 ) ;
+
+        // limited by max_time_samples
+
+        envelope_generator::max_time_samples = 50 ;
+        envelope_collection::reference limited = compute_envelopes( &pair ) ;
+        axis = limited->travel_time() ;
+        BOOST_CHECK( axis->size() <= 50 ) ;
+        BOOST_CHECK( axis->increment(0) >= reverb_duration / 49.0 * ( 1.0 - 1e-10 ) ) ;
+
+        // sampling period grows with travel time
+
+        envelope_generator::max_time_samples = saved_max ;
+        envelope_generator::time_growth = 0.01 ;
+        envelope_collection::reference growing = compute_envelopes( &pair ) ;
+        axis = growing->travel_time() ;
+        BOOST_CHECK( axis->size() < 161 ) ;
+        BOOST_CHECK( axis->increment( axis->size() - 2 ) > axis->increment(0) ) ;
+    }
+    envelope_generator::samples_per_pulse = saved_samples ;
+    envelope_generator::max_time_samples = saved_max ;
+    envelope_generator::time_growth = saved_growth ;
+    teardown_scenario() ;
+}
+
+/// @}
+
+BOOST_AUTO_TEST_SUITE_END()
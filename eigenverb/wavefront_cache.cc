@@ -0,0 +1,199 @@
+/**
+ * @file wavefront_cache.cc
+ * Singleton cache of eigenray and eigenverb results.
+ */
+#include <usml/eigenverb/wavefront_cache.h>
+#include <usml/eigenverb/wavefront_generator.h>
+
+using namespace usml::eigenverb ;
+
+size_t wavefront_cache::max_entries = 0 ;      // disabled
+double wavefront_cache::lat_quantum = 0.001 ;   // degrees
+double wavefront_cache::lon_quantum = 0.001 ;   // degrees
+double wavefront_cache::alt_quantum = 1.0 ;     // meters
+
+/**
+ * Initialization of private static member _instance
+ */
+unique_ptr<wavefront_cache> wavefront_cache::_instance ;
+
+/**
+ * The mutex for the singleton pointer.
+ */
+read_write_lock wavefront_cache::_instance_mutex ;
+
+/**
+ * Singleton Constructor - Double Check Locking Pattern DCLP
+ */
+wavefront_cache* wavefront_cache::instance() {
+    wavefront_cache* tmp = _instance.get() ;
+    if ( tmp == NULL ) {
+        write_lock_guard guard(_instance_mutex) ;
+        tmp = _instance.get() ;
+        if ( tmp == NULL ) {
+            tmp = new wavefront_cache() ;
+            _instance.reset(tmp) ;
+        }
+    }
+    return tmp ;
+}
+
+/**
+ * Reset the wavefront_cache instance to empty.
+ */
+void wavefront_cache::reset() {
+    write_lock_guard guard(_instance_mutex) ;
+    _instance.reset() ;
+}
+
+/**
+ * Build the lookup key for a WaveQ3D run.
+ */
+wavefront_cache::key_type wavefront_cache::make_key(
+    size_t ocean_version, const wposition1& source,
+    const wposition* targets, const seq_vector* frequencies )
+{
+    key_type key ;
+    key.ocean_version = ocean_version ;
+
+    // quantized geometry
+
+    key.geometry.push_back( (long) floor( source.latitude() / lat_quantum + 0.5 ) ) ;
+    key.geometry.push_back( (long) floor( source.longitude() / lon_quantum + 0.5 ) ) ;
+    key.geometry.push_back( (long) floor( source.altitude() / alt_quantum + 0.5 ) ) ;
+    if ( targets ) {
+        for ( size_t t1=0 ; t1 < targets->size1() ; ++t1 ) {
+            for ( size_t t2=0 ; t2 < targets->size2() ; ++t2 ) {
+                key.geometry.push_back( (long) floor(
+                    targets->latitude(t1,t2) / lat_quantum + 0.5 ) ) ;
+                key.geometry.push_back( (long) floor(
+                    targets->longitude(t1,t2) / lon_quantum + 0.5 ) ) ;
+                key.geometry.push_back( (long) floor(
+                    targets->altitude(t1,t2) / alt_quantum + 0.5 ) ) ;
+            }
+        }
+    }
+
+    // frequencies and ray fan parameters
+
+    for ( size_t f=0 ; f < frequencies->size() ; ++f ) {
+        key.parameters.push_back( (*frequencies)(f) ) ;
+    }
+    key.parameters.push_back( wavefront_generator::number_de ) ;
+    key.parameters.push_back( wavefront_generator::number_az ) ;
+    key.parameters.push_back( wavefront_generator::extra_rays ) ;
+    key.parameters.push_back( wavefront_generator::time_maximum ) ;
+    key.parameters.push_back( wavefront_generator::time_step ) ;
+    key.parameters.push_back( wavefront_generator::intensity_threshold ) ;
+    key.parameters.push_back( wavefront_generator::max_bottom ) ;
+    key.parameters.push_back( wavefront_generator::max_surface ) ;
+    key.parameters.push_back( wavefront_generator::tangent_plane ) ;
+    key.parameters.push_back( eigenverb_collection::merge_tolerance ) ;
+    key.parameters.push_back( eigenverb_collection::merge_angle ) ;
+    return key ;
+}
+
+/**
+ * Search for the results of an earlier WaveQ3D run.
+ */
+bool wavefront_cache::find( const key_type& key,
+    eigenray_collection::reference* eigenrays,
+    eigenverb_collection::reference* eigenverbs )
+{
+    write_lock_guard guard(_mutex) ;
+    map_type::iterator iter = _entries.find( key ) ;
+    if ( iter == _entries.end() ) {
+        ++_misses ;
+        return false ;
+    }
+    ++_hits ;
+    _usage.splice( _usage.begin(), _usage, iter->second.usage ) ;
+    *eigenrays = iter->second.eigenrays ;
+    *eigenverbs = iter->second.eigenverbs ;
+    return true ;
+}
+
+/**
+ * Store the results of a WaveQ3D run.
+ */
+void wavefront_cache::insert( const key_type& key,
+    const eigenray_collection::reference& eigenrays,
+    const eigenverb_collection::reference& eigenverbs )
+{
+    write_lock_guard guard(_mutex) ;
+    if ( max_entries == 0 ) return ;
+
+    // replace existing entry for this key
+
+    map_type::iterator iter = _entries.find( key ) ;
+    if ( iter != _entries.end() ) {
+        iter->second.eigenrays = eigenrays ;
+        iter->second.eigenverbs = eigenverbs ;
+        _usage.splice( _usage.begin(), _usage, iter->second.usage ) ;
+        return ;
+    }
+
+    // discard least recently used entries
+
+    while ( _entries.size() >= max_entries ) {
+        _entries.erase( _usage.back() ) ;
+        _usage.pop_back() ;
+        ++_evictions ;
+    }
+
+    _usage.push_front( key ) ;
+    entry_type& entry = _entries[key] ;
+    entry.eigenrays = eigenrays ;
+    entry.eigenverbs = eigenverbs ;
+    entry.usage = _usage.begin() ;
+}
+
+/**
+ * Remove all entries.
+ */
+void wavefront_cache::clear() {
+    write_lock_guard guard(_mutex) ;
+    _entries.clear() ;
+    _usage.clear() ;
+}
+
+/**
+ * Number of entries in the cache.
+ */
+size_t wavefront_cache::size() const {
+    read_lock_guard guard(_mutex) ;
+    return _entries.size() ;
+}
+
+/**
+ * Number of searches that found a result.
+ */
+size_t wavefront_cache::hits() const {
+    read_lock_guard guard(_mutex) ;
+    return _hits ;
+}
+
+/**
+ * Number of searches that did not find a result.
+ */
+size_t wavefront_cache::misses() const {
+    read_lock_guard guard(_mutex) ;
+    return _misses ;
+}
+
+/**
+ * Number of entries discarded to make room for new ones.
+ */
+size_t wavefront_cache::evictions() const {
+    read_lock_guard guard(_mutex) ;
+    return _evictions ;
+}
+
+/**
+ * Fraction of searches that found a result.
+ */
+double wavefront_cache::hit_rate() const {
+    read_lock_guard guard(_mutex) ;
+    const size_t total = _hits + _misses ;
+    return ( total == 0 ) ? 0.0 : (double) _hits / (double) total ;
+}
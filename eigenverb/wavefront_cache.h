@@ -0,0 +1,201 @@
+/**
+ * @file wavefront_cache.h
+ * Singleton cache of eigenray and eigenverb results.
+ */
+#pragma once
+
+#include <usml/eigenverb/eigenverb_collection.h>
+#include <usml/waveq3d/eigenray_collection.h>
+#include <usml/threads/threads.h>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace usml {
+namespace eigenverb {
+
+using namespace usml::waveq3d ;
+using namespace usml::threads ;
+
+/// @ingroup eigenverb
+/// @{
+
+/**
+ * Singleton cache of eigenray and eigenverb results. Sensors that sit
+ * still, or that return to positions they have occupied before, can
+ * reuse the results of an earlier WaveQ3D run instead of launching a new
+ * wavefront_generator.
+ *
+ * Results are keyed by:
+ *  - the version of the shared ocean (see ocean_shared::version()),
+ *  - the source position and the list of target positions, quantized
+ *    to lat_quantum, lon_quantum, and alt_quantum,
+ *  - the frequencies of the propagation,
+ *  - the ray fan and threshold parameters of the wavefront_generator.
+ *
+ * Results for positions within one quantum of each other are treated
+ * as identical. The cache holds at most max_entries results, and
+ * discards the least recently used entry when it is full.  Hit and miss
+ * counters allow the effectiveness of the cache to be monitored.
+ */
+class USML_DECLSPEC wavefront_cache {
+
+public:
+
+    /**
+     * Lookup key for a single WaveQ3D run.
+     */
+    struct key_type {
+
+        /** Version of the shared ocean used to compute the results. */
+        size_t ocean_version ;
+
+        /** Quantized lat/lon/alt of the source, followed by each target. */
+        std::vector<long> geometry ;
+
+        /** Frequencies, followed by the ray fan parameters. */
+        std::vector<double> parameters ;
+
+        /** Strict weak ordering for use in std::map. */
+        bool operator<( const key_type& other ) const {
+            if ( ocean_version != other.ocean_version ) {
+                return ocean_version < other.ocean_version ;
+            }
+            if ( geometry != other.geometry ) {
+                return geometry < other.geometry ;
+            }
+            return parameters < other.parameters ;
+        }
+    };
+
+    /**
+     * Provides a reference to the wavefront_cache singleton.
+     * Uses the same double check locking pattern as the other
+     * singletons in this library.
+     *
+     * @return  Reference to the wavefront_cache singleton.
+     */
+    static wavefront_cache* instance() ;
+
+    /**
+     * Reset the wavefront_cache singleton unique pointer to empty.
+     */
+    static void reset() ;
+
+    /**
+     * Build the lookup key for a WaveQ3D run. Uses the current values of
+     * the wavefront_generator static attributes for the ray fan parameters.
+     *
+     * @param   ocean_version   Version of the shared ocean.
+     * @param   source          Location of the wavefront source.
+     * @param   targets         Position of each eigenray target (may be NULL).
+     * @param   frequencies     Frequencies over which to compute propagation.
+     * @return                  Key for this WaveQ3D run.
+     */
+    static key_type make_key( size_t ocean_version, const wposition1& source,
+        const wposition* targets, const seq_vector* frequencies ) ;
+
+    /**
+     * Search for the results of an earlier WaveQ3D run.
+     *
+     * @param   key         Key for this WaveQ3D run.
+     * @param   eigenrays   Cached eigenrays (output).
+     * @param   eigenverbs  Cached eigenverbs (output).
+     * @return              True if results were found.
+     */
+    bool find( const key_type& key,
+               eigenray_collection::reference* eigenrays,
+               eigenverb_collection::reference* eigenverbs ) ;
+
+    /**
+     * Store the results of a WaveQ3D run. Discards the least recently
+     * used entry if the cache is full.
+     *
+     * @param   key         Key for this WaveQ3D run.
+     * @param   eigenrays   Eigenrays computed by this run.
+     * @param   eigenverbs  Eigenverbs computed by this run.
+     */
+    void insert( const key_type& key,
+                 const eigenray_collection::reference& eigenrays,
+                 const eigenverb_collection::reference& eigenverbs ) ;
+
+    /** Remove all entries, without resetting the counters. */
+    void clear() ;
+
+    /** Number of entries in the cache. */
+    size_t size() const ;
+
+    /** Number of searches that found a result. */
+    size_t hits() const ;
+
+    /** Number of searches that did not find a result. */
+    size_t misses() const ;
+
+    /** Number of entries discarded to make room for new ones. */
+    size_t evictions() const ;
+
+    /** Fraction of searches that found a result, zero if no searches. */
+    double hit_rate() const ;
+
+    /**
+     * Maximum number of entries in the cache.
+     * Caching is disabled if this is zero. Defaults to zero, because
+     * a sensor that moves by less than one quantum silently reuses
+     * the eigenrays and travel times of its old position.  Applications
+     * that enable the cache should choose quanta that are no larger than
+     * the position thresholds at which the sensors request new wavefronts.
+     */
+    static size_t max_entries ;
+
+    /** Quantization of latitude in cache keys (degrees). Defaults to 0.001. */
+    static double lat_quantum ;
+
+    /** Quantization of longitude in cache keys (degrees). Defaults to 0.001. */
+    static double lon_quantum ;
+
+    /** Quantization of altitude in cache keys (meters). Defaults to 1.0. */
+    static double alt_quantum ;
+
+private:
+
+    /** Results of a single WaveQ3D run. */
+    struct entry_type {
+        eigenray_collection::reference eigenrays ;
+        eigenverb_collection::reference eigenverbs ;
+        std::list<key_type>::iterator usage ;
+    };
+
+    /** Map of keys to results. */
+    typedef std::map<key_type, entry_type> map_type ;
+
+    /** Results for each key. */
+    map_type _entries ;
+
+    /** Keys in order of use, most recent first. */
+    std::list<key_type> _usage ;
+
+    /** Number of searches that found a result. */
+    size_t _hits ;
+
+    /** Number of searches that did not find a result. */
+    size_t _misses ;
+
+    /** Number of entries discarded to make room for new ones. */
+    size_t _evictions ;
+
+    /** Mutex that locks the cache during searches and updates. */
+    mutable read_write_lock _mutex ;
+
+    /** The singleton access pointer. */
+    static unique_ptr<wavefront_cache> _instance ;
+
+    /** The mutex for the singleton pointer. */
+    static read_write_lock _instance_mutex ;
+
+    /** Hide constructor to prevent incorrect use of singleton. */
+    wavefront_cache() : _hits(0), _misses(0), _evictions(0) {}
+};
+
+/// @}
+}   // end of namespace eigenverb
+}   // end of namespace usml
@@ -15,6 +15,9 @@ double wavefront_generator::time_step = 0.01;            // sec
 double wavefront_generator::intensity_threshold = 300.0; // dB
 int wavefront_generator::max_bottom = 999;
 int wavefront_generator::max_surface = 999;
+bool wavefront_generator::tangent_plane = false;
+int wavefront_generator::coarse_de = 0;
+bool wavefront_generator::streaming = false;
 
 /**
  * Construct wavefront generator from the data items needed to run WaveQ3D.
@@ -35,7 +38,8 @@ wavefront_generator::wavefront_generator(shared_ptr<ocean_model> ocean,
 	_target_positions(target_positions),
 	_frequencies(frequencies),
 	_ocean(ocean),
-	_wavefront_listener(listener)
+	_wavefront_listener(listener),
+	_use_cache(false)
 {
 }
 
@@ -51,24 +55,67 @@ void wavefront_generator::run() {
 		return;
 	}
 
+	eigenray_collection::reference eigenrays ;
+	eigenverb_collection::reference eigenverbs ;
+
+	// publish provisional results from a coarse ray fan
+	// keeps the full AZ fan so that az_index matches the envelope azimuths
+
+	if ( coarse_de > 0 && coarse_de < _number_de ) {
+		if ( ! propagate( coarse_de, _number_az, eigenrays, eigenverbs ) ) return ;
+		_wavefront_listener->update_wavefront_data(eigenrays, eigenverbs);
+		if ( ! _wavefront_listener->refine_wavefront(eigenrays, eigenverbs) ) {
+			write_lock_guard guard(_lock);
+			_done = true;
+			return ;
+		}
+	}
+
+	// publish final results from the full ray fan
+	// optionally stream its eigenverbs while the wavefront is running
+
+	eigenverb_stream::reference stream ;
+	if ( streaming ) {
+		stream.reset( new eigenverb_stream( _ocean.get()->num_volume() ) ) ;
+		_wavefront_listener->start_wavefront( stream ) ;
+	}
+	if ( ! propagate( _number_de, _number_az, eigenrays, eigenverbs,
+			stream.get() ) ) return ;
+	if ( _use_cache ) {
+		wavefront_cache::instance()->insert( _cache_key, eigenrays, eigenverbs ) ;
+	}
+	_wavefront_listener->update_wavefront_data(eigenrays, eigenverbs);
+	write_lock_guard guard(_lock);
+	_done = true;
+}
+
+/**
+ * Propagate a single ray fan and compute its eigenrays and eigenverbs.
+ */
+bool wavefront_generator::propagate( int num_de, int num_az,
+	eigenray_collection::reference& eigenrays,
+	eigenverb_collection::reference& eigenverbs,
+	eigenverb_stream* stream )
+{
 	// initialize wavefront
 
-	seq_rayfan orig_de(-90.0, 90.0, _number_de);
+	seq_rayfan orig_de(-90.0, 90.0, num_de);
 	seq_augment de(&orig_de, extra_rays);
 
-	double az_increment = 360.0 / _number_az;
+	double az_increment = 360.0 / num_az;
 	seq_linear az(0.0, az_increment, 359.9);
 
 	wave_queue wave(
 		*(_ocean.get()), *(_frequencies), _source_position, de, az,
-		_time_step, _target_positions, _run_id);
+		_time_step, _target_positions, _run_id, wave_queue::HYBRID_GAUSSIAN,
+		tangent_plane ? wave_queue::TANGENT_PLANE : wave_queue::SPHERICAL_EARTH);
 	wave.intensity_threshold(intensity_threshold);
 	wave.max_bottom(max_bottom);
 	wave.max_surface(max_surface);
 
 	// create listener to store eigenrays
 
-	eigenray_collection::reference eigenrays ;
+	eigenrays.reset() ;
 	if ( _target_positions ) {
 		eigenrays.reset( new eigenray_collection(
 			*_frequencies, _source_position,
@@ -78,24 +125,24 @@ void wavefront_generator::run() {
 
 	// create listener to store eigenverbs
 
-	eigenverb_collection::reference eigenverbs(
-			new eigenverb_collection(_ocean.get()->num_volume()) ) ;
+	eigenverbs.reset( new eigenverb_collection(_ocean.get()->num_volume()) ) ;
 	wave.add_eigenverb_listener( eigenverbs.get() );
+	if ( stream ) wave.add_eigenverb_listener( stream );
 
 	// propagate wavefront to build eigenrays and eigenverbs
+	// eigenverbs are created within one time step of the wavefront
 
 	while (wave.time() < _time_maximum) {
 		wave.step();
 		if (_abort) {
 			cout << id() << " WaveQ3D   *** aborted during execution ***" << endl;
-			return;
+			if ( stream ) stream->close( true );
+			return false;
 		}
+		if ( stream ) stream->advance( wave.time() - _time_step );
 	}
+	if ( stream ) stream->close();
 	if ( eigenrays != NULL ) eigenrays->sum_eigenrays();
-
-	// distribute eigenrays and eigenverbs to sensor pairs
-
-	_wavefront_listener->update_wavefront_data(eigenrays, eigenverbs);
-	_done = true;
+	eigenverbs->merge_eigenverbs();
+	return true ;
 }
-
@@ -17,6 +17,7 @@
 #include <usml/waveq3d/eigenray_notifier.h>
 #include <usml/eigenverb/eigenverb_collection.h>
 #include <usml/eigenverb/wavefront_listener.h>
+#include <usml/eigenverb/wavefront_cache.h>
 
 namespace usml {
 namespace eigenverb {
@@ -47,7 +48,22 @@ using namespace usml::types ;
  *  wavefront_generator::intensity_threshold = -300.0; // dB  Eigenray with intensity values below this are discarded.
  *  wavefront_generator::max_bottom = 999;             // Max number of bottom bounces.
  *  wavefront_generator::max_surface = 999;            // Max number of surface bounces.
+ *  wavefront_generator::coarse_de = 0;                // Progressive mode disabled.
+ *  wavefront_generator::streaming = false;            // Streaming mode disabled.
  * </pre>
+ *
+ * In progressive mode, the generator first propagates a coarse ray fan
+ * with coarse_de D/E angles, and the full set of AZ angles, and publishes
+ * these provisional results to the wavefront_listener. The listener's refine_wavefront() method is
+ * then used to decide if the full fan should be propagated and published
+ * as well. Only the results of the full fan are stored in the
+ * wavefront_cache.
+ *
+ * In streaming mode, the eigenverbs of the full ray fan are also passed to
+ * the wavefront_listener's start_wavefront() method through an
+ * eigenverb_stream, while the wavefront is still running.  This allows
+ * reverberation envelopes to be computed from the early eigenverbs
+ * before the propagation is finished.
  */
 
 class USML_DECLSPEC wavefront_generator : public thread_task
@@ -101,6 +117,17 @@ class USML_DECLSPEC wavefront_generator : public thread_task
         return _done ;
     }
 
+    /**
+     * Store the results of this run in the wavefront_cache when complete.
+     * Results are not cached if this is never called.
+     *
+     * @param key   Key that describes the inputs to this run.
+     */
+    void cache_key( const wavefront_cache::key_type& key ) {
+        _cache_key = key ;
+        _use_cache = true ;
+    }
+
     /**
      * Number of depression/elevation angles to use in WaveQ3D wavefront.
      */
@@ -150,8 +177,48 @@ class USML_DECLSPEC wavefront_generator : public thread_task
      */
     static int max_surface ;
 
+    /**
+     * Use the local tangent plane approximation in WaveQ3D.
+     * Faster for short range problems, but horizontal errors grow
+     * with the square of range. Defaults to false.
+     */
+    static bool tangent_plane ;
+
+    /**
+     * Number of depression/elevation angles in the coarse ray fan used
+     * to compute provisional results. Progressive mode is disabled if this
+     * is zero, or if it is not less than number_de. The coarse ray fan
+     * always uses number_az AZ angles, because the az_index of each
+     * eigenverb must match the azimuths of the reverberation envelopes.
+     * Defaults to 0.
+     */
+    static int coarse_de ;
+
+    /**
+     * Stream the eigenverbs of the full ray fan to the wavefront_listener
+     * while the wavefront is running. Defaults to false.
+     */
+    static bool streaming ;
+
 private:
 
+    /**
+     * Propagate a single ray fan and compute its eigenrays and eigenverbs.
+     *
+     * @param num_de        Number of depression/elevation angles.
+     * @param num_az        Number of AZ angles.
+     * @param eigenrays     Eigenrays computed by this fan (output).
+     * @param eigenverbs    Eigenverbs computed by this fan (output).
+     * @param stream        Optional stream that receives the eigenverbs
+     *                      while the wavefront is running. Closed before
+     *                      this method returns.
+     * @return              False if the task was aborted during execution.
+     */
+    bool propagate( int num_de, int num_az,
+                    eigenray_collection::reference& eigenrays,
+                    eigenverb_collection::reference& eigenverbs,
+                    eigenverb_stream* stream = NULL ) ;
+
     /**
      * Default Constructor - Prevent Access
      */
@@ -203,6 +270,12 @@ private:
 
     /** Pointer to the wavefront_listener. */
     wavefront_listener* _wavefront_listener;
+
+    /** Key used to store results in the wavefront_cache. */
+    wavefront_cache::key_type _cache_key ;
+
+    /** Store results in the wavefront_cache if true. */
+    bool _use_cache ;
 };
 
 /// @}
@@ -8,6 +8,7 @@
 
 #include <usml/waveq3d/eigenray_collection.h>
 #include <usml/eigenverb/eigenverb_collection.h>
+#include <usml/eigenverb/eigenverb_stream.h>
 #include <usml/threads/smart_ptr.h>
 
 namespace usml {
@@ -44,7 +45,35 @@ public:
      */
     virtual void update_wavefront_data(eigenray_collection::reference& eigenrays,
                                         eigenverb_collection::reference& eigenverbs) = 0;
-    
+
+    /**
+     * Called by a progressive wavefront_generator after provisional results
+     * from its coarse ray fan have been published using
+     * update_wavefront_data(). Allows the listener to skip the full ray fan
+     * when the provisional results are good enough.  The default
+     * implementation always asks for refinement.
+     *
+     * @param eigenrays Shared pointer to the provisional eigenray_collection.
+     * @param eigenverbs Shared pointer to the provisional eigenverb_collection.
+     * @return True if the full ray fan should be propagated.
+     */
+    virtual bool refine_wavefront(eigenray_collection::reference& eigenrays,
+                                  eigenverb_collection::reference& eigenverbs) {
+        return true;
+    }
+
+    /**
+     * Called by a streaming wavefront_generator just before it starts to
+     * propagate its full ray fan.  Eigenverbs are added to the stream
+     * while the wavefront is running, and the stream is closed before
+     * the final results are published using update_wavefront_data().
+     * The default implementation ignores the stream.
+     *
+     * @param stream    Shared pointer to the stream of eigenverbs.
+     */
+    virtual void start_wavefront(eigenverb_stream::reference& stream) {
+    }
+
 protected:
 
     /**
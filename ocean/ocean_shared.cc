@@ -9,11 +9,17 @@ using namespace usml::ocean ;
 /** Shared reference to the current ocean. */
 ocean_shared::reference ocean_shared::_current = ocean_shared::reference();
 
+/** Number of times that the shared ocean has been changed. */
+size_t ocean_shared::_version = 0 ;
+
+/** Locks singleton while ocean is being changed. */
+read_write_lock ocean_shared::_lock ;
+
 /**
  * Pass a shared reference of current ocean back to client.
  */
 ocean_shared::reference ocean_shared::current() {
-    read_lock_guard(_lock) ;
+    read_lock_guard guard(_lock) ;
     return _current ;
 }
 
@@ -21,14 +27,24 @@ ocean_shared::reference ocean_shared::current() {
  * Update shared ocean with new data.
  */
 void ocean_shared::update( ocean_shared::reference& ocean ) {
-    write_lock_guard(_lock) ;
+    write_lock_guard guard(_lock) ;
     _current = ocean ;
+    ++_version ;
 }
 
 /**
 * Reset the shared ocean to empty.
 */
 void ocean_shared::reset() {
-    write_lock_guard(_lock);
-    _current.reset();
+    write_lock_guard guard(_lock) ;
+    _current.reset() ;
+    ++_version ;
+}
+
+/**
+ * Number of times that the shared ocean has been changed.
+ */
+size_t ocean_shared::version() {
+    read_lock_guard guard(_lock) ;
+    return _version ;
 }
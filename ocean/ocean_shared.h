@@ -63,6 +63,15 @@ public:
      */
     static void reset();
 
+    /**
+     * Number of times that the shared ocean has been changed by
+     * update() or reset(). Allows clients, like the wavefront_cache,
+     * to detect that results computed with an older ocean are stale.
+     * Read this before current() to ensure that the version is never
+     * newer than the ocean it describes.
+     */
+    static size_t version() ;
+
 private:
 
     /** 
@@ -71,8 +80,11 @@ private:
      */
     static reference _current ;
 
+    /** Number of times that the shared ocean has been changed. */
+    static size_t _version ;
+
     /** Locks singleton while ocean is being changed. */
-    read_write_lock _lock ;
+    static read_write_lock _lock ;
 
     /**
      * Hide constructors to prevent incorrect use of singleton.
@@ -0,0 +1,184 @@
+/**
+ * @file beam_gain_table.cc
+ * Beam levels for a list of beams, precomputed on a grid of arrival angles.
+ */
+#include <usml/sensors/beam_gain_table.h>
+#include <usml/sensors/beam_pattern_map.h>
+#include <boost/foreach.hpp>
+#include <algorithm>
+
+using namespace usml::sensors ;
+
+double beam_gain_table::de_spacing = 1.0 ;          // degrees
+double beam_gain_table::az_spacing = 1.0 ;          // degrees
+double beam_gain_table::points_per_beam = 4.0 ;     // nodes per main lobe
+size_t beam_gain_table::max_table_size = 8000000 ;  // values
+
+std::map< beam_gain_table::key_type, boost::weak_ptr<const beam_gain_table> >
+    beam_gain_table::_cache ;
+read_write_lock beam_gain_table::_cache_mutex ;
+
+/**
+ * Evaluate the beam patterns at each point on the angle grid.
+ */
+beam_gain_table::beam_gain_table(
+    const sensor_params::beam_pattern_list& beam_list,
+    const seq_vector* frequencies, const orientation& orient
+) :
+    _num_freq( frequencies->size() ),
+    _num_beams( beam_list.size() )
+{
+    const vector<double> freq = *frequencies ;  // beam_level requires ublas vector
+    vector<double> level( _num_freq ) ;
+    orientation orient_copy( orient ) ;         // beam_level requires non-const
+
+    BOOST_FOREACH( beam_pattern_model::id_type id, beam_list ) {
+        _patterns.push_back( beam_pattern_map::instance()->find(id) ) ;
+    }
+
+    // choose a grid spacing that divides each axis exactly,
+    // and keeps the table within max_table_size values
+
+    const double spacing = beam_spacing( _patterns, freq ) ;
+    double de_step = std::min( spacing, de_spacing ) ;
+    double az_step = std::min( spacing, az_spacing ) ;
+    const double values = (double) std::max( _num_freq * _num_beams, (size_t) 1 ) ;
+    const double limit = std::max( max_table_size / values, 4.0 ) ;
+    while ( ( 180.0 / de_step + 1.0 ) * ( 360.0 / az_step + 1.0 ) > limit
+            && ( de_step < 180.0 || az_step < 360.0 ) )
+    {
+        de_step *= 1.25 ;
+        az_step *= 1.25 ;
+    }
+    const size_t de_cells = std::max( (size_t) ceil( 180.0 / de_step - 1e-9 ), (size_t) 1 ) ;
+    const size_t az_cells = std::max( (size_t) ceil( 360.0 / az_step - 1e-9 ), (size_t) 1 ) ;
+    _num_de = de_cells + 1 ;
+    _num_az = az_cells + 1 ;
+    _de_spacing = 180.0 / de_cells ;
+    _az_spacing = 360.0 / az_cells ;
+    _table.resize( _num_de * _num_az * _num_freq * _num_beams, 0.0 ) ;
+
+    // evaluate each beam at every node,
+    // the last nodes are exactly +90 deg in D/E and 360 deg in AZ
+
+    size_t beam = 0 ;
+    BOOST_FOREACH( beam_pattern_model::reference bp, _patterns ) {
+        for ( size_t d=0 ; d < _num_de ; ++d ) {
+            const double de = to_radians( ( d == de_cells ) ?
+                90.0 : -90.0 + d * _de_spacing ) ;
+            for ( size_t a=0 ; a < _num_az ; ++a ) {
+                const double az = to_radians( ( a == az_cells ) ?
+                    360.0 : a * _az_spacing ) ;
+                bp->beam_level( de, az, orient_copy, freq, &level ) ;
+                double* node = &_table[ ( d * _num_az + a ) * _num_freq * _num_beams ] ;
+                for ( size_t f=0 ; f < _num_freq ; ++f ) {
+                    node[ f * _num_beams + beam ] = level[f] ;
+                }
+            }
+        }
+        ++beam ;
+    }
+}
+
+/**
+ * Grid spacing needed to resolve the narrowest beam in a list.
+ */
+double beam_gain_table::beam_spacing(
+    const std::vector<beam_pattern_model::reference>& patterns,
+    const vector<double>& frequencies )
+{
+    double directivity = 1.0 ;
+    vector<double> index( frequencies.size() ) ;
+    BOOST_FOREACH( beam_pattern_model::reference bp, patterns ) {
+        bp->directivity_index( frequencies, &index ) ;
+        for ( size_t f=0 ; f < index.size() ; ++f ) {
+            directivity = std::max( directivity, pow( 10.0, index[f] / 10.0 ) ) ;
+        }
+    }
+    const double width = to_degrees( 2.0 / directivity ) ;
+    return std::max( width / std::max( points_per_beam, 1.0 ), 1e-3 ) ;
+}
+
+/**
+ * Finds or builds the table for a combination of beams, frequencies,
+ * and orientation.
+ */
+beam_gain_table::reference beam_gain_table::shared(
+    const sensor_params::beam_pattern_list& beam_list,
+    const seq_vector* frequencies, const orientation& orient )
+{
+    key_type key ;
+    BOOST_FOREACH( beam_pattern_model::id_type id, beam_list ) {
+        key.beams.push_back( beam_pattern_map::instance()->find(id).get() ) ;
+    }
+    key.parameters.push_back( orient.heading() ) ;
+    key.parameters.push_back( orient.pitch() ) ;
+    key.parameters.push_back( orient.roll() ) ;
+    key.parameters.push_back( de_spacing ) ;
+    key.parameters.push_back( az_spacing ) ;
+    key.parameters.push_back( points_per_beam ) ;
+    key.parameters.push_back( (double) max_table_size ) ;
+    for ( size_t f=0 ; f < frequencies->size() ; ++f ) {
+        key.parameters.push_back( (*frequencies)[f] ) ;
+    }
+
+    // build a new table while holding the lock,
+    // so that other callers wait for it instead of repeating it
+
+    write_lock_guard guard(_cache_mutex);
+    reference table = _cache[key].lock() ;
+    if ( table.get() == NULL ) {
+        for ( std::map< key_type, boost::weak_ptr<const beam_gain_table> >::iterator
+              it = _cache.begin() ; it != _cache.end() ; )
+        {
+            if ( it->second.expired() ) {
+                _cache.erase( it++ ) ;
+            } else {
+                ++it ;
+            }
+        }
+        table.reset( new beam_gain_table( beam_list, frequencies, orient ) ) ;
+        _cache[key] = table ;
+    }
+    return table ;
+}
+
+/**
+ * Interpolate beam levels for a specific arrival direction.
+ */
+void beam_gain_table::gain( double de, double az, matrix<double>* level ) const {
+    if ( _num_beams == 0 ) return ;
+
+    // find grid cell and interpolation weights in D/E
+
+    double x = ( to_degrees(de) + 90.0 ) / _de_spacing ;
+    x = std::max( 0.0, std::min( x, (double) ( _num_de - 1 ) ) ) ;
+    size_t d = std::min( (size_t) x, _num_de - 2 ) ;
+    const double u = x - d ;
+
+    // find grid cell and interpolation weights in AZ, wraps at 360 deg
+
+    double y = fmod( to_degrees(az), 360.0 ) ;
+    if ( y < 0.0 ) y += 360.0 ;
+    y /= _az_spacing ;
+    y = std::min( y, (double) ( _num_az - 1 ) ) ;
+    size_t a = std::min( (size_t) y, _num_az - 2 ) ;
+    const double v = y - a ;
+
+    // bilinear interpolation of each frequency/beam combination
+
+    const size_t block = _num_freq * _num_beams ;
+    const double* p00 = &_table[ ( d * _num_az + a ) * block ] ;
+    const double* p01 = p00 + block ;
+    const double* p10 = p00 + _num_az * block ;
+    const double* p11 = p10 + block ;
+    const double w00 = ( 1.0 - u ) * ( 1.0 - v ) ;
+    const double w01 = ( 1.0 - u ) * v ;
+    const double w10 = u * ( 1.0 - v ) ;
+    const double w11 = u * v ;
+
+    double* result = &(*level)(0,0) ;
+    for ( size_t n=0 ; n < block ; ++n ) {
+        result[n] = w00 * p00[n] + w01 * p01[n] + w10 * p10[n] + w11 * p11[n] ;
+    }
+}
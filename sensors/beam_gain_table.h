@@ -0,0 +1,214 @@
+/**
+ * @file beam_gain_table.h
+ * Beam levels for a list of beams, precomputed on a grid of arrival angles.
+ */
+#pragma once
+
+#include <usml/usml_config.h>
+#include <usml/types/seq_vector.h>
+#include <usml/threads/read_write_lock.h>
+#include <usml/sensors/orientation.h>
+#include <usml/sensors/sensor_params.h>
+#include <usml/sensors/beam_pattern_model.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <map>
+#include <vector>
+
+namespace usml {
+namespace sensors {
+
+using namespace usml::types ;
+using namespace usml::threads ;
+
+/// @ingroup beams
+/// @{
+
+/**
+ * Beam levels for a list of beams, precomputed on a regular grid of
+ * depression/elevation and azimuthal arrival angles, for a fixed
+ * sensor orientation and set of frequencies.  Lookups use bilinear
+ * interpolation between the four surrounding grid points, and write into
+ * storage supplied by the caller, so that no memory is allocated and no
+ * beam_pattern_map lookups are needed after construction.
+ *
+ * The table is organized as [de][az][frequency][beam], so that the
+ * block of values for each grid point has the same layout as the
+ * frequency (rows) by beam (columns) result matrix.  The grid has
+ * nodes at exactly -90 and +90 degrees in D/E, and at exactly 0 and
+ * 360 degrees in AZ, so that the azimuth axis wraps around without a gap.
+ * The spacing of the grid is chosen from the directivity of the
+ * narrowest beam, with points_per_beam nodes across its main lobe, but is
+ * never larger than de_spacing and az_spacing, and it grows if needed to
+ * keep the table within max_table_size values.
+ *
+ * Tables are expensive to build, because each node requires
+ * a beam_level() call for each beam.  The shared() method returns a
+ * table that is shared by every caller with the same beam patterns,
+ * orientation, and frequencies, for as long as any of them holds a
+ * reference to it.  Beam patterns are identified by their instance in
+ * the beam_pattern_map, so beam patterns must not be modified after
+ * they are inserted into that map.
+ */
+class USML_DECLSPEC beam_gain_table {
+
+public:
+
+    /**
+     * Data type used for reference to a shared beam_gain_table.
+     */
+    typedef boost::shared_ptr<const beam_gain_table> reference ;
+
+    /**
+     * Evaluate the beam patterns at each point on the angle grid.
+     * Use shared() to avoid building the same table more than once.
+     *
+     * @param beam_list     List of beam pattern IDs to evaluate.
+     * @param frequencies   Frequencies at which to compute beam levels (Hz).
+     * @param orient        Orientation of the sensor.
+     */
+    beam_gain_table( const sensor_params::beam_pattern_list& beam_list,
+                     const seq_vector* frequencies, const orientation& orient ) ;
+
+    /**
+     * Finds the table for a specific combination of beam patterns,
+     * frequencies, and orientation, and builds a new one if no other
+     * caller is currently using it.
+     *
+     * @param beam_list     List of beam pattern IDs to evaluate.
+     * @param frequencies   Frequencies at which to compute beam levels (Hz).
+     * @param orient        Orientation of the sensor.
+     * @return              Reference to a shared table.
+     */
+    static reference shared( const sensor_params::beam_pattern_list& beam_list,
+                     const seq_vector* frequencies, const orientation& orient ) ;
+
+    /** Number of frequencies in each result. */
+    size_t num_frequencies() const {
+        return _num_freq ;
+    }
+
+    /** Number of beams in each result. */
+    size_t num_beams() const {
+        return _num_beams ;
+    }
+
+    /** Spacing of the depression/elevation grid (deg). */
+    double grid_de_spacing() const {
+        return _de_spacing ;
+    }
+
+    /** Spacing of the azimuthal grid (deg). */
+    double grid_az_spacing() const {
+        return _az_spacing ;
+    }
+
+    /**
+     * Interpolate beam levels for a specific arrival direction.
+     *
+     * @param de        Depression/Elevation angle (rad).
+     * @param az        Azimuthal angle (rad).
+     * @param level     Beam level for each frequency (rows) and
+     *                  beam (columns). Must be preallocated to
+     *                  num_frequencies() by num_beams().
+     */
+    void gain( double de, double az, matrix<double>* level ) const ;
+
+    /**
+     * Largest spacing of the depression/elevation grid (deg),
+     * used for broad beams. Defaults to 1.0.
+     */
+    static double de_spacing ;
+
+    /**
+     * Largest spacing of the azimuthal grid (deg),
+     * used for broad beams. Defaults to 1.0.
+     */
+    static double az_spacing ;
+
+    /**
+     * Number of grid nodes across the main lobe of the narrowest beam.
+     * The width of the main lobe is estimated from the largest directivity
+     * index D of any beam as 2/D radians, the width of a fan beam that is
+     * omni-directional in the other dimension.  This is a lower bound on
+     * the narrowest dimension of any beam with that directivity.
+     * Defaults to 4.0.
+     */
+    static double points_per_beam ;
+
+    /**
+     * Largest number of values in a table. The grid spacing is increased
+     * above that chosen from the beam width to stay within this limit.
+     * Defaults to 8,000,000 values (64 MB).
+     */
+    static size_t max_table_size ;
+
+private:
+
+    /**
+     * Lookup key for shared tables.
+     */
+    struct key_type {
+
+        /** Beam pattern instances, in the order of the beam list. */
+        std::vector<const beam_pattern_model*> beams ;
+
+        /** Orientation, grid parameters, and frequencies. */
+        std::vector<double> parameters ;
+
+        /** Strict weak ordering for use in std::map. */
+        bool operator<( const key_type& other ) const {
+            if ( beams != other.beams ) {
+                return beams < other.beams ;
+            }
+            return parameters < other.parameters ;
+        }
+    };
+
+    /**
+     * Grid spacing needed to resolve the narrowest beam in a list (deg).
+     *
+     * @param patterns      Beam patterns to evaluate.
+     * @param frequencies   Frequencies at which to compute beam levels (Hz).
+     */
+    static double beam_spacing(
+        const std::vector<beam_pattern_model::reference>& patterns,
+        const vector<double>& frequencies ) ;
+
+    /** Number of frequencies in each result. */
+    const size_t _num_freq ;
+
+    /** Number of beams in each result. */
+    const size_t _num_beams ;
+
+    /**
+     * Beam patterns used to build this table, held so that their
+     * instances can not be reused while this table is shared.
+     */
+    std::vector<beam_pattern_model::reference> _patterns ;
+
+    /** Spacing of the depression/elevation grid (deg). */
+    double _de_spacing ;
+
+    /** Spacing of the azimuthal grid (deg). */
+    double _az_spacing ;
+
+    /** Number of points on the depression/elevation grid. */
+    size_t _num_de ;
+
+    /** Number of points on the azimuthal grid, including 360 deg. */
+    size_t _num_az ;
+
+    /** Beam levels organized as [de][az][frequency][beam]. */
+    std::vector<double> _table ;
+
+    /** Tables currently in use, by beam patterns, orientation and frequency. */
+    static std::map< key_type, boost::weak_ptr<const beam_gain_table> > _cache ;
+
+    /** The mutex for the cache of shared tables. */
+    static read_write_lock _cache_mutex ;
+};
+
+/// @}
+}   // end of namespace sensors
+}   // end of namespace usml
@@ -13,24 +13,42 @@ using namespace usml::sensors ;
 
 
 /**
- * Updates the fathometer data with the parameters provided.
+ * Gets the eigenray_list with the dead reckoning transform applied.
  */
-void fathometer_collection::dead_reckon(double delta_time,
-                                    double slant_range, double prev_range) {
-    // Set new slant_range
-    _slant_range = slant_range;
+eigenray_list fathometer_collection::eigenrays() {
+    // snapshot of the dead reckoning transform
 
-    write_lock_guard guard(_eigenrays_mutex);
-
-    eigenray_list::iterator iter;
-    for (iter = _eigenrays.begin(); iter != _eigenrays.end(); ++iter) {
-
-        iter->time = iter->time + delta_time;
-        for (int i = 0; i < iter->frequencies->size(); ++i) {
-        	iter->intensity[i] = iter->intensity[i] -
-                (20*log10(prev_range)) + (20*log10(_slant_range));
+    double delta_time, delta_intensity;
+    {
+        read_lock_guard guard(_transform_mutex);
+        delta_time = _time_offset;
+        delta_intensity = _intensity_offset;
+    }
+    eigenray_list result;
+    {
+        read_lock_guard guard(_eigenrays_mutex);
+        result = _eigenrays;
+    }
+    if ( delta_time != 0.0 || delta_intensity != 0.0 ) {
+        BOOST_FOREACH( eigenray& ray, result ) {
+            ray.time += delta_time;
+            ray.intensity += scalar_vector<double>(
+                ray.intensity.size(), delta_intensity );
         }
     }
+    return result;
+}
+
+/**
+ * Updates the dead reckoning transform with the parameters provided.
+ */
+void fathometer_collection::dead_reckon(double delta_time,
+                                    double slant_range, double prev_range) {
+    const double delta_intensity = 20.0 * log10( slant_range / prev_range );
+    write_lock_guard guard(_transform_mutex);
+    _time_offset += delta_time;
+    _intensity_offset += delta_intensity;
+    _slant_range = slant_range;
 }
 
 /**
@@ -45,6 +63,16 @@ void fathometer_collection::write_netcdf( const char* filename, const char* long
     }
     nc_file->add_att("Conventions", "COARDS");
 
+    // snapshot of the dead reckoning transform
+
+    double delta_time, delta_intensity, range;
+    {
+        read_lock_guard guard(_transform_mutex);
+        delta_time = _time_offset;
+        delta_intensity = _intensity_offset;
+        range = _slant_range;
+    }
+
     //read_lock_guard guard(_eigenrays_mutex);
     if ( _eigenrays.size() == 0 ) {
         nc_file->add_att("Eigenrays", "None Found");
@@ -136,7 +164,7 @@ void fathometer_collection::write_netcdf( const char* filename, const char* long
     item = _receiver_id; receiver_id->put(&item, 1); 
 
     v = _initial_time;  initial_time->put(&v, 1);
-    v = _slant_range;   slant_range->put(&v, 1);
+    v = range;   slant_range->put(&v, 1);
 
     // write source parameters
 
@@ -168,6 +196,11 @@ void fathometer_collection::write_netcdf( const char* filename, const char* long
         lower_var->set_cur(record);
         ++record;
 
+        // apply dead reckoning transform to this copy of the eigenray
+
+        ray.time += delta_time;
+        ray.intensity += scalar_vector<double>( ray.intensity.size(), delta_intensity );
+
         intensity_var->put(ray.intensity.data().begin(), 1, num_frequencies);
         phase_var->put(ray.phase.data().begin(), 1, num_frequencies);
         time_var->put(&( ray.time ), 1);
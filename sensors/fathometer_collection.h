@@ -46,7 +46,8 @@ public:
     fathometer_collection(sensor_model::id_type source_id, sensor_model::id_type receiver_id,
                      wposition1 src_pos, wposition1 rcv_pos,  const eigenray_list& list )
         :  _source_id(source_id), _receiver_id(receiver_id),
-           _source_position(src_pos), _receiver_position(rcv_pos), _eigenrays(list)
+           _source_position(src_pos), _receiver_position(rcv_pos), _eigenrays(list),
+           _time_offset(0.0), _intensity_offset(0.0)
     {
         _slant_range = _receiver_position.distance(_source_position);
         // Get first eigenray arrival time
@@ -82,6 +83,7 @@ public:
      * @return  The slant_range.
      */
     double slant_range() {
+        read_lock_guard guard(_transform_mutex);
         return _slant_range;
     }
 
@@ -134,16 +136,36 @@ public:
     }
 
     /**
-     * Gets the eigenray_list for this fathometer_collection.
+     * Gets the eigenray_list for this fathometer_collection,
+     * with the dead reckoning transform applied.
      * @return  eigenray_list
      */
-    eigenray_list eigenrays() {
-         read_lock_guard guard(_eigenrays_mutex);
-         return _eigenrays;
+    eigenray_list eigenrays() ;
+
+    /**
+     * Time shift applied to eigenrays by dead reckoning (sec).
+     */
+    double time_offset() const {
+        read_lock_guard guard(_transform_mutex);
+        return _time_offset;
+    }
+
+    /**
+     * Change in intensity applied to eigenrays by dead reckoning (dB).
+     */
+    double intensity_offset() const {
+        read_lock_guard guard(_transform_mutex);
+        return _intensity_offset;
     }
 
     /**
      * Updates the fathometer data with the parameters provided.
+     * The eigenrays are not modified. Instead, the time shift and
+     * change in intensity are accumulated into a transform that is applied
+     * as the eigenrays are read or written to disk.  This makes each update
+     * a constant time operation, no matter how many eigenrays there are.
+     * The transform has its own lock, so updates never wait for readers
+     * that are copying the eigenrays.
      *
      * @param delta_time    The time amount to shift the eigenrays
      * @param slant_range   The range in meters from the source and receiver.
@@ -320,11 +342,27 @@ private:
      */
     eigenray_list _eigenrays;
 
+    /**
+     * Time shift applied to eigenrays by dead reckoning (sec).
+     */
+    double _time_offset;
+
+    /**
+     * Change in intensity applied to eigenrays by dead reckoning (dB).
+     */
+    double _intensity_offset;
+
     /**
      * Mutex that locks during eigenray access
      */
     mutable read_write_lock _eigenrays_mutex ;
 
+    /**
+     * Mutex that locks during access to the dead reckoning transform
+     * and slant range.
+     */
+    mutable read_write_lock _transform_mutex ;
+
 };
 
 /// @}
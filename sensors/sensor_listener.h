@@ -5,6 +5,7 @@
 #pragma once
 
 #include <usml/sensors/sensor_model.h>
+#include <usml/eigenverb/eigenverb_stream.h>
 
 namespace usml {
 namespace sensors {
@@ -14,6 +15,7 @@ class sensor_model;
 
 using namespace usml::sensors ;
 using namespace usml::waveq3d ;
+using namespace usml::eigenverb ;
 
 /// @ingroup sensors
 /// @{
@@ -51,6 +53,32 @@ public:
      */
     virtual void update_eigenverbs(double initial_time, sensor_model* sensor) = 0;
 
+    /**
+     * Notification that a sensor has started to stream eigenverbs
+     * from a running wavefront. The final eigenverbs are still delivered
+     * by update_eigenverbs() when the wavefront is complete.
+     * The default implementation ignores the stream.
+     *
+     * @param   sensor          Pointer to sensor that issued the notification.
+     * @param   stream          Stream of eigenverbs from this sensor.
+     */
+    virtual void start_eigenverbs(sensor_model* sensor,
+                                  eigenverb_stream::reference& stream) {
+    }
+
+    /**
+     * Query after a sensor has published provisional eigenverbs from
+     * a coarse ray fan using update_eigenverbs().  Allows the listener to
+     * skip the full ray fan when the provisional results are good enough.
+     * The default implementation always asks for refinement.
+     *
+     * @param   sensor          Pointer to sensor that issued the query.
+     * @return                  True if the full ray fan should be propagated.
+     */
+    virtual bool refine_eigenverbs(sensor_model* sensor) {
+        return true;
+    }
+
     /**
      * Queries for the sensor pair complements of this sensor.
      *
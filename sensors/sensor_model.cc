@@ -7,6 +7,7 @@
 #include <usml/sensors/source_params_map.h>
 #include <usml/sensors/receiver_params_map.h>
 #include <usml/eigenverb/wavefront_generator.h>
+#include <usml/eigenverb/wavefront_cache.h>
 #include <usml/ocean/ocean_shared.h>
 #include <boost/foreach.hpp>
 
@@ -159,24 +160,51 @@ void sensor_model::update_wavefront_data(eigenray_collection::reference& eigenra
             read_lock_guard guard(_eigenrays_mutex);
             int row = iter->second;
             // Get eigenray_list for listener, ie sensor_pair
-            // Get complement's row's eigenray_list
-            eigenray_list* list = _eigenray_collection->eigenrays(row, 0);
+            // Copy complement's row's eigenrays out of the collection
+            eigenray_list list;
+            _eigenray_collection->eigenrays(row, 0, &list);
 #ifdef USML_DEBUG
-            cout << "sensor_model: update_wavefront_data eigenray list size " << list->size() << endl;
+            cout << "sensor_model: update_wavefront_data eigenray list size " << list.size() << endl;
 #endif
             // Only update when eigenrays are found
-            if ( list->size() > 0 ) {
+            if ( list.size() > 0 ) {
                 // Get first eigenrays arrival time
-                std::list<eigenray>::const_iterator ray_iter = list->begin();
-                first_ray_arrival_time = ray_iter->time;
+                first_ray_arrival_time = list.front().time;
                 // Send out eigenray_list to listener
-                listener->update_fathometer(_sensorID, list);
+                listener->update_fathometer(_sensorID, &list);
             }
         }
         listener->update_eigenverbs(first_ray_arrival_time, this);
     }
 }
 
+/**
+ * Notification that the wavefront task has started to stream eigenverbs.
+ */
+void sensor_model::start_wavefront(eigenverb_stream::reference& stream) {
+    read_lock_guard guard(_sensor_listeners_mutex);
+#ifdef USML_DEBUG
+    cout << "sensor_model: start_wavefront(" << _sensorID << ")" << endl;
+#endif
+    BOOST_FOREACH(sensor_listener* listener, _sensor_listeners) {
+        listener->start_eigenverbs(this, stream);
+    }
+}
+
+/**
+ * Query from a progressive wavefront task after its provisional results
+ * have been published.
+ */
+bool sensor_model::refine_wavefront(eigenray_collection::reference& eigenrays,
+                                    eigenverb_collection::reference& eigenverbs) {
+    read_lock_guard guard(_sensor_listeners_mutex);
+    if ( _sensor_listeners.empty() ) return true;
+    BOOST_FOREACH(sensor_listener* listener, _sensor_listeners) {
+        if ( listener->refine_eigenverbs(this) ) return true;
+    }
+    return false;
+}
+
 /**
  * Add a sensor_listener to the _sensor_listeners list
  */
@@ -312,8 +340,13 @@ void sensor_model::frequencies() {
  */
 void sensor_model::run_wave_generator() {
 
+    // Read the version before the ocean, so that the version
+    // can never be newer than the ocean used to compute the results
+    const size_t ocean_version = ocean_shared::version() ;
+    ocean_shared::reference ocean = ocean_shared::current() ;
+
     // Only run wavefront generator if ocean_model pointer is not NULL
-    if (ocean_shared::current().get() != NULL ) {
+    if ( ocean.get() != NULL ) {
 
         #ifdef USML_DEBUG
             cout << "sensor_model: run_wave_generator(" << _sensorID << ")" << endl ;
@@ -332,9 +365,32 @@ void sensor_model::run_wave_generator() {
             target_pos = target_positions(targets);
         }
 
+        // Reuse results from an earlier run at this location, if available
+        wavefront_cache::key_type key = wavefront_cache::make_key(
+            ocean_version, _position, target_pos, _frequencies.get() ) ;
+        if ( wavefront_cache::max_entries > 0 ) {
+            eigenray_collection::reference eigenrays ;
+            eigenverb_collection::reference eigenverbs ;
+            if ( wavefront_cache::instance()->find( key, &eigenrays, &eigenverbs ) ) {
+                #ifdef USML_DEBUG
+                    cout << "sensor_model: run_wave_generator cache hit (" << _sensorID << ")" << endl ;
+                #endif
+                delete target_pos ;
+                if ( _wavefront_task.get() != 0 ) {
+                    _wavefront_task->abort();
+                    _wavefront_task.reset();
+                }
+                update_wavefront_data( eigenrays, eigenverbs ) ;
+                return ;
+            }
+        }
+
         // Create the wavefront_generator
         wavefront_generator* generator = new wavefront_generator (
-            ocean_shared::current(), _position, target_pos, _frequencies.get(), this);
+            ocean, _position, target_pos, _frequencies.get(), this);
+        if ( wavefront_cache::max_entries > 0 ) {
+            generator->cache_key( key ) ;
+        }
 
         // Make wavefront_generator a wavefront_task, with use of shared_ptr
         _wavefront_task = thread_task::reference(generator);
@@ -344,7 +400,7 @@ void sensor_model::run_wave_generator() {
     }
 
     #ifdef USML_DEBUG
-        if (ocean_shared::current().get() == NULL ) {
+        if ( ocean.get() == NULL ) {
              cout << "sensor_model: run_wave_generator no ocean provided !!! (" << _sensorID << ")" << endl ;
         }
     #endif
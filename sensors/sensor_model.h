@@ -176,6 +176,24 @@ public:
     virtual void update_wavefront_data(eigenray_collection::reference& eigenrays,
                                         eigenverb_collection::reference& eigenverbs);
 
+    /**
+     * Notification that the wavefront task has started to stream eigenverbs.
+     * Passes the stream onto all sensor listeners.
+     * @param stream Shared pointer to the stream of eigenverbs.
+     */
+    virtual void start_wavefront(eigenverb_stream::reference& stream);
+
+    /**
+     * Query from a progressive wavefront task after its provisional results
+     * have been published.  Asks for the full ray fan if any of the sensor
+     * listeners ask for it, or if there are no listeners to ask.
+     * @param eigenrays Shared pointer to the provisional eigenray_collection.
+     * @param eigenverbs Shared pointer to the provisional eigenverb_collection.
+     * @return True if the full ray fan should be propagated.
+     */
+    virtual bool refine_wavefront(eigenray_collection::reference& eigenrays,
+                                  eigenverb_collection::reference& eigenverbs);
+
     /**
      * Add a sensor_listener to the _sensor_listeners list
      * @param listener  Pointer to a sensor_listener to add
@@ -6,10 +6,12 @@
 #include <usml/eigenverb/envelope_generator.h>
 #include <usml/eigenverb/wavefront_generator.h>
 #include <usml/waveq3d/eigenray_interpolator.h>
+#include <usml/ocean/ocean_shared.h>
 #include <boost/foreach.hpp>
 
 using namespace usml::sensors;
 using namespace usml::waveq3d;
+using namespace usml::ocean;
 
 /**
  * Utility to run the envelope_generator
@@ -20,6 +22,8 @@ void sensor_pair::run_envelope_generator(double initial_time) {
         cout << "sensor_pair: run_envelope_generator " << endl ;
     #endif
 
+    write_lock_guard guard(_envelopes_task_mutex);
+
     // Kill any currently running task
     if ( _envelopes_task.get() != 0 ) {
         _envelopes_task->abort();
@@ -31,11 +35,57 @@ void sensor_pair::run_envelope_generator(double initial_time) {
 
     // Make envelope_generator a _envelopes_task, with use of shared_ptr
     _envelopes_task = thread_task::reference(generator);
+    _task_src_stream.reset();
+    _task_rcv_stream.reset();
 
     // Pass in to thread_pool
     thread_controller::instance()->run(_envelopes_task);
 }
 
+/**
+ * Utility to run the envelope_generator in streaming mode.
+ */
+void sensor_pair::run_stream_generator(double initial_time) {
+
+    #ifdef USML_DEBUG
+        cout << "sensor_pair: run_stream_generator " << endl ;
+    #endif
+
+    write_lock_guard guard(_envelopes_task_mutex);
+
+    // Kill any currently running task
+    if ( _envelopes_task.get() != 0 ) {
+        _envelopes_task->abort();
+    }
+
+    // Create the envelope_generator from the eigenverb streams
+    envelope_generator* generator = new envelope_generator (
+		this, initial_time, _src_freq_first, wavefront_generator::number_az,
+		_src_stream, _rcv_stream );
+
+    // Make envelope_generator a _envelopes_task, with use of shared_ptr
+    _envelopes_task = thread_task::reference(generator);
+    _task_src_stream = _src_stream;
+    _task_rcv_stream = _rcv_stream;
+    _task_initial_time = initial_time;
+
+    // Pass in to thread_pool
+    thread_controller::instance()->run(_envelopes_task);
+}
+
+/**
+ * Estimate of the travel time of the fastest eigenray.
+ */
+double sensor_pair::estimate_initial_time() const {
+    const wposition1 src_pos = _source->position();
+    const wposition1 rcv_pos = _receiver->position();
+    wposition location( 1, 1, src_pos.latitude(), src_pos.longitude(),
+        src_pos.altitude() );
+    matrix<double> speed( 1, 1 );
+    ocean_shared::current()->profile().sound_speed( location, &speed );
+    return src_pos.distance(rcv_pos) / speed(0,0);
+}
+
 /**
 * Utility to build the intersecting frequencies of a sensor_pair.
 */
@@ -134,12 +184,87 @@ void sensor_pair::update_eigenverbs(double initial_time, sensor_model* sensor)
             _rcv_eigenverbs = sensor->eigenverbs();
         }
 
-        if ( _src_eigenverbs.get() != NULL && _rcv_eigenverbs.get() != NULL ) {
-            run_envelope_generator(initial_time);
+        if ( _src_eigenverbs.get() == NULL || _rcv_eigenverbs.get() == NULL ) {
+            return;
+        }
+
+        // skip the pair search if these eigenverbs were streamed into the
+        // current envelope_generator, which publishes the final result,
+        // unless its estimate of the initial time is off by more than one
+        // time step, and forget streams that are older than these eigenverbs
+
+        bool streamed = true;
+        eigenverb_stream::reference src_stream, rcv_stream;
+        {
+            write_lock_guard guard(_streams_mutex);
+            if (sensor == _source) {
+                if ( !_src_stream_pending ) {
+                    _src_stream.reset();
+                    streamed = false;
+                }
+                _src_stream_pending = false;
+            }
+            if (sensor == _receiver) {
+                if ( !_rcv_stream_pending ) {
+                    _rcv_stream.reset();
+                    streamed = false;
+                }
+                _rcv_stream_pending = false;
+            }
+            src_stream = _src_stream;
+            rcv_stream = _rcv_stream;
+        }
+        if ( streamed && src_stream.get() != NULL && rcv_stream.get() != NULL ) {
+            read_lock_guard guard(_envelopes_task_mutex);
+            if ( _task_src_stream == src_stream && _task_rcv_stream == rcv_stream
+                 && std::abs(_task_initial_time - initial_time)
+                    <= envelope_generator::travel_time()->increment(0) )
+            {
+                return;
+            }
         }
+        run_envelope_generator(initial_time);
 	}
 }
 
+/**
+ * Starts a streaming envelope_generator when both sensors have streams.
+ */
+void sensor_pair::start_eigenverbs(sensor_model* sensor,
+                                   eigenverb_stream::reference& stream)
+{
+    if (sensor == NULL) return;
+
+    #ifdef USML_DEBUG
+        cout << "sensor_pair: start_eigenverbs("
+             << sensor->sensorID() << ")" << endl ;
+    #endif
+
+    write_lock_guard guard(_streams_mutex);
+    if (sensor == _source) {
+        _src_stream = stream;
+        _src_stream_pending = true;
+    }
+    if (sensor == _receiver) {
+        _rcv_stream = stream;
+        _rcv_stream_pending = true;
+    }
+    if ( _src_stream.get() == NULL || _rcv_stream.get() == NULL ) return;
+    if ( _src_stream->closed() && _rcv_stream->closed() ) return;
+
+    // estimate initial time from the last set of envelopes,
+    // or from the direct path if there are none
+
+    double initial_time;
+    envelope_collection::reference previous = envelopes();
+    if ( previous.get() != NULL ) {
+        initial_time = previous->initial_time();
+    } else {
+        initial_time = estimate_initial_time();
+    }
+    run_stream_generator(initial_time);
+}
+
 /**
  * Updates new envelope_colection
  */
@@ -156,6 +281,36 @@ void sensor_pair::update_envelopes(envelope_collection::reference& collection) {
     }
 }
 
+/**
+ * Rebuilds the envelopes for the current beams from the beam independent bins.
+ */
+bool sensor_pair::update_beams() {
+
+    envelope_collection::reference current = envelopes();
+    if ( current.get() == NULL || current->bins().get() == NULL ) {
+        return false;
+    }
+
+    #ifdef USML_DEBUG
+        cout << "sensor_pair: update_beams src_rcv ("
+            << current->source_id() << "_"
+            << current->receiver_id() <<  ")" << endl ;
+    #endif
+
+    source_params::reference src_params = _source->source();
+    receiver_params::reference rcv_params =
+        receiver_params_map::instance()->find(_receiver->paramsID());
+    beam_gain_table::reference src_gains = beam_gain_table::shared(
+        src_params->beam_list(), current->envelope_freq(), _source->orient() );
+    beam_gain_table::reference rcv_gains = beam_gain_table::shared(
+        rcv_params->beam_list(), current->envelope_freq(), _receiver->orient() );
+
+    envelope_collection::reference collection(
+        current->apply_beams( *src_gains, *rcv_gains ) );
+    update_envelopes( collection );
+    return true;
+}
+
 /**
  * Queries for the sensor pair complements of this sensor.
  */
@@ -41,7 +41,9 @@ public:
      * @param    receiver    Pointer to the receiver for this pair.
      */
     sensor_pair(sensor_model* source, sensor_model* receiver)
-        : _source(source), _receiver(receiver)
+        : _source(source), _receiver(receiver),
+          _src_stream_pending(false), _rcv_stream_pending(false),
+          _task_initial_time(0.0)
     {
         if ( _source->mode() == usml::sensors::BOTH ) {
             _frequencies = _source->frequencies()->clone();
@@ -57,6 +59,7 @@ public:
      */
     virtual ~sensor_pair() {
         delete _frequencies;
+        write_lock_guard guard(_envelopes_task_mutex);
         if ( _envelopes_task.get() != 0 ) {
             _envelopes_task->abort();
         }
@@ -104,12 +107,35 @@ public:
 
     /**
      * Notification that new eigenverb data is ready.
+     * Starts an envelope_generator for the new eigenverbs, unless they
+     * come from a stream that is already being read by a streaming
+     * envelope_generator. In that case, the streaming result is final,
+     * and the eigenverb pair search is not repeated.
      *
      * @param   initial_time    The time of arrival of the fastest eigenray for this pair.
      * @param   sensor          Pointer to sensor that issued the notification.
      */
     virtual void update_eigenverbs(double initial_time, sensor_model* sensor) ;
 
+    /**
+     * Notification that a sensor has started to stream eigenverbs.
+     * Once both sensors have streamed eigenverbs, and at least one of
+     * those streams is still open, a streaming envelope_generator is started
+     * to publish partial envelopes while the wavefronts are running,
+     * and the final envelopes when both streams are closed.
+     *
+     * The fastest eigenray is not known until the wavefront is complete,
+     * so the streaming envelopes use the initial time of the previous
+     * envelopes, or the direct path travel time at the sound speed of the
+     * source if there are no previous envelopes.  The partial and final
+     * results of a streaming envelope_generator use the same time axis.
+     *
+     * @param   sensor          Pointer to sensor that issued the notification.
+     * @param   stream          Stream of eigenverbs from this sensor.
+     */
+    virtual void start_eigenverbs(sensor_model* sensor,
+                                  eigenverb_stream::reference& stream) ;
+
     /**
      * Notification that new envelope data is ready.
      *
@@ -142,6 +168,18 @@ public:
          return _envelopes;
      }
 
+     /**
+      * Rebuilds the envelopes for the current beam lists and orientations
+      * of the source and receiver, without repeating the eigenverb pair
+      * search. Uses the beam independent bins stored in the last envelopes,
+      * which are only available if envelope_generator::beam_bins was set
+      * when they were computed. Called after an operator changes steering,
+      * or the beams in the source_params or receiver_params.
+      *
+      * @return  False if the last envelopes do not have bins.
+      */
+     bool update_beams();
+
      /**
       * Performs the dead reckoning on the fathometer at the new source and receiver positions
       * @param  src_pos wposition1 source data
@@ -171,6 +209,21 @@ private:
      */
     void run_envelope_generator(double initial_time);
 
+    /**
+     * Utility to run the envelope_generator in streaming mode.
+     *
+     * @param initial_time  Estimate of the start time offset for use to
+     *                      calculate the envelope data.
+     */
+    void run_stream_generator(double initial_time);
+
+    /**
+     * Estimate of the travel time of the fastest eigenray, for use
+     * before the wavefronts are complete. Uses the direct path range
+     * and the sound speed at the source.
+     */
+    double estimate_initial_time() const;
+
     /**
      * Utility to build the intersecting frequencies of a sensor_pair.
      */
@@ -246,6 +299,33 @@ private:
      */
     mutable read_write_lock _rcv_eigenverbs_mutex ;
 
+    /**
+     * Eigenverbs streamed from the last wavefront of the source.
+     */
+    eigenverb_stream::reference _src_stream;
+
+    /**
+     * Eigenverbs streamed from the last wavefront of the receiver.
+     */
+    eigenverb_stream::reference _rcv_stream;
+
+    /**
+     * Mutex to that locks sensor_pair during eigenverb stream updates.
+     */
+    mutable read_write_lock _streams_mutex ;
+
+    /**
+     * True if the source has streamed eigenverbs for a wavefront
+     * whose results have not yet been passed to update_eigenverbs().
+     */
+    bool _src_stream_pending ;
+
+    /**
+     * True if the receiver has streamed eigenverbs for a wavefront
+     * whose results have not yet been passed to update_eigenverbs().
+     */
+    bool _rcv_stream_pending ;
+
     /**
      * envelopes - contains the Reverb envelopes
      */
@@ -261,6 +341,29 @@ private:
      */
     thread_task::reference _envelopes_task;
 
+    /**
+     * Source stream read by the _envelopes_task,
+     * or NULL if it is not a streaming envelope_generator.
+     */
+    eigenverb_stream::reference _task_src_stream;
+
+    /**
+     * Receiver stream read by the _envelopes_task,
+     * or NULL if it is not a streaming envelope_generator.
+     */
+    eigenverb_stream::reference _task_rcv_stream;
+
+    /**
+     * Estimate of the initial time used by a streaming _envelopes_task.
+     * Compared to the actual initial time when the final eigenverbs arrive.
+     */
+    double _task_initial_time;
+
+    /**
+     * Mutex that locks sensor_pair while the _envelopes_task is replaced.
+     */
+    mutable read_write_lock _envelopes_task_mutex ;
+
 };
 
 /// @}
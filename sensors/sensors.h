@@ -33,6 +33,7 @@
 
 #include <usml/sensors/beam_pattern_model.h>
 #include <usml/sensors/beam_pattern_map.h>
+#include <usml/sensors/beam_gain_table.h>
 #include <usml/sensors/beam_pattern_model.h>
 
 #include <usml/sensors/receiver_params.h>
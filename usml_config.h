@@ -31,3 +31,11 @@
 #ifndef USML_DATA_DIR
 #define USML_DATA_DIR ""
 #endif
+
+/**
+ * Uncomment to store reverberation envelopes in single precision.
+ * Halves the memory used by each envelope_collection, at the expense of
+ * about seven significant digits of accuracy in the intensity.
+ * Must be the same for the library and all of the programs that use it.
+ */
+// #define USML_ENVELOPE_FLOAT
@@ -98,6 +98,23 @@ struct eigenray {
  */
 typedef std::list< eigenray > eigenray_list ;
 
+/**
+ * Acoustic path tagged with the row and column of its target.
+ * Used to deliver all of the eigenrays from a wavefront step
+ * to each listener as a single batch.
+ */
+struct target_eigenray {
+
+    /** Row identifier for the target involved in this collision. */
+    size_t target_row ;
+
+    /** Column identifier for the target involved in this collision. */
+    size_t target_col ;
+
+    /** Propagation loss information for this collision. */
+    eigenray ray ;
+};
+
 /// @}
 }  // end of namespace waveq3d
 }  // end of namespace usml
@@ -0,0 +1,108 @@
+/**
+ * @file eigenray_arena.cc
+ * Contiguous storage for the eigenrays associated with a grid of targets.
+ */
+#include <usml/waveq3d/eigenray_arena.h>
+#include <algorithm>
+
+using namespace usml::waveq3d ;
+
+const size_t eigenray_arena::npos = (size_t) -1 ;
+
+/**
+ * Create empty storage for a grid of targets.
+ */
+eigenray_arena::eigenray_arena( size_t rows, size_t cols, size_t num_freq ) :
+    _num_freq( num_freq ),
+    _head( rows, cols ),
+    _tail( rows, cols ),
+    _count( rows, cols )
+{
+    clear() ;
+}
+
+/**
+ * Pre-allocate storage for a known number of eigenrays.
+ */
+void eigenray_arena::reserve( size_t num_rays ) {
+    _records.reserve( num_rays ) ;
+    _intensity.reserve( num_rays * _num_freq ) ;
+    _phase.reserve( num_rays * _num_freq ) ;
+}
+
+/**
+ * Append an eigenray to the end of the list for a single target.
+ */
+void eigenray_arena::add( size_t t1, size_t t2, const eigenray& ray ) {
+    const size_t index = _records.size() ;
+
+    eigenray_record record ;
+    record.time = ray.time ;
+    record.source_de = ray.source_de ;
+    record.source_az = ray.source_az ;
+    record.target_de = ray.target_de ;
+    record.target_az = ray.target_az ;
+    record.surface = ray.surface ;
+    record.bottom = ray.bottom ;
+    record.caustic = ray.caustic ;
+    record.upper = ray.upper ;
+    record.lower = ray.lower ;
+    record.next = npos ;
+    _records.push_back( record ) ;
+
+    _intensity.insert( _intensity.end(),
+        ray.intensity.begin(), ray.intensity.begin() + _num_freq ) ;
+    _phase.insert( _phase.end(),
+        ray.phase.begin(), ray.phase.begin() + _num_freq ) ;
+
+    // link new record to the end of the chain for this target
+
+    if ( _head(t1,t2) == npos ) {
+        _head(t1,t2) = index ;
+    } else {
+        _records[ _tail(t1,t2) ].next = index ;
+    }
+    _tail(t1,t2) = index ;
+    ++_count(t1,t2) ;
+}
+
+/**
+ * Copy the eigenrays for a single target into a list.
+ */
+void eigenray_arena::copy( size_t t1, size_t t2,
+    const seq_vector* frequencies, eigenray_list* list ) const
+{
+    for ( const_iterator iter = begin(t1,t2) ; iter != end(t1,t2) ; ++iter ) {
+        list->push_back( eigenray() ) ;
+        eigenray& ray = list->back() ;
+        ray.time = iter->time ;
+        ray.frequencies = frequencies ;
+        ray.intensity.resize( _num_freq, false ) ;
+        ray.phase.resize( _num_freq, false ) ;
+        std::copy( iter.intensity(), iter.intensity() + _num_freq,
+                   ray.intensity.begin() ) ;
+        std::copy( iter.phase(), iter.phase() + _num_freq,
+                   ray.phase.begin() ) ;
+        ray.source_de = iter->source_de ;
+        ray.source_az = iter->source_az ;
+        ray.target_de = iter->target_de ;
+        ray.target_az = iter->target_az ;
+        ray.surface = iter->surface ;
+        ray.bottom = iter->bottom ;
+        ray.caustic = iter->caustic ;
+        ray.upper = iter->upper ;
+        ray.lower = iter->lower ;
+    }
+}
+
+/**
+ * Remove all eigenrays from the arena.
+ */
+void eigenray_arena::clear() {
+    _records.clear() ;
+    _intensity.clear() ;
+    _phase.clear() ;
+    std::fill( _head.data().begin(), _head.data().end(), npos ) ;
+    std::fill( _tail.data().begin(), _tail.data().end(), npos ) ;
+    std::fill( _count.data().begin(), _count.data().end(), 0 ) ;
+}
@@ -0,0 +1,280 @@
+/**
+ * @file eigenray_arena.h
+ * Contiguous storage for the eigenrays associated with a grid of targets.
+ */
+#pragma once
+
+#include <usml/waveq3d/eigenray.h>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace usml {
+namespace waveq3d {
+
+/// @ingroup waveq3d
+/// @{
+
+/**
+ * Frequency independent terms for a single eigenray stored in an
+ * eigenray_arena. Each record has a fixed size, so that the records
+ * for all targets can be stored in a single contiguous array.
+ * The frequency dependent intensity and phase are stored in
+ * separate contiguous buffers, indexed by the position of this
+ * record in the arena.
+ */
+struct eigenray_record {
+
+    /** Time of arrival for this acoustic path (sec). */
+    double time ;
+
+    /** Initial depression/elevation angle at the source (degrees). */
+    double source_de ;
+
+    /** Initial azimuthal angle at the source (degrees). */
+    double source_az ;
+
+    /** Final depression/elevation angle at the target (degrees). */
+    double target_de ;
+
+    /** Final azimuthal angle at the target (degrees). */
+    double target_az ;
+
+    /** Number of surface reflections encountered along this path. */
+    int surface ;
+
+    /** Number of bottom reflections encountered along this path. */
+    int bottom ;
+
+    /** Number of caustics encountered along this path. */
+    int caustic ;
+
+    /** Number of upper vertices encountered along this path. */
+    int upper ;
+
+    /** Number of lower vertices encountered along this path. */
+    int lower ;
+
+    /**
+     * Index of the next record for the same target.
+     * Set to eigenray_arena::npos at the end of the chain.
+     */
+    size_t next ;
+};
+
+/**
+ * Contiguous storage for the eigenrays associated with a grid of targets.
+ * Replaces a matrix of std::list<eigenray> objects, where each eigenray
+ * in the list owned two heap allocated uBLAS vectors. In this arena,
+ * the frequency independent terms are stored as fixed stride
+ * eigenray_record entries, and the intensity and phase for all
+ * eigenrays are stored in two buffers with a stride of num_frequencies().
+ * Adding a new eigenray only grows these three arrays, so large target
+ * grids no longer need millions of small allocations.
+ *
+ * The records for each target are chained together, in the order of
+ * arrival, using the index of the next record. The const_iterator class
+ * walks this chain for a single target, and copy() converts it back into
+ * an eigenray_list for the consumers that require one.
+ */
+class USML_DECLSPEC eigenray_arena {
+
+public:
+
+    /** Marks the end of the chain of records for a target. */
+    static const size_t npos ;
+
+    /**
+     * Iterates over the eigenrays for a single target.
+     * Dereferences to the frequency independent record, and provides
+     * pointers into the contiguous intensity and phase buffers.
+     */
+    class const_iterator {
+    public:
+
+        typedef std::forward_iterator_tag iterator_category ;
+        typedef eigenray_record value_type ;
+        typedef std::ptrdiff_t difference_type ;
+        typedef const eigenray_record* pointer ;
+        typedef const eigenray_record& reference ;
+
+        /** Construct an iterator at a specific record in the arena. */
+        const_iterator( const eigenray_arena* arena=NULL, size_t index=npos )
+            : _arena(arena), _index(index) {}
+
+        /** Frequency independent terms for the current eigenray. */
+        inline const eigenray_record& operator*() const {
+            return _arena->_records[_index] ;
+        }
+
+        /** Frequency independent terms for the current eigenray. */
+        inline const eigenray_record* operator->() const {
+            return &( _arena->_records[_index] ) ;
+        }
+
+        /** Advance to the next eigenray for this target. */
+        inline const_iterator& operator++() {
+            _index = _arena->_records[_index].next ;
+            return *this ;
+        }
+
+        /** Advance to the next eigenray for this target. */
+        inline const_iterator operator++(int) {
+            const_iterator prev( *this ) ;
+            ++(*this) ;
+            return prev ;
+        }
+
+        /** Iterators are equal if they point at the same record. */
+        inline bool operator==( const const_iterator& other ) const {
+            return _index == other._index ;
+        }
+
+        /** Iterators are equal if they point at the same record. */
+        inline bool operator!=( const const_iterator& other ) const {
+            return _index != other._index ;
+        }
+
+        /** Position of the current record in the arena. */
+        inline size_t index() const {
+            return _index ;
+        }
+
+        /** Propagation loss for each frequency (dB,positive). */
+        inline const double* intensity() const {
+            return _arena->intensity( _index ) ;
+        }
+
+        /** Phase change for each frequency (radians). */
+        inline const double* phase() const {
+            return _arena->phase( _index ) ;
+        }
+
+    private:
+
+        /** Arena that stores the eigenrays. */
+        const eigenray_arena* _arena ;
+
+        /** Position of the current record in the arena. */
+        size_t _index ;
+    };
+
+    /**
+     * Create empty storage for a grid of targets.
+     *
+     * @param   rows        Number of rows in the target grid.
+     * @param   cols        Number of columns in the target grid.
+     * @param   num_freq    Number of frequencies for each eigenray.
+     */
+    eigenray_arena( size_t rows, size_t cols, size_t num_freq ) ;
+
+    /** Number of rows in target grid. */
+    inline size_t size1() const {
+        return _head.size1() ;
+    }
+
+    /** Number of columns in target grid. */
+    inline size_t size2() const {
+        return _head.size2() ;
+    }
+
+    /** Number of frequencies stored for each eigenray. */
+    inline size_t num_frequencies() const {
+        return _num_freq ;
+    }
+
+    /** Total number of eigenrays for all targets. */
+    inline size_t size() const {
+        return _records.size() ;
+    }
+
+    /** Number of eigenrays for a single target. */
+    inline size_t size( size_t t1, size_t t2 ) const {
+        return _count(t1,t2) ;
+    }
+
+    /** Frequency independent terms for an eigenray in the arena. */
+    inline const eigenray_record& record( size_t index ) const {
+        return _records[index] ;
+    }
+
+    /** Propagation loss for an eigenray in the arena (dB,positive). */
+    inline const double* intensity( size_t index ) const {
+        return &( _intensity[index*_num_freq] ) ;
+    }
+
+    /** Phase change for an eigenray in the arena (radians). */
+    inline const double* phase( size_t index ) const {
+        return &( _phase[index*_num_freq] ) ;
+    }
+
+    /** First eigenray for a single target. */
+    inline const_iterator begin( size_t t1, size_t t2 ) const {
+        return const_iterator( this, _head(t1,t2) ) ;
+    }
+
+    /** End of the eigenrays for a single target. */
+    inline const_iterator end( size_t t1, size_t t2 ) const {
+        return const_iterator( this, npos ) ;
+    }
+
+    /**
+     * Pre-allocate storage for a known number of eigenrays.
+     *
+     * @param   num_rays    Expected total number of eigenrays.
+     */
+    void reserve( size_t num_rays ) ;
+
+    /**
+     * Append an eigenray to the end of the list for a single target.
+     * The intensity and phase of the eigenray must have
+     * num_frequencies() elements.
+     *
+     * @param   t1          Row number of the target.
+     * @param   t2          Column number of the target.
+     * @param   ray         Propagation loss information to store.
+     */
+    void add( size_t t1, size_t t2, const eigenray& ray ) ;
+
+    /**
+     * Copy the eigenrays for a single target into a list.
+     * Provides compatibility with consumers of eigenray_list.
+     *
+     * @param   t1          Row number of the target.
+     * @param   t2          Column number of the target.
+     * @param   frequencies Frequencies to assign to each eigenray.
+     * @param   list        List to append eigenrays to (output).
+     */
+    void copy( size_t t1, size_t t2, const seq_vector* frequencies,
+               eigenray_list* list ) const ;
+
+    /** Remove all eigenrays from the arena. */
+    void clear() ;
+
+private:
+
+    /** Number of frequencies stored for each eigenray. */
+    const size_t _num_freq ;
+
+    /** Frequency independent terms for all eigenrays. */
+    std::vector<eigenray_record> _records ;
+
+    /** Propagation loss for all eigenrays, with stride _num_freq. */
+    std::vector<double> _intensity ;
+
+    /** Phase change for all eigenrays, with stride _num_freq. */
+    std::vector<double> _phase ;
+
+    /** Index of the first record for each target. */
+    matrix<size_t> _head ;
+
+    /** Index of the last record for each target. */
+    matrix<size_t> _tail ;
+
+    /** Number of eigenrays for each target. */
+    matrix<size_t> _count ;
+};
+
+/// @}
+}  // end of namespace waveq3d
+}  // end of namespace usml
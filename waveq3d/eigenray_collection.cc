@@ -3,6 +3,9 @@
  * List of targets and their associated propagation data.
  */
 #include <usml/waveq3d/eigenray_collection.h>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
 #include <netcdfcpp.h>
 
 using namespace usml::waveq3d ;
@@ -20,14 +23,13 @@ eigenray_collection::eigenray_collection(
     double time_step,
     const wposition* targets
 	) :
-	_targets( targets ),
+	_targets( new wposition(*targets) ),
 	_frequencies(frequencies.clone()),
 	_source_pos(source_pos),
 	_source_de (source_de.clone()),
 	_source_az (source_az.clone()),
 	_time_step(time_step),
-	_eigenrays( size1(), size2() ),
-	_num_eigenrays(0),
+	_eigenrays( size1(), size2(), frequencies.size() ),
 	_loss( size1(), size2() )
 {
 	initialize();
@@ -50,179 +52,189 @@ void eigenray_collection::initialize()
     }
 }
 
+/**
+ * Maximum number of threads used by sum_eigenrays().
+ */
+size_t eigenray_collection::max_threads = 1 ;
+
 /**
  * Compute propagation loss summed over all eigenrays.
+ * Splits the targets into contiguous blocks, one per thread.
  */
 void eigenray_collection::sum_eigenrays( bool coherent ) {
+    const size_t num_targets = size1() * size2() ;
+    const size_t min_block = 64 ;   // smallest block worth a new thread
+
+    size_t num_threads = max_threads ;
+    if ( num_threads == 0 ) {
+        num_threads = std::max( 1u, boost::thread::hardware_concurrency() ) ;
+    }
+    num_threads = std::min( num_threads, num_targets / min_block ) ;
+
+    if ( num_threads <= 1 ) {
+        sum_targets( 0, num_targets, coherent ) ;
+        return ;
+    }
 
-	/// coherent signal summation
-
-    if( coherent ) {
-        for ( size_t t1=0 ; t1 < _targets->size1() ; ++t1 ) {
-            for ( size_t t2=0 ; t2 < _targets->size2() ; ++t2 ) {
-
-                double time = 0.0 ;
-                double source_de = 0.0 ;
-                double source_az_x = 0.0 ; // East/West component
-                double source_az_y = 0.0 ; // North/South component
-                double target_de = 0.0 ;
-                double target_az_x = 0.0 ; // East/West component
-                double target_az_y = 0.0 ; // North/South component
-                int surface = -1 ;
-                int bottom = -1 ;
-                int caustic = -1 ;
-                double wgt = 0.0 ;
-                double max_a = 0.0 ;
-
-                // compute at each frequency
-
-                const eigenray_list* entry = eigenrays(t1,t2) ;
-                eigenray* loss = &( _loss(t1,t2) ) ;
-
-                    for ( size_t f=0 ; f < _frequencies->size() ; ++f ) {
-
-                        // sum complex amplitudes over eigenrays
-
-                        std::complex<double> phasor( 0.0, 0.0 ) ;
-
-                        for ( eigenray_list::const_iterator iter = entry->begin() ;
-                              iter != entry->end() ; ++iter )
-                        {
-                            const eigenray& ray = *iter ;
-
-                            // complex pressure
-
-                            double a = pow( 10.0, ray.intensity(f) / -20.0 ) ;                // pressure
-                            double p = TWO_PI * (*_frequencies)(f) * ray.time + ray.phase(f) ;
-                            p = fmod( p, TWO_PI ) ; // large phases bad for cos,sin
-                            std::complex<double> value( a * cos(p), a * sin(p) ) ;
-                            phasor += value ;
-
-                            // other eigenray terms
-
-                            a *= a ;          // scale by the pressure squared
-                            wgt += a ;
-                            time += a * ray.time ;
-                            source_de += a * ray.source_de ;
-                            source_az_x += a * sin(to_radians(ray.source_az)) ;
-                            source_az_y += a * cos(to_radians(ray.source_az)) ;
-                            target_de += a * ray.target_de ;
-                            target_az_x += a * sin(to_radians(ray.target_az)) ;
-                            target_az_y += a * cos(to_radians(ray.target_az)) ;
-                            if ( a > max_a ) {
-                                max_a = a ;
-                                surface = ray.surface ;
-                                bottom = ray.bottom ;
-                                caustic = ray.caustic ;
-                            }
-                        } // end eigenray_list
-
-                        // convert back into intensity (dB) and phase (radians) values
-
-                        loss->intensity(f) = -20.0*log10( max(1e-15,abs(phasor)) ) ;
-                        loss->phase(f) = arg(phasor) ;
-                    } // end frequency
-
-                // weighted average of other eigenray terms
-
-                loss->time = time / wgt ;
-                loss->source_de = source_de / wgt ;
-                loss->source_az = 90.0 - to_degrees(atan2(source_az_y, source_az_x)) ;
-                loss->target_de = target_de / wgt ;
-                loss->target_az = 90.0 - to_degrees(atan2(target_az_y, target_az_x)) ;
-                loss->surface = surface ;
-                loss->bottom = bottom ;
-                loss->caustic = caustic ;
-            } // end target size2
-        } // end target size1
-
-    /// incoherent signal summation
-
-    } else {
-        for ( size_t t1=0 ; t1 < _targets->size1() ; ++t1 ) {
-            for ( size_t t2=0 ; t2 < _targets->size2() ; ++t2 ) {
-
-                double time = 0.0 ;
-                double source_de = 0.0 ;
-                double source_az_x = 0.0 ; // East/West component
-                double source_az_y = 0.0 ; // North/South component
-                double target_de = 0.0 ;
-                double target_az_x = 0.0 ; // East/West component
-                double target_az_y = 0.0 ; // North/South component
-                int surface = -1 ;
-                int bottom = -1 ;
-                int caustic = -1 ;
-                double wgt = 0.0 ;
-                double max_a = 0.0 ;
-
-                // compute at each frequency
-
-                const eigenray_list* entry = eigenrays(t1,t2) ;
-                eigenray* loss = &( _loss(t1,t2) ) ;
-
-                    for ( size_t f=0 ; f < _frequencies->size() ; ++f ) {
-
-                        // sum complex amplitudes over eigenrays
-
-                        double phasor = 0.0 ;
-
-                        for ( eigenray_list::const_iterator iter = entry->begin() ;
-                              iter != entry->end() ; ++iter )
-                        {
-                            const eigenray& ray = *iter ;
-
-                            // complex pressure
-
-                            const double a = pow( 10.0, ray.intensity(f) / -10.0 ) ; // pressure squared
-                            phasor += a ;
-
-                            // other eigenray terms
-
-                            wgt += a ;
-                            time += a * ray.time ;
-                            source_de += a * ray.source_de ;
-                            source_az_x += a * sin(to_radians(ray.source_az)) ;
-                            source_az_y += a * cos(to_radians(ray.source_az)) ;
-                            target_de += a * ray.target_de ;
-                            target_az_x += a * sin(to_radians(ray.target_az)) ;
-                            target_az_y += a * cos(to_radians(ray.target_az)) ;
-                            if ( a > max_a ) {
-                                max_a = a ;
-                                surface = ray.surface ;
-                                bottom = ray.bottom ;
-                                caustic = ray.caustic ;
-                            }
-                        } // end eigenray_list
-
-                        // convert back into intensity (dB) and phase (radians) values
-
-                        loss->intensity(f) = -20.0*log10( max(1e-15,sqrt(phasor)) ) ;
-                        loss->phase(f) = 0.0 ;
-                    } // end frequency
-
-                // weighted average of other eigenray terms
-
-                loss->time = time / wgt ;
-                loss->source_de = source_de / wgt ;
-                loss->source_az = 90.0 - to_degrees(atan2(source_az_y, source_az_x)) ;
-                loss->target_de = target_de / wgt ;
-                loss->target_az = 90.0 - to_degrees(atan2(target_az_y, target_az_x)) ;
-                loss->surface = surface ;
-                loss->bottom = bottom ;
-                loss->caustic = caustic ;
-            } // end targets size2
-        } // end targets size1
-    } // end coherent/incoherent
+    const size_t block = ( num_targets + num_threads - 1 ) / num_threads ;
+    boost::thread_group workers ;
+    for ( size_t first=block ; first < num_targets ; first += block ) {
+        workers.create_thread( boost::bind(
+            &eigenray_collection::sum_targets, this,
+            first, std::min( first+block, num_targets ), coherent ) ) ;
+    }
+    sum_targets( 0, block, coherent ) ;
+    workers.join_all() ;
+}
+
+/**
+ * Compute propagation loss for a block of targets.
+ */
+void eigenray_collection::sum_targets( size_t first, size_t last, bool coherent ) {
+    const size_t num_freq = _frequencies->size() ;
+    const double scale = ( coherent ? -0.05 : -0.1 ) * log(10.0) ;
+
+    // per-thread workspace, reused for every target
+
+    std::vector<double> omega( num_freq ) ;
+    std::vector<double> amp( num_freq ) ;
+    std::vector<double> real( num_freq ) ;
+    std::vector<double> imag( num_freq ) ;
+    for ( size_t f=0 ; f < num_freq ; ++f ) {
+        omega[f] = TWO_PI * (*_frequencies)(f) ;
+    }
+
+    for ( size_t n=first ; n < last ; ++n ) {
+        const size_t t1 = n / size2() ;
+        const size_t t2 = n % size2() ;
+
+        double time = 0.0 ;
+        double source_de = 0.0 ;
+        double source_az_x = 0.0 ; // East/West component
+        double source_az_y = 0.0 ; // North/South component
+        double target_de = 0.0 ;
+        double target_az_x = 0.0 ; // East/West component
+        double target_az_y = 0.0 ; // North/South component
+        int surface = -1 ;
+        int bottom = -1 ;
+        int caustic = -1 ;
+        double wgt = 0.0 ;
+        double max_a = 0.0 ;
+        std::fill( real.begin(), real.end(), 0.0 ) ;
+        std::fill( imag.begin(), imag.end(), 0.0 ) ;
+
+        for ( eigenray_arena::const_iterator iter = _eigenrays.begin(t1,t2) ;
+              iter != _eigenrays.end(t1,t2) ; ++iter )
+        {
+            const eigenray_record& ray = *iter ;
+            const double* intensity = iter.intensity() ;
+            const double* phase = iter.phase() ;
+
+            // linear pressure (coherent) or pressure squared (incoherent)
+
+            for ( size_t f=0 ; f < num_freq ; ++f ) {
+                amp[f] = exp( scale * intensity[f] ) ;
+            }
+
+            // sum amplitudes across frequency
+
+            double ray_wgt = 0.0 ;
+            double ray_max = 0.0 ;
+            if ( coherent ) {
+                for ( size_t f=0 ; f < num_freq ; ++f ) {
+                    double p = omega[f] * ray.time + phase[f] ;
+                    p = fmod( p, TWO_PI ) ; // large phases bad for cos,sin
+                    real[f] += amp[f] * cos(p) ;
+                    imag[f] += amp[f] * sin(p) ;
+                    const double a2 = amp[f] * amp[f] ;
+                    ray_wgt += a2 ;
+                    ray_max = std::max( ray_max, a2 ) ;
+                }
+            } else {
+                for ( size_t f=0 ; f < num_freq ; ++f ) {
+                    real[f] += amp[f] ;
+                    ray_wgt += amp[f] ;
+                    ray_max = std::max( ray_max, amp[f] ) ;
+                }
+            }
+
+            // frequency independent terms, weighted by the sum of the
+            // pressure squared across all frequencies
+
+            wgt += ray_wgt ;
+            time += ray_wgt * ray.time ;
+            source_de += ray_wgt * ray.source_de ;
+            source_az_x += ray_wgt * sin(to_radians(ray.source_az)) ;
+            source_az_y += ray_wgt * cos(to_radians(ray.source_az)) ;
+            target_de += ray_wgt * ray.target_de ;
+            target_az_x += ray_wgt * sin(to_radians(ray.target_az)) ;
+            target_az_y += ray_wgt * cos(to_radians(ray.target_az)) ;
+            if ( ray_max > max_a ) {
+                max_a = ray_max ;
+                surface = ray.surface ;
+                bottom = ray.bottom ;
+                caustic = ray.caustic ;
+            }
+        }
+
+        // convert back into intensity (dB) and phase (radians) values
+
+        eigenray* loss = &( _loss(t1,t2) ) ;
+        for ( size_t f=0 ; f < num_freq ; ++f ) {
+            if ( coherent ) {
+                const std::complex<double> phasor( real[f], imag[f] ) ;
+                loss->intensity(f) = -20.0*log10( max(1e-15,abs(phasor)) ) ;
+                loss->phase(f) = arg(phasor) ;
+            } else {
+                loss->intensity(f) = -20.0*log10( max(1e-15,sqrt(real[f])) ) ;
+                loss->phase(f) = 0.0 ;
+            }
+        }
+
+        // weighted average of other eigenray terms
+
+        loss->time = time / wgt ;
+        loss->source_de = source_de / wgt ;
+        loss->source_az = 90.0 - to_degrees(atan2(source_az_y, source_az_x)) ;
+        loss->target_de = target_de / wgt ;
+        loss->target_az = 90.0 - to_degrees(atan2(target_az_y, target_az_x)) ;
+        loss->surface = surface ;
+        loss->bottom = bottom ;
+        loss->caustic = caustic ;
+    }
+}
+
+/**
+ * Return eigenray list for a single target, copied out of the arena.
+ */
+eigenray_list* eigenray_collection::eigenrays( size_t t1, size_t t2 ) {
+	boost::lock_guard<boost::mutex> guard( _lists_mutex ) ;
+	eigenray_list& list = _lists[ t1 * size2() + t2 ] ;
+	if ( list.size() != _eigenrays.size(t1,t2) ) {
+		list.clear() ;
+		_eigenrays.copy( t1, t2, _frequencies, &list ) ;
+	}
+	return &list ;
 }
 
 /**
  * Add eigenray via eigenray_listener
  */
 void eigenray_collection::add_eigenray(
-		size_t target_row, size_t target_col, eigenray ray, size_t runID )
+		size_t target_row, size_t target_col, const eigenray& ray, size_t runID )
 {
-	 _eigenrays(target_row, target_col).push_back( ray ) ;
-	 ++_num_eigenrays ;
+	 _eigenrays.add( target_row, target_col, ray ) ;
+}
+
+/**
+ * Add all of the eigenrays from a wavefront step.
+ */
+void eigenray_collection::add_eigenrays(
+		const target_eigenray* rays, size_t count, long wave_time, size_t runID )
+{
+	for ( size_t n=0 ; n < count ; ++n ) {
+		_eigenrays.add( rays[n].target_row, rays[n].target_col, rays[n].ray ) ;
+	}
 }
 
 /**
@@ -242,7 +254,7 @@ void eigenray_collection::write_netcdf( const char* filename, const char* long_n
 	NcDim *row_dim = nc_file->add_dim("rows", (long) _targets->size1());
 	NcDim *col_dim = nc_file->add_dim("cols", (long) _targets->size2());
     NcDim *eigenray_dim = nc_file->add_dim("eigenrays",
-           (long) ( _num_eigenrays + _loss.size1() * _loss.size2()) ) ;
+           (long) ( _eigenrays.size() + _loss.size1() * _loss.size2()) ) ;
 	NcDim *launch_de_dim = nc_file->add_dim("launch_de", (long) _source_de->size());
 	NcDim *launch_az_dim = nc_file->add_dim("launch_az", (long) _source_az->size());
 
@@ -348,7 +360,7 @@ void eigenray_collection::write_netcdf( const char* filename, const char* long_n
     int record = 0; // current record number
     for (long t1 = 0; t1 < (long) _targets->size1(); ++t1) {
         for (long t2 = 0; t2 < (long) _targets->size2(); ++t2) {
-            int num = (long) _eigenrays(t1, t2).size();
+            int num = (long) _eigenrays.size(t1, t2);
             proploss_index_var->set_cur(t1, t2);
             eigenray_index_var->set_cur(t1, t2);
             eigenray_num_var->set_cur(t1, t2);
@@ -358,7 +370,7 @@ void eigenray_collection::write_netcdf( const char* filename, const char* long_n
             eigenray_index_var->put(&next_rec, 1, 1); // followed by list of rays
             eigenray_num_var->put(&num, 1, 1);
 
-            eigenray_list::const_iterator iter = _eigenrays(t1, t2).begin();
+            eigenray_arena::const_iterator iter = _eigenrays.begin(t1, t2);
 
             for (int n = -1; n < num; ++n) {
 
@@ -396,10 +408,10 @@ void eigenray_collection::write_netcdf( const char* filename, const char* long_n
                 // case 2 : write individual eigenray
 
                 } else {
-                    const eigenray& loss = *iter++;
-                    intensity_var->put(loss.intensity.data().begin(),
+                    const eigenray_record& loss = *iter;
+                    intensity_var->put(iter.intensity(),
                             1, (long) _frequencies->size());
-                    phase_var->put(loss.phase.data().begin(),
+                    phase_var->put(iter.phase(),
                             1, (long) _frequencies->size());
                     time_var->put(&loss.time, 1);
                     source_de_var->put(&loss.source_de, 1);
@@ -409,6 +421,7 @@ void eigenray_collection::write_netcdf( const char* filename, const char* long_n
                     surface_var->put(&loss.surface, 1);
                     bottom_var->put(&loss.bottom, 1);
                     caustic_var->put(&loss.caustic, 1);
+                    ++iter;
 
                 } // if sum or individual
             }   // loop over # of eigenrays
@@ -6,7 +6,10 @@
 
 #include <usml/ocean/ocean.h>
 #include <usml/waveq3d/eigenray_listener.h>
+#include <usml/waveq3d/eigenray_arena.h>
 #include <usml/waveq3d/wave_queue.h>
+#include <boost/thread/mutex.hpp>
+#include <map>
 
 namespace usml {
 namespace waveq3d {
@@ -34,6 +37,8 @@ private:
 
     /**
      * Matrix of target positions in world coordinates.
+     * Copied from the caller so that the collection can outlive
+     * the wavefront_generator that created it.
      */
     const wposition* _targets;
 
@@ -72,12 +77,22 @@ private:
     double _time_step;
 
     /**
-     * List of eigenrays associated with each target.
+     * Eigenrays associated with each target.  Stored in contiguous
+     * memory to avoid an allocation for every new eigenray.
      */
-    matrix< eigenray_list > _eigenrays;
+    eigenray_arena _eigenrays;
 
-    /** Total number of eigenrays.  Used by write_netcdf(). */
-    int _num_eigenrays;
+    /**
+     * Copies of the eigenray lists returned by the two argument form of
+     * eigenrays(), indexed by t1 * size2() + t2.  Only created for
+     * the targets that are requested.
+     */
+    std::map< size_t, eigenray_list > _lists;
+
+    /**
+     * Mutex that locks _lists while a copy is created or refreshed.
+     */
+    boost::mutex _lists_mutex;
 
     /**
      * Propagation loss summed over all eigenrays.
@@ -120,6 +135,7 @@ public:
       */
     virtual ~eigenray_collection(){
 
+        delete _targets;
         delete _frequencies;
         delete _source_de;
         delete _source_az;
@@ -133,6 +149,21 @@ private:
      */
     void initialize();
 
+    /**
+     * Compute propagation loss for a block of targets. Targets are
+     * numbered in row major order.  The coherent and incoherent sums
+     * share this kernel. The frequency independent terms, such as
+     * the azimuth components and the averaging weight, are computed
+     * once per eigenray. The amplitude and phasor terms are
+     * accumulated into contiguous per-frequency buffers.
+     *
+     * @param   first       Index of the first target in the block.
+     * @param   last        One past the index of the last target.
+     * @param   coherent    Compute coherent propagation loss if true,
+     *                      and incoherent if false.
+     */
+    void sum_targets(size_t first, size_t last, bool coherent);
+
 public:
 
     /**
@@ -170,16 +201,52 @@ public:
         return _frequencies;
     }
 
+    /**
+     * Contiguous storage for the eigenrays of all targets.
+     * Allows consumers to iterate over the eigenrays for
+     * each target without copying them.
+     */
+    inline const eigenray_arena& arena() const {
+        return _eigenrays;
+    }
+
+    /**
+     * Number of eigenrays for a single target.
+     *
+     * @param   t1          Row number of the current target.
+     * @param   t2          Column number of the current target.
+     * @return              Number of eigenrays for this target.
+     */
+    inline size_t num_eigenrays(size_t t1, size_t t2) const {
+        return _eigenrays.size(t1, t2);
+    }
+
+    /**
+     * Copy the eigenray list for a single target. Used by consumers
+     * that need to retain their own copy of the eigenrays.
+     *
+     * @param   t1          Row number of the current target.
+     * @param   t2          Column number of the current target.
+     * @param   list        List to append eigenrays to (output).
+     */
+    inline void eigenrays(size_t t1, size_t t2, eigenray_list* list) const {
+        _eigenrays.copy(t1, t2, _frequencies, list);
+    }
+
     /**
      * Return eigenray list for a single target.
+     * Kept for code written before the eigenrays were stored in an
+     * eigenray_arena.  The list is copied out of the arena on the first
+     * call for each target, and refreshed on later calls if eigenrays
+     * have been added since then.  The pointer remains valid for the life
+     * of this collection.  New code should use arena() or the three
+     * argument form of eigenrays(), which do not keep a second copy.
      *
      * @param   t1              Row number of the current target.
      * @param   t2              Column number of the current target.
      * @return  eigenray_list   Pointer to eigenray_list for single target.
      */
-    inline eigenray_list* eigenrays(size_t t1, size_t t2) {
-        return &(_eigenrays(t1, t2));
-    }
+    eigenray_list* eigenrays(size_t t1, size_t t2) ;
 
     /**
      * Propagation loss for a single target summed over eigenrays.
@@ -203,16 +270,40 @@ public:
      * @param     runID        Identification number of the wavefront that
      *                         produced this result.  Ignored in this implementation.
      */
-    void add_eigenray(size_t target_row, size_t target_col, eigenray ray, size_t runID) ;
+    void add_eigenray(size_t target_row, size_t target_col, const eigenray& ray, size_t runID) ;
+
+    /**
+     * Appends all of the eigenrays from a wavefront step to the arena.
+     * Avoids a virtual call for each eigenray.
+     *
+     * @param   rays        Array of eigenrays for this step.
+     * @param   count       Number of eigenrays in the array.
+     * @param   wave_time   Elapsed time for this wavefront step. Ignored.
+     * @param   runID       Identification number of the wavefront that
+     *                      produced this result.  Ignored.
+     */
+    void add_eigenrays(const target_eigenray* rays, size_t count, long wave_time, size_t runID) ;
 
     /**
      * Compute propagation loss summed over all eigenrays.
+     * Targets are divided into contiguous blocks that are summed
+     * in parallel, up to max_threads at a time.
      *
      * @param   coherent    Compute coherent propagation loss if true,
      *                      and incoherent if false.
      */
     void sum_eigenrays(bool coherent = true);
 
+    /**
+     * Maximum number of threads used by sum_eigenrays().
+     * Each wavefront_generator already runs as a task in the
+     * thread_controller's pool, so extra threads in every task would
+     * oversubscribe the machine when several sensors are updated at once.
+     * Defaults to 1, which sums all targets in the calling thread.
+     * Set to zero to use the hardware concurrency of this machine.
+     */
+    static size_t max_threads;
+
     /**
      * Write eigenray_collection scenario data to a netCDF file using a ragged
      * array structure. This ragged array concept (see reference) stores
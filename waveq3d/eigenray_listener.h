@@ -41,7 +41,7 @@ public:
      * @see        wave_queue.runID()
      */
     virtual void add_eigenray(
-        size_t target_row, size_t target_col, eigenray ray, size_t runID) = 0;
+        size_t target_row, size_t target_col, const eigenray& ray, size_t runID) = 0;
 
     /**
      * Notifies the observer that eigenray processing is complete for
@@ -55,6 +55,32 @@ public:
      */
     virtual void check_eigenrays(long wave_time, size_t runID) {}
 
+    /**
+     * Notifies the observer of all the eigenrays produced by a
+     * wavefront time step, and that eigenray processing for this step
+     * is complete. The eigenrays are owned by the wave_queue and are only
+     * valid for the duration of this call.  The default implementation
+     * forwards each eigenray to add_eigenray(), and then calls
+     * check_eigenrays(). Sub-classes may override it to process
+     * the whole step in bulk.
+     *
+     * @param   rays           Array of eigenrays for this step.
+     * @param   count          Number of eigenrays in the array.
+     * @param   wave_time      Elapsed time for this wavefront step.
+     * @param   runID          Identification number of the wavefront that
+     *                         produced this result.
+     * @see        wave_queue.runID()
+     */
+    virtual void add_eigenrays(
+        const target_eigenray* rays, size_t count, long wave_time, size_t runID)
+    {
+        for ( size_t n=0 ; n < count ; ++n ) {
+            add_eigenray( rays[n].target_row, rays[n].target_col,
+                          rays[n].ray, runID ) ;
+        }
+        check_eigenrays( wave_time, runID ) ;
+    }
+
 protected:
 
     /**
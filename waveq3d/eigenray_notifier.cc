@@ -25,13 +25,24 @@ void eigenray_notifier::remove_eigenray_listener(eigenray_listener* listener) {
  * Distribute an eigenray updates to all listeners.
  */
 void eigenray_notifier::notify_eigenray_listeners(
-		size_t target_row, size_t target_col, eigenray ray, size_t runID)
+		size_t target_row, size_t target_col, const eigenray& ray, size_t runID)
 {
 	BOOST_FOREACH( eigenray_listener* listener, _listeners ){
 		listener->add_eigenray(target_row, target_col, ray, runID);
 	}
 }
 
+/**
+ * Distribute all of the eigenrays for a time step to all listeners.
+ */
+void eigenray_notifier::notify_eigenray_listeners(
+		const target_eigenray* rays, size_t count, long wave_time, size_t runID)
+{
+	BOOST_FOREACH( eigenray_listener* listener, _listeners ){
+		listener->add_eigenrays(rays, count, wave_time, runID);
+	}
+}
+
 /**
  * For each eigenray_listener in the eigenray_listeners set
  * call the check_eigenrays method to deliver all eigenrays after
@@ -42,7 +42,7 @@ public:
      * @see        wave_queue.runID()
      */
     void notify_eigenray_listeners(
-            size_t target_row, size_t target_col, eigenray ray, size_t runID );
+            size_t target_row, size_t target_col, const eigenray& ray, size_t runID );
 
     /**
      * Notifies all of the listeners that eigenray processing is complete for
@@ -56,6 +56,21 @@ public:
      */
     void check_eigenray_listeners( long wave_time, size_t runID );
 
+    /**
+     * Notifies all of the listeners of the eigenrays produced by a
+     * wavefront time step, and that processing for this step is complete.
+     * Makes a single call to each listener, without copying the eigenrays.
+     *
+     * @param   rays           Array of eigenrays for this step.
+     * @param   count          Number of eigenrays in the array.
+     * @param   wave_time      Elapsed time for this wavefront step.
+     * @param   runID          Identification number of the wavefront that
+     *                         produced this result.
+     * @see        wave_queue.runID()
+     */
+    void notify_eigenray_listeners(
+            const target_eigenray* rays, size_t count, long wave_time, size_t runID );
+
     /**
      * Determines if any listeners exist
      * @return true when listeners exist, false otherwise.
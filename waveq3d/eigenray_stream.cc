@@ -0,0 +1,400 @@
+/**
+ * @file eigenray_stream.cc
+ * Streams eigenrays for large target grids to disk as they are found.
+ */
+#include <usml/waveq3d/eigenray_stream.h>
+#include <algorithm>
+#include <complex>
+#include <cstring>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <netcdfcpp.h>
+
+using namespace usml::waveq3d ;
+
+/**
+ * Open the scratch file and initialize the running sums for each target.
+ */
+eigenray_stream::eigenray_stream(
+    const seq_vector& frequencies, const wposition* targets,
+    const char* filename, size_t chunk_size
+) :
+    _targets( targets ),
+    _frequencies( frequencies.clone() ),
+    _num_freq( frequencies.size() ),
+    _omega( frequencies.size() ),
+    _filename( filename ),
+    _chunk_size( std::max( chunk_size, (size_t) 1 ) ),
+    _stride( sizeof(eigenray_record) + 2 * frequencies.size() * sizeof(double) ),
+    _num_records( 0 ),
+    _num_flushed( 0 ),
+    _tail( targets->size1() * targets->size2(), eigenray_arena::npos ),
+    _count( targets->size1() * targets->size2(), 0 ),
+    _sums( targets->size1() * targets->size2() ),
+    _real( targets->size1() * targets->size2() * frequencies.size(), 0.0 ),
+    _imag( targets->size1() * targets->size2() * frequencies.size(), 0.0 ),
+    _power( targets->size1() * targets->size2() * frequencies.size(), 0.0 )
+{
+    _file.open( filename, std::ios::in | std::ios::out
+                        | std::ios::binary | std::ios::trunc ) ;
+    if ( ! _file ) {
+        delete _frequencies ;
+        throw std::invalid_argument("can not open eigenray stream") ;
+    }
+    _chunk.reserve( _chunk_size * _stride ) ;
+
+    for ( size_t f=0 ; f < _num_freq ; ++f ) {
+        _omega[f] = TWO_PI * frequencies(f) ;
+    }
+    for ( size_t n=0 ; n < _sums.size() ; ++n ) {
+        running_sum& sum = _sums[n] ;
+        sum.wgt = sum.time = 0.0 ;
+        sum.source_de = sum.source_az_x = sum.source_az_y = 0.0 ;
+        sum.target_de = sum.target_az_x = sum.target_az_y = 0.0 ;
+        sum.max_a = 0.0 ;
+        sum.surface = sum.bottom = sum.caustic = -1 ;
+    }
+}
+
+/**
+ * Close the scratch file.  Write errors can not be reported from
+ * a destructor, so they are ignored here.
+ */
+eigenray_stream::~eigenray_stream() {
+    try {
+        flush() ;
+    } catch ( const std::runtime_error& ) {
+    }
+    _file.close() ;
+    delete _frequencies ;
+}
+
+/**
+ * Append a new eigenray to the stream.
+ */
+void eigenray_stream::add_eigenray(
+    size_t target_row, size_t target_col, const eigenray& ray, size_t runID )
+{
+    const size_t target = target_row * size2() + target_col ;
+
+    // build fixed stride record, linked to previous record for this target
+
+    eigenray_record record ;
+    record.time = ray.time ;
+    record.source_de = ray.source_de ;
+    record.source_az = ray.source_az ;
+    record.target_de = ray.target_de ;
+    record.target_az = ray.target_az ;
+    record.surface = ray.surface ;
+    record.bottom = ray.bottom ;
+    record.caustic = ray.caustic ;
+    record.upper = ray.upper ;
+    record.lower = ray.lower ;
+    record.next = _tail[target] ;
+
+    const size_t offset = _chunk.size() ;
+    _chunk.resize( offset + _stride ) ;
+    char* ptr = &_chunk[offset] ;
+    std::memcpy( ptr, &record, sizeof(eigenray_record) ) ;
+    ptr += sizeof(eigenray_record) ;
+    std::memcpy( ptr, &ray.intensity(0), _num_freq * sizeof(double) ) ;
+    ptr += _num_freq * sizeof(double) ;
+    std::memcpy( ptr, &ray.phase(0), _num_freq * sizeof(double) ) ;
+
+    _tail[target] = _num_records++ ;
+    ++_count[target] ;
+    accumulate( target, ray ) ;
+
+    if ( _chunk.size() >= _chunk_size * _stride ) flush() ;
+}
+
+/**
+ * Append all of the eigenrays from a wavefront step to the stream.
+ */
+void eigenray_stream::add_eigenrays(
+    const target_eigenray* rays, size_t count, long wave_time, size_t runID )
+{
+    for ( size_t n=0 ; n < count ; ++n ) {
+        add_eigenray( rays[n].target_row, rays[n].target_col,
+                      rays[n].ray, runID ) ;
+    }
+}
+
+/**
+ * Write any buffered records to the scratch file.
+ */
+void eigenray_stream::flush() {
+    if ( _chunk.empty() ) return ;
+    _file.seekp( (std::streamoff) ( _num_flushed * _stride ) ) ;
+    _file.write( &_chunk[0], (std::streamsize) _chunk.size() ) ;
+    _file.flush() ;
+    if ( ! _file ) {
+        throw std::runtime_error("can not write to eigenray stream") ;
+    }
+    _num_flushed += _chunk.size() / _stride ;
+    _chunk.clear() ;
+}
+
+/**
+ * Add an eigenray to the running sums for its target.
+ */
+void eigenray_stream::accumulate( size_t target, const eigenray& ray ) {
+    double* real = &_real[target*_num_freq] ;
+    double* imag = &_imag[target*_num_freq] ;
+    double* power = &_power[target*_num_freq] ;
+
+    double ray_wgt = 0.0 ;
+    double ray_max = 0.0 ;
+    for ( size_t f=0 ; f < _num_freq ; ++f ) {
+        const double a2 = pow( 10.0, ray.intensity(f) / -10.0 ) ; // pressure squared
+        const double a = sqrt( a2 ) ;
+        double p = _omega[f] * ray.time + ray.phase(f) ;
+        p = fmod( p, TWO_PI ) ; // large phases bad for cos,sin
+        real[f] += a * cos(p) ;
+        imag[f] += a * sin(p) ;
+        power[f] += a2 ;
+        ray_wgt += a2 ;
+        ray_max = std::max( ray_max, a2 ) ;
+    }
+
+    running_sum& sum = _sums[target] ;
+    sum.wgt += ray_wgt ;
+    sum.time += ray_wgt * ray.time ;
+    sum.source_de += ray_wgt * ray.source_de ;
+    sum.source_az_x += ray_wgt * sin(to_radians(ray.source_az)) ;
+    sum.source_az_y += ray_wgt * cos(to_radians(ray.source_az)) ;
+    sum.target_de += ray_wgt * ray.target_de ;
+    sum.target_az_x += ray_wgt * sin(to_radians(ray.target_az)) ;
+    sum.target_az_y += ray_wgt * cos(to_radians(ray.target_az)) ;
+    if ( ray_max > sum.max_a ) {
+        sum.max_a = ray_max ;
+        sum.surface = ray.surface ;
+        sum.bottom = ray.bottom ;
+        sum.caustic = ray.caustic ;
+    }
+}
+
+/**
+ * Convert the running sums into propagation loss for a single target.
+ */
+void eigenray_stream::total(
+    size_t t1, size_t t2, eigenray* loss, bool coherent ) const
+{
+    const size_t target = t1 * size2() + t2 ;
+    const running_sum& sum = _sums[target] ;
+    loss->frequencies = _frequencies ;
+    if ( loss->intensity.size() != _num_freq ) {
+        loss->intensity.resize( _num_freq, false ) ;
+        loss->phase.resize( _num_freq, false ) ;
+    }
+
+    // convert back into intensity (dB) and phase (radians) values
+
+    for ( size_t f=0 ; f < _num_freq ; ++f ) {
+        const size_t n = target * _num_freq + f ;
+        if ( coherent ) {
+            const std::complex<double> phasor( _real[n], _imag[n] ) ;
+            loss->intensity(f) = -20.0*log10( max(1e-15,abs(phasor)) ) ;
+            loss->phase(f) = arg(phasor) ;
+        } else {
+            loss->intensity(f) = -20.0*log10( max(1e-15,sqrt(_power[n])) ) ;
+            loss->phase(f) = 0.0 ;
+        }
+    }
+
+    // weighted average of other eigenray terms
+
+    loss->time = sum.time / sum.wgt ;
+    loss->source_de = sum.source_de / sum.wgt ;
+    loss->source_az = 90.0 - to_degrees(atan2(sum.source_az_y, sum.source_az_x)) ;
+    loss->target_de = sum.target_de / sum.wgt ;
+    loss->target_az = 90.0 - to_degrees(atan2(sum.target_az_y, sum.target_az_x)) ;
+    loss->surface = sum.surface ;
+    loss->bottom = sum.bottom ;
+    loss->caustic = sum.caustic ;
+}
+
+/**
+ * Read the eigenrays for a single target back from the scratch file.
+ */
+void eigenray_stream::eigenrays( size_t t1, size_t t2, eigenray_list* list ) {
+    flush() ;
+    std::vector<char> buffer( _stride ) ;
+    eigenray_list::iterator first = list->end() ;
+    size_t index = _tail[t1*size2()+t2] ;
+    while ( index != eigenray_arena::npos ) {
+        _file.seekg( (std::streamoff) ( index * _stride ) ) ;
+        _file.read( &buffer[0], (std::streamsize) _stride ) ;
+        if ( ! _file || _file.gcount() != (std::streamsize) _stride ) {
+            _file.clear() ;
+            throw std::runtime_error("can not read from eigenray stream") ;
+        }
+
+        eigenray_record record ;
+        std::memcpy( &record, &buffer[0], sizeof(eigenray_record) ) ;
+        const char* intensity = &buffer[sizeof(eigenray_record)] ;
+        const char* phase = intensity + _num_freq * sizeof(double) ;
+
+        // walking backwards, so insert each ray in front of the last one
+
+        first = list->insert( first, eigenray() ) ;
+        eigenray& ray = *first ;
+        ray.time = record.time ;
+        ray.frequencies = _frequencies ;
+        ray.intensity.resize( _num_freq, false ) ;
+        ray.phase.resize( _num_freq, false ) ;
+        std::memcpy( &ray.intensity(0), intensity, _num_freq * sizeof(double) ) ;
+        std::memcpy( &ray.phase(0), phase, _num_freq * sizeof(double) ) ;
+        ray.source_de = record.source_de ;
+        ray.source_az = record.source_az ;
+        ray.target_de = record.target_de ;
+        ray.target_az = record.target_az ;
+        ray.surface = record.surface ;
+        ray.bottom = record.bottom ;
+        ray.caustic = record.caustic ;
+        ray.upper = record.upper ;
+        ray.lower = record.lower ;
+        index = record.next ;
+    }
+}
+
+/**
+ * Write the propagation loss and eigenrays for each target to disk.
+ */
+void eigenray_stream::write_netcdf(
+    const char* filename, const char* long_name, bool coherent )
+{
+    NcFile* nc_file = new NcFile(filename, NcFile::Replace);
+    if (long_name) {
+        nc_file->add_att("long_name", long_name);
+    }
+    nc_file->add_att("Conventions", "COARDS");
+
+    // dimensions
+
+    NcDim *freq_dim = nc_file->add_dim("frequency", (long) _num_freq);
+    NcDim *row_dim = nc_file->add_dim("rows", (long) size1());
+    NcDim *col_dim = nc_file->add_dim("cols", (long) size2());
+    NcDim *eigenray_dim = nc_file->add_dim("eigenrays",
+           (long) ( _num_records + size1() * size2() ) ) ;
+
+    // coordinates
+
+    NcVar *freq_var = nc_file->add_var("frequency", ncDouble, freq_dim);
+
+    NcVar *latitude_var = nc_file->add_var("latitude", ncDouble, row_dim, col_dim);
+    NcVar *longitude_var = nc_file->add_var("longitude", ncDouble, row_dim, col_dim);
+    NcVar *altitude_var = nc_file->add_var("altitude", ncDouble, row_dim, col_dim);
+
+    NcVar *proploss_index_var = nc_file->add_var("proploss_index", ncLong, row_dim, col_dim);
+    NcVar *eigenray_index_var = nc_file->add_var("eigenray_index", ncLong, row_dim, col_dim);
+    NcVar *eigenray_num_var = nc_file->add_var("eigenray_num", ncLong, row_dim, col_dim);
+
+    NcVar *intensity_var = nc_file->add_var("intensity", ncDouble, eigenray_dim, freq_dim);
+    NcVar *phase_var = nc_file->add_var("phase", ncDouble, eigenray_dim, freq_dim);
+    NcVar *time_var = nc_file->add_var("travel_time", ncDouble, eigenray_dim);
+    NcVar *source_de_var = nc_file->add_var("source_de", ncDouble, eigenray_dim);
+    NcVar *source_az_var = nc_file->add_var("source_az", ncDouble, eigenray_dim);
+    NcVar *target_de_var = nc_file->add_var("target_de", ncDouble, eigenray_dim);
+    NcVar *target_az_var = nc_file->add_var("target_az", ncDouble, eigenray_dim);
+    NcVar *surface_var = nc_file->add_var("surface", ncShort, eigenray_dim);
+    NcVar *bottom_var = nc_file->add_var("bottom", ncShort, eigenray_dim);
+    NcVar *caustic_var = nc_file->add_var("caustic", ncShort, eigenray_dim);
+
+    // units
+
+    freq_var->add_att("units", "hertz");
+
+    latitude_var->add_att("units", "degrees_north");
+    longitude_var->add_att("units", "degrees_east");
+    altitude_var->add_att("units", "meters");
+    altitude_var->add_att("positive", "up");
+
+    proploss_index_var->add_att("units", "count");
+    eigenray_index_var->add_att("units", "count");
+    eigenray_num_var->add_att("units", "count");
+
+    intensity_var->add_att("units", "dB");
+    phase_var->add_att("units", "radians");
+    time_var->add_att("units", "seconds");
+
+    source_de_var->add_att("units", "degrees");
+    source_de_var->add_att("positive", "up");
+    source_az_var->add_att("units", "degrees_true");
+    source_az_var->add_att("positive", "clockwise");
+
+    target_de_var->add_att("units", "degrees");
+    target_de_var->add_att("positive", "up");
+    target_az_var->add_att("units", "degrees_true");
+    target_az_var->add_att("positive", "clockwise");
+
+    surface_var->add_att("units", "count");
+    bottom_var->add_att("units", "count");
+    caustic_var->add_att("units", "count");
+
+    // write frequencies and target coordinates
+
+    freq_var->put(vector<double>(*_frequencies).data().begin(), (long) _num_freq);
+    latitude_var->put(_targets->latitude().data().begin(),
+            (long) size1(), (long) size2());
+    longitude_var->put(_targets->longitude().data().begin(),
+            (long) size1(), (long) size2());
+    altitude_var->put(_targets->altitude().data().begin(),
+            (long) size1(), (long) size2());
+
+    // write propagation loss and eigenrays to disk,
+    // reading back only one target at a time from the scratch file
+
+    eigenray loss ;
+    eigenray_list list ;
+    int record = 0; // current record number
+    for (long t1 = 0; t1 < (long) size1(); ++t1) {
+        for (long t2 = 0; t2 < (long) size2(); ++t2) {
+            int num = (int) _count[t1*size2()+t2];
+            proploss_index_var->set_cur(t1, t2);
+            eigenray_index_var->set_cur(t1, t2);
+            eigenray_num_var->set_cur(t1, t2);
+
+            proploss_index_var->put(&record, 1, 1);  // 1st rec = summed PL
+            int next_rec = record+1 ;
+            eigenray_index_var->put(&next_rec, 1, 1); // followed by list of rays
+            eigenray_num_var->put(&num, 1, 1);
+
+            total( (size_t) t1, (size_t) t2, &loss, coherent ) ;
+            list.clear() ;
+            list.push_back( loss ) ;
+            eigenrays( (size_t) t1, (size_t) t2, &list ) ;
+
+            BOOST_FOREACH( const eigenray& ray, list ) {
+                intensity_var->set_cur(record);
+                phase_var->set_cur(record);
+                time_var->set_cur(record);
+                source_de_var->set_cur(record);
+                source_az_var->set_cur(record);
+                target_de_var->set_cur(record);
+                target_az_var->set_cur(record);
+                surface_var->set_cur(record);
+                bottom_var->set_cur(record);
+                caustic_var->set_cur(record);
+                ++record ;
+
+                intensity_var->put(ray.intensity.data().begin(),
+                        1, (long) _num_freq);
+                phase_var->put(ray.phase.data().begin(),
+                        1, (long) _num_freq);
+                time_var->put(&ray.time, 1);
+                source_de_var->put(&ray.source_de, 1);
+                source_az_var->put(&ray.source_az, 1);
+                target_de_var->put(&ray.target_de, 1);
+                target_az_var->put(&ray.target_az, 1);
+                surface_var->put(&ray.surface, 1);
+                bottom_var->put(&ray.bottom, 1);
+                caustic_var->put(&ray.caustic, 1);
+            }
+        }
+    }
+
+    // close file
+
+    delete nc_file; // destructor frees all netCDF temp variables
+}
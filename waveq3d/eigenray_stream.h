@@ -0,0 +1,262 @@
+/**
+ * @file eigenray_stream.h
+ * Streams eigenrays for large target grids to disk as they are found.
+ */
+#pragma once
+
+#include <usml/waveq3d/eigenray_listener.h>
+#include <usml/waveq3d/eigenray_arena.h>
+#include <boost/shared_ptr.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace usml {
+namespace waveq3d {
+
+/// @ingroup waveq3d
+/// @{
+
+/**
+ * Streams eigenrays for large target grids to disk as they are found.
+ * The eigenray_collection keeps every eigenray in memory until the end
+ * of the run, which exhausts memory for transmission loss fields with
+ * 10^5 to 10^6 targets. This listener instead appends each eigenray to
+ * a fixed stride record in a scratch file, buffered in chunks of
+ * chunk_size records.  Peak memory is limited to one chunk, plus
+ * the index and running sums for each target.  The running sums are
+ * stored in flat buffers, three values per target and frequency,
+ * which is the size of the propagation loss result itself, no matter
+ * how many eigenrays reach each target.
+ *
+ * Each record holds an eigenray_record followed by the intensity and phase
+ * for each frequency.  In this file, the eigenray_record::next field
+ * holds the index of the <b>previous</b> record for the same target,
+ * because the next record is not known when the record is written.
+ * The index of the last record for each target is kept in memory, so that
+ * eigenrays() can walk the chain backwards to recover all of the eigenrays
+ * for a single target.  The scratch file uses the native binary layout
+ * of this machine, and is not intended to be portable.
+ *
+ * The coherent and incoherent propagation loss are accumulated
+ * incrementally as each eigenray arrives, using the same weighting as
+ * eigenray_collection::sum_eigenrays(). The total() method converts these
+ * running sums into an eigenray for one target on demand, so that the
+ * summed loss is never stored a second time.  The write_netcdf() method
+ * exports the results one target at a time, in the same format as
+ * eigenray_collection::write_netcdf().
+ *
+ * Reads and writes of the scratch file are checked, and a full disk or
+ * short read throws std::runtime_error instead of returning garbage.
+ */
+class USML_DECLSPEC eigenray_stream : public eigenray_listener {
+
+public:
+
+    /** eigenray_stream shared_ptr */
+    typedef boost::shared_ptr<eigenray_stream> reference ;
+
+    /**
+     * Open the scratch file and initialize the running sums for each target.
+     *
+     * @param   frequencies Frequencies over which to compute loss (Hz).
+     * @param   targets     Grid of targets to ensonify.
+     * @param   filename    Name of the scratch file. Replaced if it exists.
+     * @param   chunk_size  Number of records buffered in memory
+     *                      before they are written to disk.
+     * @throws  std::invalid_argument if the scratch file can not be opened.
+     */
+    eigenray_stream( const seq_vector& frequencies, const wposition* targets,
+                     const char* filename, size_t chunk_size = 4096 ) ;
+
+    /**
+     * Close the scratch file.  The file is left on disk.
+     */
+    virtual ~eigenray_stream() ;
+
+    /** Number of rows in target grid. */
+    inline size_t size1() const {
+        return _targets->size1() ;
+    }
+
+    /** Number of columns in target grid. */
+    inline size_t size2() const {
+        return _targets->size2() ;
+    }
+
+    /** Frequencies over which propagation is computed (Hz). */
+    inline const seq_vector* frequencies() const {
+        return _frequencies ;
+    }
+
+    /** Total number of eigenrays for all targets. */
+    inline size_t num_eigenrays() const {
+        return _num_records ;
+    }
+
+    /** Number of eigenrays for a single target. */
+    inline size_t num_eigenrays( size_t t1, size_t t2 ) const {
+        return _count[t1*size2()+t2] ;
+    }
+
+    /**
+     * Propagation loss for a single target summed over the eigenrays
+     * added so far.  Computed from the running sums on each call.
+     * Estimates of time and angle are averages weighted by
+     * the amplitude in linear (non-dB) space.  The number of
+     * surface bounces, bottom bounces, and caustics are taken from the
+     * strongest path, and are set to -1 if there is no path to this target.
+     *
+     * @param   t1          Row number of the current target.
+     * @param   t2          Column number of the current target.
+     * @param   loss        Summed eigenray (output). Reuses the memory for
+     *                      intensity and phase if it is the correct size.
+     * @param   coherent    Compute coherent propagation loss if true,
+     *                      and incoherent if false.
+     */
+    void total( size_t t1, size_t t2, eigenray* loss,
+                bool coherent = true ) const ;
+
+    /**
+     * Appends a new eigenray to the stream and adds it to the running
+     * sums for its target.
+     *
+     * @param   target_row     Row identifier for the target.
+     * @param   target_col     Column identifier for the target.
+     * @param   ray            Propagation loss information for this collision.
+     * @param   runID          Identification number of the wavefront that
+     *                         produced this result.  Ignored.
+     */
+    virtual void add_eigenray( size_t target_row, size_t target_col,
+                               const eigenray& ray, size_t runID ) ;
+
+    /**
+     * Appends all of the eigenrays from a wavefront step to the stream.
+     *
+     * @param   rays        Array of eigenrays for this step.
+     * @param   count       Number of eigenrays in the array.
+     * @param   wave_time   Elapsed time for this wavefront step. Ignored.
+     * @param   runID       Identification number of the wavefront that
+     *                      produced this result.  Ignored.
+     */
+    virtual void add_eigenrays( const target_eigenray* rays, size_t count,
+                                long wave_time, size_t runID ) ;
+
+    /**
+     * Write any buffered records to the scratch file.
+     *
+     * @throws  std::runtime_error if the records can not be written.
+     */
+    void flush() ;
+
+    /**
+     * Read the eigenrays for a single target back from the scratch file.
+     * Eigenrays are appended to the list in order of arrival.
+     *
+     * @param   t1          Row number of the target.
+     * @param   t2          Column number of the target.
+     * @param   list        List to append eigenrays to (output).
+     * @throws  std::runtime_error if a record can not be read.
+     */
+    void eigenrays( size_t t1, size_t t2, eigenray_list* list ) ;
+
+    /**
+     * Write the summed propagation loss and the eigenrays for each target
+     * to a netCDF file, using the ragged array structure of
+     * eigenray_collection::write_netcdf().  The source position, launch
+     * angles and time step are not known to this listener, and are
+     * omitted.  Only one target's eigenrays are in memory at a time.
+     *
+     * @param   filename    Name of the file to write to disk.
+     * @param   long_name   Optional long_name attribute for this file.
+     * @param   coherent    Write coherent propagation loss if true,
+     *                      and incoherent if false.
+     * @throws  std::runtime_error if a record can not be read.
+     */
+    void write_netcdf( const char* filename, const char* long_name = NULL,
+                       bool coherent = true ) ;
+
+private:
+
+    /**
+     * Running sums for the frequency independent terms of each target.
+     * Each term is weighted by the pressure squared summed across frequency.
+     */
+    struct running_sum {
+        double wgt ;
+        double time ;
+        double source_de ;
+        double source_az_x ;    ///< East/West component
+        double source_az_y ;    ///< North/South component
+        double target_de ;
+        double target_az_x ;    ///< East/West component
+        double target_az_y ;    ///< North/South component
+        double max_a ;          ///< strongest path so far
+        int surface ;
+        int bottom ;
+        int caustic ;
+    } ;
+
+    /** Grid of targets to ensonify. Not owned by this class. */
+    const wposition* _targets ;
+
+    /** Frequencies over which loss was computed (Hz). */
+    const seq_vector* _frequencies ;
+
+    /** Number of frequencies. */
+    const size_t _num_freq ;
+
+    /** Angular frequency for each frequency (rad/sec). */
+    std::vector<double> _omega ;
+
+    /** Name of the scratch file. */
+    const std::string _filename ;
+
+    /** Scratch file used to store the records. */
+    std::fstream _file ;
+
+    /** Number of records buffered before they are written to disk. */
+    const size_t _chunk_size ;
+
+    /** Size of each record in the scratch file (bytes). */
+    const size_t _stride ;
+
+    /** Records that have not yet been written to disk. */
+    std::vector<char> _chunk ;
+
+    /** Total number of records in the stream. */
+    size_t _num_records ;
+
+    /** Number of records that have been written to disk. */
+    size_t _num_flushed ;
+
+    /** Index of the last record for each target, in row major order. */
+    std::vector<size_t> _tail ;
+
+    /** Number of records for each target, in row major order. */
+    std::vector<size_t> _count ;
+
+    /** Frequency independent running sums for each target. */
+    std::vector<running_sum> _sums ;
+
+    /** Real part of the coherent phasor sum, num_freq per target. */
+    std::vector<double> _real ;
+
+    /** Imaginary part of the coherent phasor sum, num_freq per target. */
+    std::vector<double> _imag ;
+
+    /** Incoherent pressure squared sum, num_freq per target. */
+    std::vector<double> _power ;
+
+    /**
+     * Add an eigenray to the running sums for its target.
+     *
+     * @param   target      Index of the target in row major order.
+     * @param   ray         Propagation loss information for this collision.
+     */
+    void accumulate( size_t target, const eigenray& ray ) ;
+};
+
+/// @}
+}  // end of namespace waveq3d
+}  // end of namespace usml
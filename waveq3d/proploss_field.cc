@@ -0,0 +1,103 @@
+/**
+ * @file proploss_field.cc
+ * Propagation loss on a regular range, depth, and bearing grid.
+ */
+#include <usml/waveq3d/proploss_field.h>
+#include <netcdfcpp.h>
+#include <algorithm>
+
+using namespace usml::waveq3d ;
+
+/**
+ * Create an empty field.
+ */
+proploss_field::proploss_field(
+    const seq_vector& range, const seq_vector& depth,
+    const seq_vector& bearing, const seq_vector& frequencies
+) :
+    _range( range.clone() ),
+    _depth( depth.clone() ),
+    _bearing( bearing.clone() ),
+    _frequencies( frequencies.clone() ),
+    _power( range.size() * depth.size() * bearing.size()
+            * frequencies.size(), 0.0 )
+{
+}
+
+/**
+ * Delete axes.
+ */
+proploss_field::~proploss_field() {
+    delete _range ;
+    delete _depth ;
+    delete _bearing ;
+    delete _frequencies ;
+}
+
+/**
+ * Propagation loss at a single grid point and frequency.
+ */
+double proploss_field::intensity( size_t r, size_t d, size_t b, size_t f ) {
+    return -10.0 * log10( max( power(r,d,b)[f], 1e-30 ) ) ;
+}
+
+/**
+ * Reset the field to zero.
+ */
+void proploss_field::clear() {
+    std::fill( _power.begin(), _power.end(), 0.0 ) ;
+}
+
+/**
+ * Write propagation loss to a netCDF file.
+ */
+void proploss_field::write_netcdf( const char* filename, const char* long_name ) {
+    NcFile* nc_file = new NcFile( filename, NcFile::Replace ) ;
+    if ( long_name ) {
+        nc_file->add_att( "long_name", long_name ) ;
+    }
+    nc_file->add_att( "Conventions", "COARDS" ) ;
+
+    // dimensions
+
+    NcDim *range_dim = nc_file->add_dim( "range", (long) _range->size() ) ;
+    NcDim *depth_dim = nc_file->add_dim( "depth", (long) _depth->size() ) ;
+    NcDim *bearing_dim = nc_file->add_dim( "bearing", (long) _bearing->size() ) ;
+    NcDim *freq_dim = nc_file->add_dim( "frequency", (long) _frequencies->size() ) ;
+
+    // variables
+
+    NcVar *range_var = nc_file->add_var( "range", ncDouble, range_dim ) ;
+    NcVar *depth_var = nc_file->add_var( "depth", ncDouble, depth_dim ) ;
+    NcVar *bearing_var = nc_file->add_var( "bearing", ncDouble, bearing_dim ) ;
+    NcVar *freq_var = nc_file->add_var( "frequency", ncDouble, freq_dim ) ;
+    NcVar *intensity_var = nc_file->add_var( "intensity", ncDouble,
+        range_dim, depth_dim, bearing_dim, freq_dim ) ;
+
+    // units
+
+    range_var->add_att( "units", "meters" ) ;
+    depth_var->add_att( "units", "meters" ) ;
+    depth_var->add_att( "positive", "down" ) ;
+    bearing_var->add_att( "units", "degrees_true" ) ;
+    bearing_var->add_att( "positive", "clockwise" ) ;
+    freq_var->add_att( "units", "hertz" ) ;
+    intensity_var->add_att( "units", "dB" ) ;
+
+    // data
+
+    range_var->put( vector<double>(*_range).data().begin(), (long) _range->size() ) ;
+    depth_var->put( vector<double>(*_depth).data().begin(), (long) _depth->size() ) ;
+    bearing_var->put( vector<double>(*_bearing).data().begin(), (long) _bearing->size() ) ;
+    freq_var->put( vector<double>(*_frequencies).data().begin(), (long) _frequencies->size() ) ;
+
+    std::vector<double> intensity( _power.size() ) ;
+    for ( size_t n=0 ; n < _power.size() ; ++n ) {
+        intensity[n] = -10.0 * log10( max( _power[n], 1e-30 ) ) ;
+    }
+    intensity_var->put( &intensity[0], (long) _range->size(),
+        (long) _depth->size(), (long) _bearing->size(),
+        (long) _frequencies->size() ) ;
+
+    delete nc_file ; // destructor frees all netCDF temp variables
+}
@@ -0,0 +1,147 @@
+/**
+ * @file proploss_field.h
+ * Propagation loss on a regular range, depth, and bearing grid.
+ */
+#pragma once
+
+#include <usml/types/types.h>
+#include <vector>
+
+namespace usml {
+namespace waveq3d {
+
+using namespace usml::types ;
+
+/// @ingroup waveq3d
+/// @{
+
+/**
+ * Propagation loss on a regular range, depth, and bearing grid around
+ * the source. Filled by the wave_queue in field mode, which splats the
+ * hybrid Gaussian beam contribution of each ray onto the grid cells that
+ * the wavefront passes through. Unlike the eigenray_collection, this
+ * requires no closest point of approach search for each grid point, so
+ * the cost of a full field is similar to the cost of the propagation.
+ *
+ * Contributions are summed incoherently, as pressure squared in linear
+ * units, in a single contiguous buffer organized as
+ * [range][depth][bearing][frequency].
+ */
+class USML_DECLSPEC proploss_field {
+
+public:
+
+    /**
+     * Create an empty field.
+     *
+     * @param   range       Horizontal range from the source (meters).
+     * @param   depth       Depth below the ocean surface (meters,
+     *                      positive is down).
+     * @param   bearing     True bearing from the source (degrees,
+     *                      clockwise from true north).
+     * @param   frequencies Frequencies over which to compute loss (Hz).
+     */
+    proploss_field( const seq_vector& range, const seq_vector& depth,
+                    const seq_vector& bearing, const seq_vector& frequencies ) ;
+
+    /** Delete axes. */
+    virtual ~proploss_field() ;
+
+    /** Horizontal range from the source (meters). */
+    inline seq_vector* range() const {
+        return _range ;
+    }
+
+    /** Depth below the ocean surface (meters, positive is down). */
+    inline seq_vector* depth() const {
+        return _depth ;
+    }
+
+    /** True bearing from the source (degrees). */
+    inline seq_vector* bearing() const {
+        return _bearing ;
+    }
+
+    /** Frequencies over which loss is computed (Hz). */
+    inline const seq_vector* frequencies() const {
+        return _frequencies ;
+    }
+
+    /**
+     * Pressure squared, summed over all contributions, for each
+     * frequency at a single grid point.
+     *
+     * @param   r           Range index.
+     * @param   d           Depth index.
+     * @param   b           Bearing index.
+     * @return              Pointer to num_freq contiguous values.
+     */
+    inline double* power( size_t r, size_t d, size_t b ) {
+        return &_power[ ( ( r * _depth->size() + d ) * _bearing->size() + b )
+                        * _frequencies->size() ] ;
+    }
+
+    /**
+     * Propagation loss at a single grid point and frequency.
+     *
+     * @param   r           Range index.
+     * @param   d           Depth index.
+     * @param   b           Bearing index.
+     * @param   f           Frequency index.
+     * @return              Propagation loss (dB, positive).
+     */
+    double intensity( size_t r, size_t d, size_t b, size_t f ) ;
+
+    /** Reset the field to zero. */
+    void clear() ;
+
+    /**
+     * Write propagation loss to a netCDF file.
+     * <pre>
+     *     netcdf proploss_field {
+     *     dimensions:
+     *         range = ... ;
+     *         depth = ... ;
+     *         bearing = ... ;
+     *         frequency = ... ;
+     *     variables:
+     *         double range(range) ;
+     *             range:units = "meters" ;
+     *         double depth(depth) ;
+     *             depth:units = "meters" ;
+     *             depth:positive = "down" ;
+     *         double bearing(bearing) ;
+     *             bearing:units = "degrees_true" ;
+     *             bearing:positive = "clockwise" ;
+     *         double frequency(frequency) ;
+     *             frequency:units = "hertz" ;
+     *         double intensity(range, depth, bearing, frequency) ;
+     *             intensity:units = "dB" ;
+     *     }
+     * </pre>
+     * @param   filename    Name of the file to write to disk.
+     * @param   long_name   Optional global attribute for identifying data-set.
+     */
+    void write_netcdf( const char* filename, const char* long_name = NULL ) ;
+
+private:
+
+    /** Horizontal range from the source (meters). */
+    seq_vector* _range ;
+
+    /** Depth below the ocean surface (meters, positive is down). */
+    seq_vector* _depth ;
+
+    /** True bearing from the source (degrees). */
+    seq_vector* _bearing ;
+
+    /** Frequencies over which loss is computed (Hz). */
+    seq_vector* _frequencies ;
+
+    /** Pressure squared, [range][depth][bearing][frequency]. */
+    std::vector<double> _power ;
+};
+
+/// @}
+}  // end of namespace waveq3d
+}  // end of namespace usml
@@ -0,0 +1,136 @@
+/**
+ * @file eigenray_stream_test.cc
+ * Regression tests for streaming eigenrays to a scratch file.
+ */
+#include <boost/test/unit_test.hpp>
+#include <usml/waveq3d/eigenray_collection.h>
+#include <usml/waveq3d/eigenray_stream.h>
+#include <boost/foreach.hpp>
+#include <iostream>
+
+BOOST_AUTO_TEST_SUITE(eigenray_stream_test)
+
+using namespace boost::unit_test;
+using namespace usml::waveq3d;
+using std::cout;
+using std::endl;
+
+/**
+ * @ingroup waveq3d_test
+ * @{
+ */
+
+/**
+ * Create a synthetic eigenray whose properties depend on its target
+ * and its order of arrival, so that mixing up targets or records
+ * changes the results.
+ */
+static eigenray make_eigenray( const seq_vector* freq,
+    size_t t1, size_t t2, size_t n )
+{
+    eigenray ray ;
+    ray.time = 1.0 + 0.1 * t1 + 0.01 * t2 + 0.137 * n ;
+    ray.frequencies = freq ;
+    ray.intensity.resize( freq->size() ) ;
+    ray.phase.resize( freq->size() ) ;
+    for ( size_t f=0 ; f < freq->size() ; ++f ) {
+        ray.intensity(f) = 60.0 + 3.0 * n + 0.5 * f + t2 ;
+        ray.phase(f) = ( n % 2 ) ? -M_PI_2 : 0.0 ;
+    }
+    ray.source_de = -10.0 + 5.0 * n ;
+    ray.source_az = 350.0 + 10.0 * n + t1 ;
+    ray.target_de = 10.0 - 5.0 * n ;
+    ray.target_az = 170.0 + 10.0 * n + t2 ;
+    ray.surface = (int) n ;
+    ray.bottom = (int) ( n + t1 ) ;
+    ray.caustic = (int) ( n / 2 ) ;
+    ray.upper = (int) t1 ;
+    ray.lower = (int) t2 ;
+    return ray ;
+}
+
+/**
+ * Check that two eigenrays have the same properties.
+ */
+static void check_eigenray( const eigenray& ray, const eigenray& expected ) {
+    BOOST_CHECK_CLOSE( ray.time, expected.time, 1e-10 ) ;
+    for ( size_t f=0 ; f < expected.intensity.size() ; ++f ) {
+        BOOST_CHECK_CLOSE( ray.intensity(f), expected.intensity(f), 1e-10 ) ;
+        BOOST_CHECK_SMALL( ray.phase(f) - expected.phase(f), 1e-10 ) ;
+    }
+    BOOST_CHECK_SMALL( ray.source_de - expected.source_de, 1e-10 ) ;
+    BOOST_CHECK_SMALL( ray.source_az - expected.source_az, 1e-10 ) ;
+    BOOST_CHECK_SMALL( ray.target_de - expected.target_de, 1e-10 ) ;
+    BOOST_CHECK_SMALL( ray.target_az - expected.target_az, 1e-10 ) ;
+    BOOST_CHECK_EQUAL( ray.surface, expected.surface ) ;
+    BOOST_CHECK_EQUAL( ray.bottom, expected.bottom ) ;
+    BOOST_CHECK_EQUAL( ray.caustic, expected.caustic ) ;
+}
+
+/**
+ * Sends the same eigenrays to an eigenray_stream and an eigenray_collection,
+ * interleaving the targets and using a chunk size that forces several
+ * flushes part way through a target's list.  The eigenrays read back
+ * from the scratch file must match the ones that were added, in order,
+ * and the coherent and incoherent totals computed from the running sums
+ * must match eigenray_collection::sum_eigenrays().
+ */
+BOOST_AUTO_TEST_CASE( eigenray_stream_totals ) {
+    cout << "=== eigenray_stream_test: eigenray_stream_totals ===" << endl;
+    const seq_linear freq( 1000.0, 1000.0, 3 ) ;
+    const seq_linear source_de( -10.0, 1.0, 21 ) ;
+    const seq_linear source_az( 0.0, 10.0, 36 ) ;
+    const wposition1 source( 45.0, -45.0, -10.0 ) ;
+    wposition targets( 2, 3, 45.01, -45.0, -100.0 ) ;
+
+    eigenray_collection collection( freq, source, source_de, source_az,
+                                    0.1, &targets ) ;
+    eigenray_stream stream( freq, &targets,
+                            "eigenray_stream_test.bin", 3 ) ;
+
+    // add 1 to 6 eigenrays per target, interleaved across targets
+
+    const size_t max_rays = 6 ;
+    for ( size_t n=0 ; n < max_rays ; ++n ) {
+        for ( size_t t1=0 ; t1 < targets.size1() ; ++t1 ) {
+            for ( size_t t2=0 ; t2 < targets.size2() ; ++t2 ) {
+                if ( n > t1 * targets.size2() + t2 ) continue ;
+                const eigenray ray = make_eigenray( &freq, t1, t2, n ) ;
+                collection.add_eigenray( t1, t2, ray, 0 ) ;
+                stream.add_eigenray( t1, t2, ray, 0 ) ;
+            }
+        }
+    }
+
+    // compare eigenrays read back from the scratch file
+
+    for ( size_t t1=0 ; t1 < targets.size1() ; ++t1 ) {
+        for ( size_t t2=0 ; t2 < targets.size2() ; ++t2 ) {
+            const size_t expected = t1 * targets.size2() + t2 + 1 ;
+            eigenray_list list ;
+            stream.eigenrays( t1, t2, &list ) ;
+            BOOST_REQUIRE_EQUAL( list.size(), expected ) ;
+            size_t n = 0 ;
+            BOOST_FOREACH( const eigenray& ray, list ) {
+                check_eigenray( ray, make_eigenray( &freq, t1, t2, n++ ) ) ;
+            }
+        }
+    }
+
+    // compare coherent and incoherent totals
+
+    for ( int coherent=0 ; coherent < 2 ; ++coherent ) {
+        collection.sum_eigenrays( coherent != 0 ) ;
+        eigenray loss ;
+        for ( size_t t1=0 ; t1 < targets.size1() ; ++t1 ) {
+            for ( size_t t2=0 ; t2 < targets.size2() ; ++t2 ) {
+                stream.total( t1, t2, &loss, coherent != 0 ) ;
+                check_eigenray( loss, *collection.total( t1, t2 ) ) ;
+            }
+        }
+    }
+}
+
+/// @}
+
+BOOST_AUTO_TEST_SUITE_END()
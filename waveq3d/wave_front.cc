@@ -15,7 +15,8 @@ wave_front::wave_front(
     size_t num_de,
     size_t num_az,
     const wposition* targets,
-    const matrix<double>* sin_theta
+    const matrix<double>* sin_theta,
+    const wposition1* origin
 ) :
     position( num_de, num_az ),
     pos_gradient( num_de, num_az ),
@@ -40,6 +41,9 @@ wave_front::wave_front(
     _c2_r( num_de, num_az ),
     _sin_theta( num_de, num_az ),
     _cot_theta( num_de, num_az ),
+    _tangent_plane( origin != NULL ),
+    _tangent_rho( 0.0 ),
+    _tangent_rho_sin( 0.0 ),
     _target_sin_theta( sin_theta )
 {
     sound_speed.clear() ;
@@ -52,6 +56,16 @@ wave_front::wave_front(
     lower.clear() ;
     on_edge.clear() ;
 
+    // freeze the metric terms at the origin of the tangent plane
+
+    if ( _tangent_plane ) {
+        const double sin_theta0 = sin( origin->theta() ) ;
+        _tangent_rho = 1.0 / origin->rho() ;
+        _tangent_rho_sin = _tangent_rho / sin_theta0 ;
+        _sin_theta = scalar_matrix<double>( num_de, num_az, sin_theta0 ) ;
+        _cot_theta.clear() ;
+    }
+
     for ( size_t n1=0 ; n1 < num_de ; ++n1 ) {
         for ( size_t n2=0 ; n2 < num_az ; ++n2 ) {
             attenuation(n1,n2).resize( freq->size() ) ;
@@ -129,13 +143,29 @@ void wave_front::update() {
     _dc_c.rho(element_div(sound_gradient.rho(), sound_speed));
     _dc_c.theta(element_div(sound_gradient.theta(), sound_speed));
     _dc_c.phi(element_div(sound_gradient.phi(), sound_speed));
+    _c2_r = abs2(sound_speed);
+
+    // flat earth derivatives with metric frozen at the origin
+
+    if ( _tangent_plane ) {
+        pos_gradient.rho(element_prod(_c2_r, ndirection.rho()));
+        pos_gradient.theta(_tangent_rho
+            * element_prod(_c2_r, ndirection.theta()));
+        pos_gradient.phi(_tangent_rho_sin
+            * element_prod(_c2_r, ndirection.phi()));
+        ndir_gradient.rho( -_dc_c.rho() );
+        ndir_gradient.theta( -_tangent_rho * _dc_c.theta() );
+        ndir_gradient.phi( -_tangent_rho_sin * _dc_c.phi() );
+        if (targets) compute_target_distance();
+        return ;
+    }
+
     noalias(_sin_theta) = sin(position.theta());
     noalias(_cot_theta) = element_div(cos(position.theta()), _sin_theta);
 
     // update wave propagation position derivatives
     // Reilly eqns. 36-38
 
-    _c2_r = abs2(sound_speed);
     pos_gradient.rho(element_prod(_c2_r, ndirection.rho()));
     _c2_r = element_div(_c2_r, position.rho());
     pos_gradient.theta(element_prod(_c2_r, ndirection.theta()));
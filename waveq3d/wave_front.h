@@ -61,6 +61,34 @@ using boost::numeric::ublas::vector;
  * as private data members in the wave_front object to reduce the
  * number of times that common terms need to be re-allocated in memory.
  *
+ * For short range problems, an optional local tangent plane mode
+ * freezes the metric of the spherical coordinate system at the origin
+ * \f$ ( \rho_0, \theta_0, \phi_0 ) \f$ of the ray fan.  In this mode,
+ * the rho, theta, and phi directions act like the up, south, and east
+ * axes of a flat earth, and the derivatives reduce to
+ *
+ * \f[
+ *      \frac{d\rho}{dt} = c^2 \xi_\rho
+ * \f]\f[
+ *      \frac{d\theta}{dt} = \frac{ c^2 \xi_\theta }{ \rho_0 }
+ * \f]\f[
+ *      \frac{d\phi}{dt} = \frac{ c^2 \xi_\phi }{ \rho_0 sin(\theta_0) }
+ * \f]\f[
+ *      \frac{d\xi_\rho}{dt} = -\frac{1}{c}\frac{dc}{d\rho}
+ * \f]\f[
+ *      \frac{d\xi_\theta}{dt} = -\frac{1}{c\rho_0}\frac{dc}{d\theta}
+ * \f]\f[
+ *      \frac{d\xi_\phi}{dt} = -\frac{1}{c\rho_0 sin(\theta_0)}\frac{dc}{d\phi}
+ * \f]
+ *
+ * Because the curvature terms vanish and the metric is constant, update()
+ * no longer evaluates any transcendental functions for each ray.  The
+ * position and direction are still stored in spherical earth coordinates,
+ * so the ocean model, reflection model, eigenrays, and eigenverbs all work
+ * without conversion.  The horizontal error grows with the square of the
+ * range from the origin divided by the earth radius, which limits this
+ * mode to ranges of a few tens of kilometers.
+ *
  * @xref S.M. Reilly, G. Potty, Sonar Propagation Modeling using Hybrid
  * Gaussian Beams in Spherical/Time Coordinates, January 2012.
  */
@@ -82,13 +110,16 @@ class USML_DECLSPEC wave_front {
          * @param  sin_theta    Reference to sin(theta) for each target.
          *                      Used to speed up compute_target_distance() calc.
          *                      Not used if eigenrays are not being computed.
+         * @param  origin       Origin of the local tangent plane.  Uses
+         *                      spherical earth derivatives if this is NULL.
          */
         wave_front(
             ocean_model& ocean,
             const seq_vector* freq,
             size_t num_de, size_t num_az,
             const wposition* targets = NULL,
-            const matrix<double>* sin_theta = NULL
+            const matrix<double>* sin_theta = NULL,
+            const wposition1* origin = NULL
             ) ;
 
         /**
@@ -105,6 +136,14 @@ class USML_DECLSPEC wave_front {
             return position.size2() ;
         }
 
+        /**
+         * True if derivatives are computed in a local tangent plane
+         * instead of spherical earth coordinates.
+         */
+        inline bool tangent_plane() const {
+            return _tangent_plane ;
+        }
+
         /**
          * Initialize position and direction components of the wavefront.
          * Computes normalized directions from depression/elevation
@@ -292,6 +331,21 @@ class USML_DECLSPEC wave_front {
          */
         matrix<double> _cot_theta ;
 
+        /**
+         * Compute derivatives in the local tangent plane at the origin.
+         */
+        bool _tangent_plane ;
+
+        /**
+         * Inverse of rho at the tangent plane origin.
+         */
+        double _tangent_rho ;
+
+        /**
+         * Inverse of rho*sin(theta) at the tangent plane origin.
+         */
+        double _tangent_rho_sin ;
+
         /**
          * Sin of colatitude for targets (cached intermediate term).
          * Not used if eigenrays are not being computed.
@@ -315,6 +369,8 @@ class USML_DECLSPEC wave_front {
          * each point of the wavefront in an eariler step of the update() function.
          * This approach allows us to approximation distances in spherical
          * coordinates without the use of any transindental function.
+         * In tangent plane mode, sin(theta) of the wavefront is frozen
+         * at the value for the origin.
          */
         void compute_target_distance() ;
 
@@ -32,7 +32,8 @@ wave_queue::wave_queue(
     double time_step,
     const wposition* targets,
     const size_t run_id,
-    spreading_type type
+    spreading_type type,
+    geometry_type geometry
 ) :
     _ocean( ocean ),
     _frequencies( &freq ),
@@ -45,6 +46,9 @@ wave_queue::wave_queue(
     _time( 0.0 ),
     _targets( targets ),
     _run_id(run_id),
+    _eigenray_count( 0 ),
+    _eigenverb_count( 0 ),
+    _field( NULL ),
     _nc_file( NULL )
 {
     _az_boundary = false ;
@@ -71,10 +75,11 @@ wave_queue::wave_queue(
 
     // create storage space for all wavefront elements
 
-    _past = new wave_front( _ocean, _frequencies, de.size(), az.size(), _targets, &_targets_sin_theta ) ;
-    _prev = new wave_front( _ocean, _frequencies, de.size(), az.size(), _targets, &_targets_sin_theta ) ;
-    _curr = new wave_front( _ocean, _frequencies, de.size(), az.size(), _targets, &_targets_sin_theta ) ;
-    _next = new wave_front( _ocean, _frequencies, de.size(), az.size(), _targets, &_targets_sin_theta ) ;
+    const wposition1* origin = ( geometry == TANGENT_PLANE ) ? &_source_pos : NULL ;
+    _past = new wave_front( _ocean, _frequencies, de.size(), az.size(), _targets, &_targets_sin_theta, origin ) ;
+    _prev = new wave_front( _ocean, _frequencies, de.size(), az.size(), _targets, &_targets_sin_theta, origin ) ;
+    _curr = new wave_front( _ocean, _frequencies, de.size(), az.size(), _targets, &_targets_sin_theta, origin ) ;
+    _next = new wave_front( _ocean, _frequencies, de.size(), az.size(), _targets, &_targets_sin_theta, origin ) ;
 
     // initialize wave front elements
 
@@ -188,9 +193,26 @@ void wave_queue::step() {
 
     detect_eigenrays() ;
 
+    // splat Gaussian beams onto the dense field
+
+    if ( _field ) splat_field() ;
+
     // notify listeners that this step is complete
 
-    check_eigenray_listeners( _time, runID() ) ;
+    notify_listeners() ;
+}
+
+/**
+ * Deliver the eigenrays and eigenverbs for this step to all listeners.
+ */
+void wave_queue::notify_listeners() {
+    const target_eigenray* rays = _eigenray_count ? &_eigenray_batch[0] : NULL ;
+    notify_eigenray_listeners( rays, _eigenray_count, _time, runID() ) ;
+    _eigenray_count = 0 ;
+    if ( _eigenverb_count ) {
+        notify_eigenverb_listeners( &_eigenverb_batch[0], _eigenverb_count ) ;
+        _eigenverb_count = 0 ;
+    }
 }
 
 /**
@@ -527,9 +549,15 @@ void wave_queue::build_eigenray(
 
     compute_offsets(t1,t2,de,az,distance2,delta,offset,distance);
 
-    // build basic eigenray products
+    // build basic eigenray products in the next free batch entry
 
-    eigenray ray ;
+    if ( _eigenray_count == _eigenray_batch.size() ) {
+        _eigenray_batch.resize( _eigenray_count + 1 ) ;
+    }
+    target_eigenray& entry = _eigenray_batch[_eigenray_count] ;
+    entry.target_row = t1 ;
+    entry.target_col = t2 ;
+    eigenray& ray = entry.ray ;
     ray.time        = _time + offset(0) ;
     ray.source_de   = (*_source_de)(de) + offset(1) ;
     ray.source_az   = (*_source_az)(az) + offset(2) ;
@@ -655,8 +683,8 @@ void wave_queue::build_eigenray(
              << "\tt=" << ray.time << " inten=" << ray.intensity << " de=" << ray.source_de << " az=" << ray.source_az << endl
              << "\tsurface=" << ray.surface << " bottom=" << ray.bottom << " caustic=" << ray.caustic << endl ;
     #endif
-    // Add eigenray to those objects which requested them
-    notify_eigenray_listeners(t1,t2,ray,runID());
+    // Add eigenray to the batch for this step
+    ++_eigenray_count ;
 
 }
 
@@ -1049,7 +1077,12 @@ void wave_queue::build_eigenverb(
 				+ curr()->sound_speed(de,az) * dt ;
 	const double sin_grazing = sin(grazing);
 
-    usml::eigenverb::eigenverb verb ;
+    if ( _eigenverb_count == _eigenverb_batch.size() ) {
+        _eigenverb_batch.resize( _eigenverb_count + 1 ) ;
+    }
+    interface_eigenverb& entry = _eigenverb_batch[_eigenverb_count] ;
+    entry.interface_num = type ;
+    usml::eigenverb::eigenverb& verb = entry.verb ;
 	verb.length = path_length * de_delta / sin_grazing ;
 	verb.width = path_length * az_delta ;
 	verb.length2 = verb.length * verb.length ;	// compute length squared
@@ -1101,5 +1134,5 @@ void wave_queue::build_eigenverb(
 			<< "\tsurface="	<< verb.surface << " bottom=" << verb.bottom
 			<< " caustic=" << verb.caustic << endl;
 	#endif
-	notify_eigenverb_listeners(verb, type) ;
+	++_eigenverb_count ;
 }
@@ -8,6 +8,7 @@
 #include <usml/waveq3d/wave_front.h>
 #include <usml/waveq3d/wave_thresholds.h>
 #include <usml/waveq3d/eigenray_notifier.h>
+#include <usml/waveq3d/proploss_field.h>
 #include <usml/eigenverb/eigenverb_notifier.h>
 #include <usml/eigenverb/eigenverb_collection.h>
 #include <netcdfcpp.h>
@@ -78,6 +79,13 @@ class USML_DECLSPEC wave_queue :
      */
     typedef enum { CLASSIC_RAY, HYBRID_GAUSSIAN } spreading_type ;
 
+    /**
+     * Coordinate system used to compute wavefront derivatives.
+     * TANGENT_PLANE is a flat earth approximation centered on the source
+     * that avoids per-ray trigonometry for short range problems.
+     */
+    typedef enum { SPHERICAL_EARTH, TANGENT_PLANE } geometry_type ;
+
     //**************************************************
     // methods
 
@@ -103,6 +111,8 @@ class USML_DECLSPEC wave_queue :
      * @param  run_id        Run Identification number.
      * @param  type         Type of spreading model to use: CLASSIC_RAY
      *                      or HYBRID_GAUSSIAN.
+     * @param  geometry     Coordinate system for the wavefront derivatives:
+     *                      SPHERICAL_EARTH or TANGENT_PLANE.
      *   NOTE: The freq paramater above, is a seq_vector pointer and is owned 
      *         by caller of the wave_queue constructor. It is the responsibilty 
      *         of the caller to ensure the pointer is not freed from memory while 
@@ -117,7 +127,8 @@ class USML_DECLSPEC wave_queue :
         double time_step,
         const wposition* targets=NULL,
         const size_t run_id=1,
-        spreading_type type=HYBRID_GAUSSIAN
+        spreading_type type=HYBRID_GAUSSIAN,
+        geometry_type geometry=SPHERICAL_EARTH
         ) ;
 
     /** Destroy all temporary memory. */
@@ -273,6 +284,22 @@ class USML_DECLSPEC wave_queue :
         return _run_id ;
     }
 
+    /**
+     * Enables the dense propagation loss field mode.  On each step,
+     * the Gaussian beam contribution of each ray is accumulated onto the
+     * range slices of the field that the wavefront crosses, using the
+     * beam widths of the spreading_hybrid_gaussian model.  Requires the
+     * HYBRID_GAUSSIAN spreading model. This mode can be used with or
+     * without eigenray targets.
+     *
+     * @param field     Grid that accumulates the results. Memory for
+     *                  this grid is managed by the calling routine.
+     *                  Set to NULL to disable field mode.
+     */
+    inline void field_mode( proploss_field* field ) {
+        _field = field ;
+    }
+
     /**
      * Marches to the next integration step in the acoustic propagation.
      * Uses the third order Adams-Bashforth algorithm to estimate the position
@@ -293,6 +320,9 @@ class USML_DECLSPEC wave_queue :
      * portray targets near the interface.  Reflections are computed at the
      * beginning of the next iteration to ensure that the next wave elements
      * are alway inside of the water column.
+     *
+     * The eigenrays and eigenverbs found during a step are delivered to
+     * the listeners as a single batch when the step is complete.
      */
     void step() ;
 
@@ -401,6 +431,70 @@ class USML_DECLSPEC wave_queue :
      */
     bool _de_branch ;
 
+    /**
+     * Eigenrays found during the current step.  Entries are reused
+     * from step to step, so that their frequency vectors are not
+     * re-allocated. Only the first _eigenray_count entries are valid.
+     */
+    std::vector<target_eigenray> _eigenray_batch ;
+
+    /** Number of valid entries in _eigenray_batch. */
+    size_t _eigenray_count ;
+
+    /**
+     * Eigenverbs found during the current step.  Entries are reused
+     * from step to step. Only the first _eigenverb_count entries are valid.
+     */
+    std::vector<interface_eigenverb> _eigenverb_batch ;
+
+    /** Number of valid entries in _eigenverb_batch. */
+    size_t _eigenverb_count ;
+
+    /**
+     * Dense propagation loss field filled by splat_field().
+     * Not used if this is NULL.
+     */
+    proploss_field* _field ;
+
+    /**
+     * Accumulate the Gaussian beam contribution of each ray onto the
+     * range slices of the field that it crosses between the current
+     * and next wavefronts.  Each splat is the product of D/E and AZ
+     * Gaussian profiles, using the same widths and normalization as
+     * spreading_hybrid_gaussian::intensity(), truncated at three beam
+     * widths.  Like intensity(), each Gaussian is centered on the cell
+     * between the rays de to de+1 and az to az+1, half of a cell width away
+     * from the ray itself.  The depth and bearing of this cell center, and
+     * the attenuation of the ray, are linearly interpolated to each range
+     * slice.  The D/E distance is measured along the vertical axis,
+     * scaled by the cosine of the ray elevation angle.
+     */
+    void splat_field() ;
+
+    /**
+     * Center of the cell between the rays de to de+1 and az to az+1.
+     * Offset from the ray at (de,az) by half of the cell width in each
+     * direction, which is the same offset used to center the Gaussian
+     * profiles in spreading_hybrid_gaussian::intensity_de() and
+     * intensity_az().
+     *
+     * @param position  Ray positions on one wavefront.
+     * @param de        D/E index of the lower corner of the cell.
+     * @param az        AZ index of the lower corner of the cell.
+     * @param theta     Colatitude of the cell center (rad, output).
+     * @param phi       Longitude of the cell center (rad, output).
+     * @param rho       Radius of the cell center (m, output).
+     */
+    static void cell_center( const wposition& position, size_t de, size_t az,
+        double* theta, double* phi, double* rho ) ;
+
+    /**
+     * Deliver the eigenrays and eigenverbs for this step to all
+     * listeners in a single batch, and reset the batches for the
+     * next step.  Replaces the per-step check_eigenray_listeners() call.
+     */
+    void notify_listeners() ;
+
     /**
      * Initialize wavefronts at the start of propagation using a
      * 3rd order Runge-Kutta algorithm.  The Runge-Kutta algorithm is
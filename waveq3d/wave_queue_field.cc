@@ -0,0 +1,156 @@
+/**
+ * @file wave_queue_field.cc
+ * Splat Gaussian beam contributions onto a dense propagation loss field.
+ */
+#include <usml/waveq3d/wave_queue.h>
+#include <usml/waveq3d/spreading_hybrid_gaussian.h>
+
+using namespace usml::waveq3d ;
+
+/**
+ * Center of the cell between the rays de to de+1 and az to az+1.
+ */
+void wave_queue::cell_center( const wposition& position, size_t de, size_t az,
+    double* theta, double* phi, double* rho )
+{
+    *theta = 0.5 * ( position.theta(de+1,az) + position.theta(de,az+1) ) ;
+    *phi = 0.5 * ( position.phi(de+1,az) + position.phi(de,az+1) ) ;
+    *rho = 0.5 * ( position.rho(de+1,az) + position.rho(de,az+1) ) ;
+}
+
+/**
+ * Accumulate the Gaussian beam contribution of each ray onto the
+ * range slices of the field that it crosses in this time step.
+ */
+void wave_queue::splat_field() {
+    spreading_hybrid_gaussian* beam =
+        dynamic_cast<spreading_hybrid_gaussian*>( _spreading_model ) ;
+    if ( beam == NULL ) return ;
+
+    seq_vector& range = *( _field->range() ) ;
+    seq_vector& depth = *( _field->depth() ) ;
+    seq_vector& bearing = *( _field->bearing() ) ;
+    const size_t num_freq = _frequencies->size() ;
+    const double overlap2 = spreading_hybrid_gaussian::OVERLAP
+                          * spreading_hybrid_gaussian::OVERLAP ;
+    const double sigma = 3.0 ;  // extent of each splat in beam widths
+
+    // local tangent plane at the source
+
+    const double rho0 = _source_pos.rho() ;
+    const double theta0 = _source_pos.theta() ;
+    const double phi0 = _source_pos.phi() ;
+    const double sin_theta0 = sin( theta0 ) ;
+
+    vector<double> offset( 3 ) ;
+    offset.clear() ;
+    std::vector<double> bw_de( num_freq ), bw_az( num_freq ) ;
+    std::vector<double> norm( num_freq ), atten( num_freq ) ;
+    std::vector<double> gauss_de( num_freq ) ;
+
+    // each cell spans the rays de to de+1 and az to az+1, like the cells
+    // summed by spreading_hybrid_gaussian::intensity(), so the last
+    // azimuth of a fan that does not wrap is the upper edge of the last cell,
+    // and the last azimuth of a fan that wraps duplicates the first one
+
+    for ( size_t de=1 ; de < _max_de ; ++de ) {
+        for ( size_t az=0 ; az < _max_az ; ++az ) {
+            if ( _curr->on_edge(de,az) ) continue ;
+            if ( above_bounce_threshold( _curr, de, az ) ) continue ;
+
+            // center of this cell on the current and next wavefronts,
+            // offset from the ray by half of the cell width in D/E and AZ
+
+            double theta1, phi1, rho1, theta2, phi2, rho2 ;
+            cell_center( _curr->position, de, az, &theta1, &phi1, &rho1 ) ;
+            cell_center( _next->position, de, az, &theta2, &phi2, &rho2 ) ;
+
+            // horizontal range of this cell on the current and next wavefronts
+
+            const double n1 = ( theta0 - theta1 ) * rho0 ;
+            const double e1 = ( phi1 - phi0 ) * rho0 * sin_theta0 ;
+            const double n2 = ( theta0 - theta2 ) * rho0 ;
+            const double e2 = ( phi2 - phi0 ) * rho0 * sin_theta0 ;
+            const double r1 = sqrt( n1*n1 + e1*e1 ) ;
+            const double r2 = sqrt( n2*n2 + e2*e2 ) ;
+            if ( r1 == r2 ) continue ;
+
+            // range slices crossed between the current and next wavefront
+
+            const double rmin = std::min( r1, r2 ) ;
+            const double rmax = std::max( r1, r2 ) ;
+            size_t k = range.find_index( rmin ) ;
+            if ( range(k) < rmin ) ++k ;
+            if ( k >= range.size() || range(k) >= rmax ) continue ;
+
+            // beam widths and normalization from the hybrid Gaussian model
+
+            const double c = _curr->sound_speed(de,az) ;
+            const double w_de = beam->width_de( de, az, offset ) ;
+            const double w_az = beam->width_az( de, az, offset ) ;
+            double max_bw = 0.0 ;
+            for ( size_t f=0 ; f < num_freq ; ++f ) {
+                double spread = spreading_hybrid_gaussian::SPREADING_WIDTH
+                              * c / (*_frequencies)(f) ;
+                spread *= spread ;
+                bw_de[f] = spread + overlap2 * w_de * w_de ;
+                bw_az[f] = spread + overlap2 * w_az * w_az ;
+                norm[f] = beam->_norm_de(de) * beam->_norm_az(de,az)
+                        / sqrt( bw_de[f] * bw_az[f] ) ;
+                max_bw = std::max( max_bw, std::max( bw_de[f], bw_az[f] ) ) ;
+            }
+            const double extent = sigma * sqrt( max_bw ) ;
+
+            // projection of D/E distance onto the vertical axis
+
+            const double xi_r = _curr->ndirection.rho(de,az) ;
+            const double xi_h = sqrt(
+                _curr->ndirection.theta(de,az) * _curr->ndirection.theta(de,az)
+              + _curr->ndirection.phi(de,az) * _curr->ndirection.phi(de,az) ) ;
+            const double cos_el = xi_h / sqrt( xi_h*xi_h + xi_r*xi_r ) ;
+            const double depth_extent = extent / std::max( cos_el, 0.1 ) ;
+
+            for ( ; k < range.size() && range(k) < rmax ; ++k ) {
+                const double R = range(k) ;
+                const double u = ( R - r1 ) / ( r2 - r1 ) ;
+
+                // cell depth, bearing, and ray attenuation at this range
+
+                const double z = -( (1.0-u) * rho1 + u * rho2
+                    - wposition::earth_radius ) ;
+                const double b = to_degrees( atan2(
+                    (1.0-u) * e1 + u * e2, (1.0-u) * n1 + u * n2 ) ) ;
+                for ( size_t f=0 ; f < num_freq ; ++f ) {
+                    atten[f] = norm[f] * pow( 10.0, -0.1 * (
+                        (1.0-u) * _curr->attenuation(de,az)(f)
+                        + u * _next->attenuation(de,az)(f) ) ) ;
+                }
+
+                // depth window around the cell center
+
+                size_t j = depth.find_index( z - depth_extent ) ;
+                for ( ; j < depth.size() && depth(j) <= z + depth_extent ; ++j ) {
+                    const double d_de = ( depth(j) - z ) * cos_el ;
+                    for ( size_t f=0 ; f < num_freq ; ++f ) {
+                        gauss_de[f] = atten[f]
+                            * exp( -0.5 * d_de * d_de / bw_de[f] ) ;
+                    }
+
+                    // bearing window around the cell center
+
+                    for ( size_t i=0 ; i < bearing.size() ; ++i ) {
+                        double db = bearing(i) - b ;
+                        db = fmod( db + 540.0, 360.0 ) - 180.0 ;
+                        const double d_az = R * to_radians( db ) ;
+                        if ( abs(d_az) > extent ) continue ;
+                        double* power = _field->power( k, j, i ) ;
+                        for ( size_t f=0 ; f < num_freq ; ++f ) {
+                            power[f] += gauss_de[f]
+                                * exp( -0.5 * d_az * d_az / bw_az[f] ) ;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -91,4 +91,7 @@
 #include <usml/waveq3d/wave_queue.h>
 #include <usml/waveq3d/wave_front.h>
 #include <usml/waveq3d/eigenray.h>
+#include <usml/waveq3d/eigenray_arena.h>
+#include <usml/waveq3d/eigenray_stream.h>
+#include <usml/waveq3d/proploss_field.h>
 #include <usml/waveq3d/eigenray_collection.h>